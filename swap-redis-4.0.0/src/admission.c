@@ -0,0 +1,172 @@
+/* Load admission: TinyLFU filter for the keys loaded from SSDB.
+ *
+ * A cold key is chosen for loading when its own LFU counter is high enough,
+ * but loading it evicts another key when memory is short. One-hit wonders
+ * and scans then push really hot keys to SSDB, which come back soon after.
+ *
+ * With ssdb-load-admission enabled, the accesses to every key (hot and cold)
+ * are counted in a Count-Min sketch of 4 rows of 8 bits counters. Its
+ * counters are halved every ADMISSION_SAMPLE_FACTOR*width accesses, so old
+ * popularity fades out. A doorkeeper bitmap absorbs the first access to a
+ * key, so keys seen once don't take room in the sketch. While eviction to
+ * SSDB is active, a cold key is admitted only if its estimated frequency is
+ * higher than the one of the key the next eviction would pick.
+ *
+ * A row has a counter per key of db 0 and EVICTED_DATA_DB, rounded up to a
+ * power of two. The width is set when the sketch is created, and checked
+ * again every time it's aged.
+ */
+
+#include "server.h"
+
+#define ADMISSION_DEPTH 4
+#define ADMISSION_MIN_WIDTH (1<<10)
+#define ADMISSION_MAX_WIDTH (1<<24)
+#define ADMISSION_SAMPLE_FACTOR 10
+
+static struct {
+    uint8_t *sketch;            /* ADMISSION_DEPTH rows of width counters. */
+    uint8_t *doorkeeper;        /* width*8 bits. */
+    uint32_t width;             /* Counters per row, power of two. */
+    long long samples;          /* Accesses since the last aging. */
+    long long stat_admitted;
+    long long stat_rejected;
+    long long stat_agings;
+} la;
+
+/* Counters per row for the keys currently in redis and in SSDB. */
+static uint32_t admissionWidth(void) {
+    unsigned long long keys = dictSize(server.db[0].dict) +
+                              dictSize(EVICTED_DATA_DB->dict);
+    uint32_t width = ADMISSION_MIN_WIDTH;
+
+    while (width < keys && width < ADMISSION_MAX_WIDTH) width <<= 1;
+    return width;
+}
+
+static void admissionInit(uint32_t width) {
+    la.width = width;
+    la.sketch = zcalloc((size_t)ADMISSION_DEPTH*width);
+    la.doorkeeper = zcalloc(width);
+    la.samples = 0;
+}
+
+void loadAdmissionRelease(void) {
+    zfree(la.sketch);
+    zfree(la.doorkeeper);
+    la.sketch = la.doorkeeper = NULL;
+    la.width = 0;
+}
+
+/* Halve all the counters and forget the keys seen once. The sketch starts
+ * over instead if the number of keys asks for another width. */
+static void admissionAge(void) {
+    uint32_t width = admissionWidth();
+    size_t j;
+
+    la.stat_agings++;
+    if (width != la.width) {
+        loadAdmissionRelease();
+        admissionInit(width);
+        return;
+    }
+    for (j = 0; j < (size_t)ADMISSION_DEPTH*la.width; j++)
+        la.sketch[j] >>= 1;
+    memset(la.doorkeeper, 0, la.width);
+    la.samples = 0;
+}
+
+/* The indexes of the rows are derived from the two halves of a single
+ * hash (double hashing). */
+static inline uint32_t admissionIndex(uint64_t h, int row, uint32_t mask) {
+    return ((uint32_t)h + (uint32_t)row*(uint32_t)(h >> 32)) & mask;
+}
+
+static int doorkeeperTest(uint64_t h) {
+    uint32_t a = admissionIndex(h, 0, la.width*8-1);
+    uint32_t b = admissionIndex(h, 1, la.width*8-1);
+
+    return (la.doorkeeper[a>>3] & (1<<(a&7))) && (la.doorkeeper[b>>3] & (1<<(b&7)));
+}
+
+static void doorkeeperSet(uint64_t h) {
+    uint32_t a = admissionIndex(h, 0, la.width*8-1);
+    uint32_t b = admissionIndex(h, 1, la.width*8-1);
+
+    la.doorkeeper[a>>3] |= 1<<(a&7);
+    la.doorkeeper[b>>3] |= 1<<(b&7);
+}
+
+static unsigned int admissionEstimate(sds key) {
+    uint64_t h = dictGenHashFunction(key, sdslen(key));
+    unsigned int min = 255;
+    int row;
+
+    for (row = 0; row < ADMISSION_DEPTH; row++) {
+        uint8_t c = la.sketch[(size_t)row*la.width+admissionIndex(h, row, la.width-1)];
+        if (c < min) min = c;
+    }
+    return min + doorkeeperTest(h);
+}
+
+/* Called on every access to a key in swap mode. */
+void loadAdmissionRecord(sds key) {
+    uint64_t h;
+    int row;
+
+    if (!server.ssdb_load_admission) return;
+    if (!la.sketch) admissionInit(admissionWidth());
+
+    h = dictGenHashFunction(key, sdslen(key));
+    if (!doorkeeperTest(h)) {
+        doorkeeperSet(h);
+    } else {
+        /* Conservative update: only the smallest counters are increased. */
+        unsigned int min = 255;
+        uint8_t *c[ADMISSION_DEPTH];
+
+        for (row = 0; row < ADMISSION_DEPTH; row++) {
+            c[row] = la.sketch+(size_t)row*la.width+admissionIndex(h, row, la.width-1);
+            if (*c[row] < min) min = *c[row];
+        }
+        if (min < 255) {
+            for (row = 0; row < ADMISSION_DEPTH; row++)
+                if (*c[row] == min) (*c[row])++;
+        }
+    }
+
+    if (++la.samples >= (long long)ADMISSION_SAMPLE_FACTOR*la.width)
+        admissionAge();
+}
+
+/* Return 1 if loading the cold 'key' is worth evicting the next victim. */
+int loadAdmissionAllows(sds key) {
+    sds victim;
+
+    if (!server.ssdb_load_admission || !la.sketch) return 1;
+
+    /* Nothing will be evicted to make room for the key. */
+    if (memoryReachTransferLowerLimit()) return 1;
+
+    victim = coldKeyEvictionVictim();
+    if (!victim) return 1;
+
+    if (admissionEstimate(key) > admissionEstimate(victim)) {
+        la.stat_admitted++;
+        return 1;
+    }
+    la.stat_rejected++;
+    return 0;
+}
+
+sds genLoadAdmissionInfoString(sds info) {
+    return sdscatprintf(info,
+        "load_admission_width:%u\r\n"
+        "load_admission_admitted:%lld\r\n"
+        "load_admission_rejected:%lld\r\n"
+        "load_admission_agings:%lld\r\n",
+        la.width,
+        la.stat_admitted,
+        la.stat_rejected,
+        la.stat_agings);
+}
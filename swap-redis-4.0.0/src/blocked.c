@@ -101,6 +101,11 @@ void blockClient(client *c, int btype) {
     c->flags |= CLIENT_BLOCKED;
     c->btype = btype;
     server.bpop_blocked_clients++;
+    if (server.swap_mode) {
+        swapLatencyBlocked(c);
+        if (btype == BLOCKED_SSDB_LOADING_OR_TRANSFER)
+            swapTierRecord(c->cmd, SWAP_TIER_BLOCKED);
+    }
 }
 
 /* This function is called in the beforeSleep() function of the event loop
@@ -154,9 +159,13 @@ void unblockClientWritingOnSameKey(robj* keyobj) {
         unblockClient(blocked);
         serverLog(LL_DEBUG, "client fd:%d, cmd: %s, key: %s is unblocked",
                   blocked->fd, blocked->cmd->name, (char*)keyobj->ptr);
-        if (tryBlockingClient(blocked) == C_OK) {
+        int ret = tryBlockingClient(blocked);
+        if (ret == C_OK) {
             if (C_OK == runCommand(blocked))
                 resetClient(blocked);
+        } else if (ret == C_NOTSUPPORT_ERR) {
+            /* already replied, like processCommand. */
+            resetClient(blocked);
         }
     }
 }
@@ -185,7 +194,11 @@ void unblockClient(client *c) {
                    || c->btype == BLOCKED_BY_EXPIRED_DELETE
                    || c->btype == BLOCKED_MIGRATING_CLIENT)) {
         /* Doing nothing. */
+    } else if (server.swap_mode && c->btype == BLOCKED_SSDB_READ_FLIGHT) {
+        if (c->ssdb_read_flight) leaveSSDBreadFlight(c);
     } else if (server.swap_mode && c->btype == BLOCKED_VISITING_SSDB) {
+        /* The followers of a read that failed. */
+        if (c->ssdb_read_flight) finishSSDBreadFlight(c, 0);
         if (server.masterhost == NULL) {
             removeVisitingSSDBKey(c->cmd, c->argc, c->argv);
             if (c->cmd->flags & CMD_WRITE) {
@@ -211,6 +224,7 @@ void unblockClient(client *c) {
     } else {
         serverPanic("Unknown btype in unblockClient().");
     }
+    if (server.swap_mode) swapLatencyUnblocked(c);
     /* Clear the flags, and put the client in the unblocked list so that
      * we'll process new commands in its query buffer ASAP. */
     c->flags &= ~CLIENT_BLOCKED;
@@ -254,7 +268,8 @@ int replyToBlockedClientTimedOut(client *c) {
         return C_ERR;
     } else if (server.swap_mode && (c->btype == BLOCKED_WRITE_SAME_SSDB_KEY ||
                                     c->btype == BLOCKED_NO_READ_WRITE_TO_SSDB ||
-                                    c->btype == BLOCKED_NO_WRITE_TO_SSDB)) {
+                                    c->btype == BLOCKED_NO_WRITE_TO_SSDB ||
+                                    c->btype == BLOCKED_SSDB_READ_FLIGHT)) {
         serverLog(LL_DEBUG, "[!!!!]block timeout(client:%p,fd:%d,btype:%d), reset it", (void*)c, c->fd, c->btype);
         if (c->btype == BLOCKED_WRITE_SAME_SSDB_KEY)
             removeClientFromListForBlockedKey(c, server.db[0].blocking_keys_write_same_ssdbkey, c->argv[1]);
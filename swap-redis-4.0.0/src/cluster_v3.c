@@ -4562,8 +4562,11 @@ void dumpCommand(client *c) {
     return;
 }
 
-/* RESTORE key ttl serialized-value [REPLACE] */
-void restoreCommand(client *c) {
+/* RESTORE key ttl serialized-value [REPLACE]
+ *
+ * 'loaded' is set when the key comes back from SSDB: its value doesn't
+ * change, so the clients watching it are not touched. */
+void restoreGenericCommand(client *c, int loaded) {
     long long ttl;
     rio payload;
     int j, type, replace = 0;
@@ -4627,11 +4630,15 @@ void restoreCommand(client *c) {
     /* Create the key and set the TTL if any */
     dbAdd(c->db,c->argv[1],obj);
     if (ttl) setExpire(c, c->db,c->argv[1],mstime()+ttl);
-    signalModifiedKey(c->db,c->argv[1]);
+    if (!loaded) signalModifiedKey(c->db,c->argv[1]);
     addReply(c,shared.ok);
     server.dirty++;
 }
 
+void restoreCommand(client *c) {
+    restoreGenericCommand(c,0);
+}
+
 /* MIGRATE socket cache implementation.
  *
  * We take a map between host:ip and a TCP socket that we used to connect
@@ -4771,6 +4778,13 @@ void migrateCommand(client *c) {
     int first_key = 3; /* Argument index of the first key. */
     int num_keys = 1;  /* By default only migrate the 'key' argument. */
 
+    /* MIGRATE reads the replies of SSDB synchronously, it can't share a
+     * connection with other clients. */
+    if (server.swap_mode && c->ssdb_pool_conn) {
+        addReplyError(c,"MIGRATE is not supported with ssdb-connection-pool-size");
+        return;
+    }
+
     /* Initialization */
     copy = 0;
     replace = 0;
@@ -4957,10 +4971,11 @@ try_again:
                     }
 
                     /*TODO: set a reasonable timeout. */
-                    if (syncReadReply(c->context,(void *) &replies[0], 5000) == REDIS_ERR
+                    if (syncWriteSSDBoutput(c, 5000) == C_ERR
+                        || syncReadReply(c,(void *) &replies[0], 5000) == REDIS_ERR
                             || (replies[0]->type == REDIS_REPLY_INTEGER
                                 && replies[0]->integer == 0)
-                            || (syncReadReply(c->context, (void *)&replies[1], 5000) == REDIS_ERR))
+                            || (syncReadReply(c, (void *)&replies[1], 5000) == REDIS_ERR))
                         error_from_ssdb = 1;
 
                     freeReplyObject(replies[0]);
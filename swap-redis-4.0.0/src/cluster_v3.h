@@ -278,5 +278,6 @@ clusterNode *getNodeByQuery(client *c, struct redisCommand *cmd, robj **argv, in
 int clusterRedirectBlockedClientIfNeeded(client *c);
 void clusterRedirectClient(client *c, clusterNode *n, int hashslot, int error_code);
 void createDumpPayload(rio *payload, robj *o);
+int verifyDumpPayload(unsigned char *p, size_t len);
 
 #endif /* __CLUSTER_H */
@@ -475,6 +475,64 @@ void loadServerConfigFromString(char *config) {
                 err = "master-max-concurrent-transferring-keys must be 0 or greater";
                 goto loaderr;
             }
+         } else if (!strcasecmp(argv[0],"ssdb-evict-cycle-budget-us") && argc == 2) {
+            server.ssdb_evict_cycle_budget_us = strtoll(argv[1],NULL,10);
+            if (server.ssdb_evict_cycle_budget_us <= 0) {
+                err = "ssdb-evict-cycle-budget-us must be greater than 0";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-read-coalescing-window-us") && argc == 2) {
+            server.ssdb_read_coalescing_window_us = strtoll(argv[1],NULL,10);
+            if (server.ssdb_read_coalescing_window_us < 0) {
+                err = "ssdb-read-coalescing-window-us can't be negative";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-transfer-target-latency-us") && argc == 2) {
+            server.ssdb_transfer_target_latency_us = strtoll(argv[1],NULL,10);
+            if (server.ssdb_transfer_target_latency_us < 0) {
+                err = "ssdb-transfer-target-latency-us can't be negative";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-thrash-window") && argc == 2) {
+            server.ssdb_thrash_window = strtoll(argv[1],NULL,10);
+            if (server.ssdb_thrash_window < 0) {
+                err = "ssdb-thrash-window can't be negative";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-thrash-ghost-entries") && argc == 2) {
+            server.ssdb_thrash_ghost_entries = strtoll(argv[1],NULL,10);
+            if (server.ssdb_thrash_ghost_entries <= 0 ||
+                server.ssdb_thrash_ghost_entries > SWAP_GHOST_MAX_ENTRIES)
+            {
+                err = "ssdb-thrash-ghost-entries must be between 1 and 2^30";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-min-residency") && argc == 2) {
+            server.ssdb_min_residency = strtoll(argv[1],NULL,10);
+            if (server.ssdb_min_residency < 0) {
+                err = "ssdb-min-residency can't be negative";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-thrash-load-penalty") && argc == 2) {
+            server.ssdb_thrash_load_penalty = atoi(argv[1]);
+            if (server.ssdb_thrash_load_penalty < 0 ||
+                server.ssdb_thrash_load_penalty > 255)
+            {
+                err = "ssdb-thrash-load-penalty must be between 0 and 255";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-reply-cache-size") && argc == 2) {
+            server.ssdb_reply_cache_size = memtoll(argv[1],NULL);
+            if (server.ssdb_reply_cache_size < 0) {
+                err = "ssdb-reply-cache-size can't be negative";
+                goto loaderr;
+            }
+         } else if (!strcasecmp(argv[0],"ssdb-transfer-max-inflight-bytes") && argc == 2) {
+            server.ssdb_transfer_max_inflight_bytes = memtoll(argv[1],NULL);
+            if (server.ssdb_transfer_max_inflight_bytes < 0) {
+                err = "ssdb-transfer-max-inflight-bytes can't be negative";
+                goto loaderr;
+            }
          } else if (!strcasecmp(argv[0],"slave-max-concurrent-ssdb-swap-count") && argc == 2) {
             server.slave_max_concurrent_ssdb_swap_count = atoi(argv[1]);
             if (server.slave_max_concurrent_ssdb_swap_count < 0) {
@@ -499,6 +557,64 @@ void loadServerConfigFromString(char *config) {
                 err = "lowest-idle-val-of-cold-key must be a integer between [0-255]";
                 goto loaderr;
             }
+        } else if (!strcasecmp(argv[0],"transfer-dict-compression") && argc == 2) {
+            if ((server.transfer_dict_compression = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"transfer-dict-size") && argc == 2) {
+            server.transfer_dict_size = atoi(argv[1]);
+            if (server.transfer_dict_size < 256 ||
+                server.transfer_dict_size > TRANSFER_DICT_MAX_SIZE) {
+                err = "transfer-dict-size must be between 256 and 8192";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-promote-with-read") && argc == 2) {
+            if ((server.ssdb_promote_with_read = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-keep-loaded-keys") && argc == 2) {
+            if ((server.ssdb_keep_loaded_keys = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-load-admission") && argc == 2) {
+            if ((server.ssdb_load_admission = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-size-aware-swap") && argc == 2) {
+            if ((server.ssdb_size_aware_swap = yesnotoi(argv[1])) == -1) {
+                err = "argument must be 'yes' or 'no'"; goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-output-buffer-limit") && argc == 2) {
+            server.ssdb_output_buffer_limit = memtoll(argv[1],NULL);
+            if (server.ssdb_output_buffer_limit < 0) {
+                err = "ssdb-output-buffer-limit can't be negative";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-shm-ring-size") && argc == 2) {
+            server.ssdb_shm_ring_size = memtoll(argv[1],NULL);
+            if (server.ssdb_shm_ring_size < 0) {
+                err = "ssdb-shm-ring-size can't be negative";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-coaccess-keys") && argc == 2) {
+            server.ssdb_coaccess_keys = strtoll(argv[1],NULL,10);
+            if (server.ssdb_coaccess_keys < 0) {
+                err = "ssdb-coaccess-keys can't be negative";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-coaccess-window-ms") && argc == 2) {
+            server.ssdb_coaccess_window_ms = strtoll(argv[1],NULL,10);
+            if (server.ssdb_coaccess_window_ms < 1) {
+                err = "ssdb-coaccess-window-ms must be 1 or greater";
+                goto loaderr;
+            }
+        } else if (!strcasecmp(argv[0],"ssdb-connection-pool-size") && argc == 2) {
+            server.ssdb_connection_pool_size = atoi(argv[1]);
+            if (server.ssdb_connection_pool_size < 0 ||
+                server.ssdb_connection_pool_size > SSDB_CONNECTION_POOL_MAX_SIZE) {
+                err = "ssdb-connection-pool-size must be between 0 and 1024";
+                goto loaderr;
+            }
         } else if (!strcasecmp(argv[0],"repl-disable-tcp-nodelay") && argc==2) {
             if ((server.repl_disable_tcp_nodelay = yesnotoi(argv[1])) == -1) {
                 err = "repl-disable-tcp-nodelay argument must be 'yes' or 'no'"; goto loaderr;
@@ -1223,6 +1339,17 @@ void configSetCommand(client *c) {
       "lazyfree-lazy-server-del",server.lazyfree_lazy_server_del) {
     } config_set_bool_field(
       "slave-lazy-flush",server.repl_slave_lazy_flush) {
+    } config_set_bool_field(
+      "transfer-dict-compression",server.transfer_dict_compression) {
+    } config_set_bool_field(
+      "ssdb-promote-with-read",server.ssdb_promote_with_read) {
+    } config_set_bool_field(
+      "ssdb-keep-loaded-keys",server.ssdb_keep_loaded_keys) {
+    } config_set_bool_field(
+      "ssdb-load-admission",server.ssdb_load_admission) {
+        if (!server.ssdb_load_admission) loadAdmissionRelease();
+    } config_set_bool_field(
+      "ssdb-size-aware-swap",server.ssdb_size_aware_swap) {
     } config_set_bool_field(
       "no-appendfsync-on-rewrite",server.aof_no_fsync_on_rewrite) {
     /* Numerical fields.
@@ -1304,6 +1431,26 @@ void configSetCommand(client *c) {
       "master-max-concurrent-loading-keys",server.master_max_concurrent_loading_keys,0,LLONG_MAX) {
     } config_set_numerical_field(
       "master-max-concurrent-transferring-keys",server.master_max_concurrent_transferring_keys,0,LLONG_MAX) {
+    } config_set_numerical_field(
+      "ssdb-evict-cycle-budget-us",server.ssdb_evict_cycle_budget_us,1,LLONG_MAX) {
+    } config_set_numerical_field(
+      "ssdb-read-coalescing-window-us",server.ssdb_read_coalescing_window_us,0,LLONG_MAX) {
+    } config_set_numerical_field(
+      "ssdb-transfer-target-latency-us",server.ssdb_transfer_target_latency_us,0,LLONG_MAX) {
+    } config_set_numerical_field(
+      "ssdb-thrash-window",server.ssdb_thrash_window,0,LLONG_MAX) {
+    } config_set_numerical_field(
+      "ssdb-thrash-ghost-entries",server.ssdb_thrash_ghost_entries,1,SWAP_GHOST_MAX_ENTRIES) {
+        swapGhostResize();
+    } config_set_numerical_field(
+      "ssdb-min-residency",server.ssdb_min_residency,0,LLONG_MAX) {
+    } config_set_numerical_field(
+      "ssdb-thrash-load-penalty",server.ssdb_thrash_load_penalty,0,255) {
+    } config_set_numerical_field(
+      "ssdb-coaccess-keys",server.ssdb_coaccess_keys,0,LLONG_MAX) {
+        coaccessResize();
+    } config_set_numerical_field(
+      "ssdb-coaccess-window-ms",server.ssdb_coaccess_window_ms,1,LLONG_MAX) {
     } config_set_numerical_field(
       "slave-max-concurrent-ssdb-swap-count",server.slave_max_concurrent_ssdb_swap_count,0,LLONG_MAX) {
     } config_set_numerical_field(
@@ -1312,6 +1459,8 @@ void configSetCommand(client *c) {
       "coldkey-filter-times-everytime",server.coldkey_filter_times_everytime,0,LLONG_MAX) {
     } config_set_numerical_field(
       "lowest-idle-val-of-cold-key",server.lowest_idle_val_of_cold_key,0,255) {
+    } config_set_numerical_field(
+      "transfer-dict-size",server.transfer_dict_size,256,TRANSFER_DICT_MAX_SIZE) {
     } config_set_numerical_field(
       "client-visiting-ssdb-timeout",server.client_visiting_ssdb_timeout,1,LLONG_MAX) {
     } config_set_numerical_field(
@@ -1376,6 +1525,15 @@ void configSetCommand(client *c) {
         resizeReplicationBacklog(ll);
     } config_set_memory_field("auto-aof-rewrite-min-size",ll) {
         server.aof_rewrite_min_size = ll;
+    } config_set_memory_field("ssdb-output-buffer-limit",ll) {
+        server.ssdb_output_buffer_limit = ll;
+    } config_set_memory_field("ssdb-shm-ring-size",ll) {
+        server.ssdb_shm_ring_size = ll;
+    } config_set_memory_field("ssdb-reply-cache-size",ll) {
+        server.ssdb_reply_cache_size = ll;
+        replyCacheResize();
+    } config_set_memory_field("ssdb-transfer-max-inflight-bytes",ll) {
+        server.ssdb_transfer_max_inflight_bytes = ll;
 
     /* Enumeration fields.
      * config_set_enum_field(name,var,enum_var) */
@@ -1507,10 +1665,25 @@ void configGetCommand(client *c) {
     config_get_numerical_field("slave-transfer-ssdb-snapshot-timeout", server.slave_transfer_ssdb_snapshot_timeout);
     config_get_numerical_field("master-max-concurrent-loading-keys", server.master_max_concurrent_loading_keys);
     config_get_numerical_field("master-max-concurrent-transferring-keys", server.master_max_concurrent_transferring_keys);
+    config_get_numerical_field("ssdb-evict-cycle-budget-us", server.ssdb_evict_cycle_budget_us);
+    config_get_numerical_field("ssdb-read-coalescing-window-us", server.ssdb_read_coalescing_window_us);
+    config_get_numerical_field("ssdb-transfer-target-latency-us", server.ssdb_transfer_target_latency_us);
+    config_get_numerical_field("ssdb-thrash-window", server.ssdb_thrash_window);
+    config_get_numerical_field("ssdb-thrash-ghost-entries", server.ssdb_thrash_ghost_entries);
+    config_get_numerical_field("ssdb-min-residency", server.ssdb_min_residency);
+    config_get_numerical_field("ssdb-thrash-load-penalty", server.ssdb_thrash_load_penalty);
+    config_get_numerical_field("ssdb-reply-cache-size", server.ssdb_reply_cache_size);
+    config_get_numerical_field("ssdb-transfer-max-inflight-bytes", server.ssdb_transfer_max_inflight_bytes);
     config_get_numerical_field("slave-max-concurrent-ssdb-swap-count", server.slave_max_concurrent_ssdb_swap_count);
     config_get_numerical_field("slave-max-ssdb-swap-count-everytime", server.slave_max_ssdb_swap_count_everytime);
     config_get_numerical_field("coldkey-filter-times-everytime", server.coldkey_filter_times_everytime);
     config_get_numerical_field("lowest-idle-val-of-cold-key", server.lowest_idle_val_of_cold_key);
+    config_get_numerical_field("transfer-dict-size", server.transfer_dict_size);
+    config_get_numerical_field("ssdb-connection-pool-size", server.ssdb_connection_pool_size);
+    config_get_numerical_field("ssdb-output-buffer-limit", server.ssdb_output_buffer_limit);
+    config_get_numerical_field("ssdb-shm-ring-size", server.ssdb_shm_ring_size);
+    config_get_numerical_field("ssdb-coaccess-keys", server.ssdb_coaccess_keys);
+    config_get_numerical_field("ssdb-coaccess-window-ms", server.ssdb_coaccess_window_ms);
 
     config_get_numerical_field("client-visiting-ssdb-timeout",server.client_visiting_ssdb_timeout);
     config_get_numerical_field("client-blocked-by-keys-timeout",server.client_blocked_by_keys_timeout);
@@ -1579,6 +1752,16 @@ void configGetCommand(client *c) {
             server.lazyfree_lazy_server_del);
     config_get_bool_field("slave-lazy-flush",
             server.repl_slave_lazy_flush);
+    config_get_bool_field("transfer-dict-compression",
+            server.transfer_dict_compression);
+    config_get_bool_field("ssdb-promote-with-read",
+            server.ssdb_promote_with_read);
+    config_get_bool_field("ssdb-keep-loaded-keys",
+            server.ssdb_keep_loaded_keys);
+    config_get_bool_field("ssdb-load-admission",
+            server.ssdb_load_admission);
+    config_get_bool_field("ssdb-size-aware-swap",
+            server.ssdb_size_aware_swap);
 
     /* Enum values */
     config_get_enum_field("maxmemory-policy",
@@ -2283,10 +2466,30 @@ int rewriteConfig(char *path) {
     rewriteConfigNumericalOption(state,"slave-transfer-ssdb-snapshot-timeout",server.slave_transfer_ssdb_snapshot_timeout,SLAVE_SSDB_TRANSFER_SNAPSHOT_TIMEOUT);
     rewriteConfigNumericalOption(state,"master-max-concurrent-loading-keys",server.master_max_concurrent_loading_keys,MASTER_MAX_CONCURRENT_LOADING_KEYS);
     rewriteConfigNumericalOption(state,"master-max-concurrent-transferring-keys",server.master_max_concurrent_transferring_keys,MASTER_MAX_CONCURRENT_TRANSFERRING_KEYS);
+    rewriteConfigNumericalOption(state,"ssdb-evict-cycle-budget-us",server.ssdb_evict_cycle_budget_us,SSDB_EVICT_CYCLE_BUDGET_US);
+    rewriteConfigNumericalOption(state,"ssdb-read-coalescing-window-us",server.ssdb_read_coalescing_window_us,SSDB_READ_COALESCING_WINDOW_US);
+    rewriteConfigNumericalOption(state,"ssdb-transfer-target-latency-us",server.ssdb_transfer_target_latency_us,SSDB_TRANSFER_TARGET_LATENCY_US);
+    rewriteConfigNumericalOption(state,"ssdb-thrash-window",server.ssdb_thrash_window,SSDB_THRASH_WINDOW);
+    rewriteConfigNumericalOption(state,"ssdb-thrash-ghost-entries",server.ssdb_thrash_ghost_entries,SSDB_THRASH_GHOST_ENTRIES);
+    rewriteConfigNumericalOption(state,"ssdb-min-residency",server.ssdb_min_residency,SSDB_MIN_RESIDENCY);
+    rewriteConfigNumericalOption(state,"ssdb-thrash-load-penalty",server.ssdb_thrash_load_penalty,SSDB_THRASH_LOAD_PENALTY);
+    rewriteConfigBytesOption(state,"ssdb-reply-cache-size",server.ssdb_reply_cache_size,SSDB_REPLY_CACHE_SIZE);
+    rewriteConfigBytesOption(state,"ssdb-transfer-max-inflight-bytes",server.ssdb_transfer_max_inflight_bytes,SSDB_TRANSFER_MAX_INFLIGHT_BYTES);
     rewriteConfigNumericalOption(state,"slave-max-concurrent-ssdb-swap-count",server.slave_max_concurrent_ssdb_swap_count,SLAVE_MAX_CONCURRENT_SSDB_SWAP_COUNT);
     rewriteConfigNumericalOption(state,"slave-max-ssdb-swap-count-everytime",server.slave_max_ssdb_swap_count_everytime,SLAVE_MAX_SSDB_SWAP_COUNT_EVERYTIME);
     rewriteConfigNumericalOption(state,"coldkey-filter-times-everytime",server.coldkey_filter_times_everytime,COLDKEY_FILTER_TIMES_EVERYTIME);
     rewriteConfigNumericalOption(state,"lowest-idle-val-of-cold-key",server.lowest_idle_val_of_cold_key,LOWEST_IDLE_VAL_OF_COLD_KEY);
+    rewriteConfigYesNoOption(state,"transfer-dict-compression",server.transfer_dict_compression,TRANSFER_DICT_COMPRESSION);
+    rewriteConfigNumericalOption(state,"transfer-dict-size",server.transfer_dict_size,TRANSFER_DICT_SIZE);
+    rewriteConfigYesNoOption(state,"ssdb-promote-with-read",server.ssdb_promote_with_read,SSDB_PROMOTE_WITH_READ);
+    rewriteConfigYesNoOption(state,"ssdb-keep-loaded-keys",server.ssdb_keep_loaded_keys,SSDB_KEEP_LOADED_KEYS);
+    rewriteConfigYesNoOption(state,"ssdb-load-admission",server.ssdb_load_admission,SSDB_LOAD_ADMISSION);
+    rewriteConfigYesNoOption(state,"ssdb-size-aware-swap",server.ssdb_size_aware_swap,SSDB_SIZE_AWARE_SWAP);
+    rewriteConfigNumericalOption(state,"ssdb-connection-pool-size",server.ssdb_connection_pool_size,SSDB_CONNECTION_POOL_SIZE);
+    rewriteConfigBytesOption(state,"ssdb-output-buffer-limit",server.ssdb_output_buffer_limit,SSDB_OUTPUT_BUFFER_LIMIT);
+    rewriteConfigBytesOption(state,"ssdb-shm-ring-size",server.ssdb_shm_ring_size,SSDB_SHM_RING_SIZE);
+    rewriteConfigNumericalOption(state,"ssdb-coaccess-keys",server.ssdb_coaccess_keys,SSDB_COACCESS_KEYS);
+    rewriteConfigNumericalOption(state,"ssdb-coaccess-window-ms",server.ssdb_coaccess_window_ms,SSDB_COACCESS_WINDOW_MS);
 
     rewriteConfigNumericalOption(state,"client-visiting-ssdb-timeout",server.client_visiting_ssdb_timeout,CONFIG_DEFAULT_CLIENT_VISITING_SSDB_TIMEOUT);
     rewriteConfigNumericalOption(state,"client-blocked-by-keys-timeout",server.client_blocked_by_keys_timeout,CONFIG_DEFAULT_CLIENT_BLOCKED_BY_KEYS_TIMEOUT);
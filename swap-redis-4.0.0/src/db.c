@@ -64,6 +64,7 @@ robj *lookupKey(redisDb *db, robj *key, int flags) {
                     unsigned short ldt = lfu >> 8;
                     unsigned char counter = LFULogIncr(lfu & 255);
                     sdssetlfu(db_key, ((ldt << 8) | counter));
+                    loadAdmissionRecord(db_key);
                 } else {
                     unsigned long ldt = val->lru >> 8;
                     unsigned long counter = LFULogIncr(val->lru & 255);
@@ -264,6 +265,7 @@ int dbSyncDelete(redisDb *db, robj *key) {
     if (dictSize(db->expires) > 0) dictDelete(db->expires,key->ptr);
     if (dictDelete(db->dict,key->ptr) == DICT_OK) {
         if (server.cluster_enabled) slotToKeyDel(key);
+        if (server.swap_mode && db->id == 0) forgetKeptKeyCopy(key);
         return 1;
     } else {
         return 0;
@@ -356,6 +358,14 @@ long long emptyDb(int dbnum, int flags, void(callback)(void*)) {
         }
     }
     if (dbnum == -1) flushSlaveKeysWithExpireList();
+    /* SSDB is flushed as well, or the copies are overwritten when the keys
+     * are evicted again. */
+    if (server.swap_mode && (dbnum == -1 || dbnum == 0))
+        dictEmpty(server.ssdb_kept_keys, NULL);
+    if (server.swap_mode && (dbnum == -1 || dbnum == EVICTED_DATA_DBID)) {
+        replyCacheFlush();
+        dictEmpty(server.ssdb_promoting_keys, NULL);
+    }
     return removed;
 }
 
@@ -377,6 +387,7 @@ int selectDb(client *c, int id) {
 
 void signalModifiedKey(redisDb *db, robj *key) {
     touchWatchedKey(db,key);
+    if (server.swap_mode && db->id == 0) markKeptKeyDirty(key);
 }
 
 void signalFlushedDb(int dbid) {
@@ -713,63 +724,29 @@ void scanGenericCommand(client *c, robj *o, unsigned long cursor) {
     }
 
     if (ht) {
-        if (!server.swap_mode) {
-            void *privdata[2];
-            /* We set the max number of iterations to ten times the specified
-             * COUNT, so if the hash table is in a pathological state (very
-             * sparsely populated) we avoid to block too much time at the cost
-             * of returning no or very few elements. */
-            long maxiterations = count*10;
-
-            /* We pass two pointers to the callback: the list to which it will
-             * add new elements, and the object containing the dictionary so that
-             * it is possible to fetch more data in a type-dependent way. */
-            privdata[0] = keys;
-            privdata[1] = o;
-            do {
-                cursor = dictScan(ht, cursor, scanCallback, NULL, privdata);
-            } while (cursor &&
-                     maxiterations-- &&
-                     listLength(keys) < (unsigned long)count);
-        }
-
-        if (server.swap_mode) {
-            void *privdata[2];
-            long maxiterations = count * 10;
-            unsigned long max_sizemask = 0;
-            privdata[0] = keys;
-            privdata[1] = o;
-
-            max_sizemask = ht->ht[0].sizemask;
-            if (dictIsRehashing(ht))
-                max_sizemask = ht->ht[1].sizemask > max_sizemask ? ht->ht[1].sizemask : max_sizemask;
-
-            /* Traverse ht of db[0]. */
-            if (cursor < max_sizemask + 1) {
-                do {
-                    cursor = dictScan(ht, cursor, scanCallback, NULL, privdata);
-                } while (cursor &&
-                         maxiterations-- &&
-                         listLength(keys) < (unsigned long)count);
-            }
-
-            /* Traverse ht of EVICTED_DATA_DB.*/
-            /* Will return duplicated keys if ht is expanded. */
-            /* TODO: Will possiblely miss the keys transferred from ssdb to redis. */
-            if (cursor == 0 || cursor >= (max_sizemask + 1)) {
-                /* Restore the cursor. */
-                if (cursor >= max_sizemask + 1) cursor -= max_sizemask;
-
-                do {
-                    cursor = dictScan(EVICTED_DATA_DB->dict, cursor, scanCallback, NULL, privdata);
-                } while (cursor &&
-                         maxiterations-- &&
-                         listLength(keys) < (unsigned long)count);
-
-                /* Tag the cursor when visiting EVICTED_DATA_DB. */
-                if (cursor != 0) cursor += max_sizemask;
-            }
-        }
+        void *privdata[2];
+        /* We set the max number of iterations to ten times the specified
+         * COUNT, so if the hash table is in a pathological state (very
+         * sparsely populated) we avoid to block too much time at the cost
+         * of returning no or very few elements. */
+        long maxiterations = count*10;
+
+        /* We pass two pointers to the callback: the list to which it will
+         * add new elements, and the object containing the dictionary so that
+         * it is possible to fetch more data in a type-dependent way. */
+        privdata[0] = keys;
+        privdata[1] = o;
+        do {
+            cursor = dictScan(ht, cursor, scanCallback, NULL, privdata);
+        } while (cursor &&
+                 maxiterations-- &&
+                 listLength(keys) < (unsigned long)count);
+
+        /* In swap mode the keys in SSDB come next, processCommandMaybeInSSDB
+         * sends the SCAN with this cursor to SSDB. In MULTI and scripts
+         * only the keys in redis are scanned. */
+        if (o == NULL && cursor == 0 && isSSDBscanAllowed(c))
+            cursor = SCAN_SSDB_CURSOR_FLAG;
     } else if (o->type == OBJ_SET) {
         int pos = 0;
         int64_t ll;
@@ -843,7 +820,7 @@ void scanGenericCommand(client *c, robj *o, unsigned long cursor) {
 
     /* Step 4: Reply to the client. */
     addReplyMultiBulkLen(c, 2);
-    addReplyBulkLongLong(c,cursor);
+    addReplyBulkUnsignedLong(c,cursor);
 
     addReplyMultiBulkLen(c, listLength(keys));
     while ((node = listFirst(keys)) != NULL) {
@@ -862,6 +839,11 @@ cleanup:
 void scanCommand(client *c) {
     unsigned long cursor;
     if (parseScanCursorOrReply(c,c->argv[1],&cursor) == C_ERR) return;
+    /* A cursor of SSDB is only handled by processCommandMaybeInSSDB. */
+    if (server.swap_mode && (cursor & SCAN_SSDB_CURSOR_FLAG)) {
+        addReplyError(c,"SCAN of the keys in SSDB is not supported in MULTI or scripts");
+        return;
+    }
     scanGenericCommand(c,NULL,cursor);
 }
 
@@ -1147,24 +1129,45 @@ void setExpire(client *c, redisDb *db, robj *key, long long when) {
         rememberSlaveKeyWithExpire(db,key);
 }
 
-void setTransferringDB(redisDb *db, robj *key, unsigned long long id) {
-    dictEntry *kde, *de;
+void setTransferringDB(redisDb *db, robj *key, unsigned long long id, size_t bytes) {
+    dictEntry *kde, *de, *existing;
+    transferringKey *tk;
 
-    /* Reuse the sds from the main dict in the transferring dict. */
+    /* The state dicts share the copy of the key owned by
+     * server.swap_key_states, see swapStateKeyDictType. */
     kde = dictFind(db->dict,key->ptr);
     serverAssertWithInfo(NULL,key,kde != NULL);
-    de = dictAddOrFind(EVICTED_DATA_DB->transferring_keys,dictGetKey(kde));
-    dictSetUnsignedIntegerVal(de,id);
+    de = dictAddRaw(EVICTED_DATA_DB->transferring_keys,dictGetKey(kde),&existing);
+    if (de) {
+        tk = zmalloc(sizeof(*tk));
+        tk->bytes = 0;
+        dictSetVal(EVICTED_DATA_DB->transferring_keys,de,tk);
+    } else {
+        tk = dictGetVal(existing);
+    }
+    server.ssdb_transferring_bytes += (long long)bytes - (long long)tk->bytes;
+    tk->id = id;
+    tk->bytes = bytes;
+    tk->start = ustime();
+    swapTierTransferred(bytes);
+    server.ssdb_write_epoch++;
+    replyCacheInvalidate(key->ptr);
+    forgetPromotingKey(key->ptr);
     serverLog(LL_DEBUG, "key: %s is added to transferring_keys.", (char *)key->ptr);
 }
 
 void setLoadingDB(robj *key, unsigned long long id) {
     dictEntry *kde, *de;
-    /* Reuse the sds from the main dict in the loading_hot_keys dict. */
+    /* The state dicts share the copy of the key owned by
+     * server.swap_key_states, see swapStateKeyDictType. */
     kde = dictFind(EVICTED_DATA_DB->dict,key->ptr);
     de = dictAddOrFind(EVICTED_DATA_DB->loading_hot_keys,dictGetKey(kde));
     serverAssert(de);
     dictSetUnsignedIntegerVal(de,id);
+    swapLatencyLoadStarted(id);
+    server.ssdb_write_epoch++;
+    replyCacheInvalidate(key->ptr);
+    forgetPromotingKey(key->ptr);
     /* delete the key from server.hot_keys. but for "dumpfromssdb", the key
      * maybe is not in server.hot_keys before. */
     dictDelete(server.hot_keys, key->ptr);
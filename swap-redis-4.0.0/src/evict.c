@@ -394,7 +394,7 @@ void coldKeyPopulate(dict *sampledict, struct evictionPoolEntry *pool) {
         de = samples[j];
         key = dictGetKey(de);
 
-        if (dictFind(EVICTED_DATA_DB->transferring_keys, key) != NULL)
+        if (swapKeyState(key) & SWAP_KEY_TRANSFERRING)
             continue;
 
         if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
@@ -415,11 +415,27 @@ void coldKeyPopulate(dict *sampledict, struct evictionPoolEntry *pool) {
             serverPanic("Unknown eviction policy in coldKeyPopulate()");
         }
 
-        if (idle >= (unsigned long long)server.lowest_idle_val_of_cold_key)
-            tryInsertColdPool(pool, key, 0, idle);
+        if (idle < (unsigned long long)server.lowest_idle_val_of_cold_key)
+            continue;
+        if (swapGhostResident(key)) continue;
+        if (server.ssdb_size_aware_swap)
+            idle = coldKeyEvictionScore(de, 255-idle);
+        tryInsertColdPool(pool, key, 0, idle);
     }
 }
 
+/* Return the key the next eviction to SSDB would most likely pick, or NULL
+ * if there is none. */
+sds coldKeyEvictionVictim(void) {
+    int k;
+
+    if (!ColdKeyPool[0].key && dictSize(server.db->dict))
+        coldKeyPopulate(server.db->dict, ColdKeyPool);
+    for (k = EVPOOL_SIZE-1; k >= 0; k--)
+        if (ColdKeyPool[k].key) return ColdKeyPool[k].key;
+    return NULL;
+}
+
 /* This is an helper function for freeMemoryIfNeeded(), it is used in order
  * to populate the evictionPool with a few entries every time we want to
  * expire a key. Keys with idle time smaller than one of the current
@@ -443,7 +459,7 @@ void evictionPoolPopulate(int dbid, dict *sampledict, dict *keydict, struct evic
         key = dictGetKey(de);
 
         /* skip the keys already in "transfering" state. */
-        if (server.swap_mode && dictFind(EVICTED_DATA_DB->transferring_keys, key) != NULL)
+        if (server.swap_mode && (swapKeyState(key) & SWAP_KEY_TRANSFERRING))
             continue;
 
         /* If the dictionary we are sampling from is not the main
@@ -549,6 +565,59 @@ uint8_t LFULogIncr(uint8_t counter) {
     return counter;
 }
 
+/* Number of accesses an LFU counter stands for: going from counter c to c+1
+ * takes (c-LFU_INIT_VAL)*lfu_log_factor+1 accesses on average. */
+static double LFUCounterHits(unsigned long counter) {
+    double base = counter > LFU_INIT_VAL ? counter - LFU_INIT_VAL : 0;
+
+    return base*(base-1)/2*server.lfu_log_factor + base;
+}
+
+/* Size-aware swapping (ssdb-size-aware-swap).
+ *
+ * Keys are evicted to SSDB by the bytes they free per access lost. A
+ * transfer costs a round trip plus time proportional to the size of the
+ * key, so the bytes are weighted by 1/(1+bytes/SSDB_TRANSFER_COST_BYTES):
+ * keys of a few bytes are not worth moving, and huge keys that would hold
+ * the server for the dump don't win just because of their size.
+ *
+ * The size of a key evicted to SSDB is kept as the value of its entry in
+ * EVICTED_DATA_DB, as a size class (1+log2 of the bytes, 0 if unknown), so
+ * that large keys need more accesses to be loaded again. */
+unsigned long long coldKeyEvictionScore(dictEntry *de, unsigned long counter) {
+    double bytes = estimateKeyMemoryUsage(de);
+    double cost = 1.0 + bytes/SSDB_TRANSFER_COST_BYTES;
+
+    return (unsigned long long)(bytes/((LFUCounterHits(counter)+1)*cost));
+}
+
+int coldKeySizeClass(size_t bytes) {
+    int class = 0;
+
+    while (bytes && class < 63) {
+        bytes >>= 1;
+        class++;
+    }
+    return class;
+}
+
+/* Return the LFU counter a cold key needs to be loaded. */
+unsigned long coldKeyLoadThreshold(sds key) {
+    unsigned long threshold = LFU_INIT_VAL + swapGhostLoadPenalty(key);
+    dictEntry *de;
+    robj *val;
+    long class;
+
+    if (!server.ssdb_size_aware_swap) return threshold;
+    de = dictFind(EVICTED_DATA_DB->dict, key);
+    if (!de || !(val = dictGetVal(de)) || val->encoding != OBJ_ENCODING_INT)
+        return threshold;
+
+    class = (long)val->ptr;
+    if (class <= SSDB_LOAD_FREE_SIZE_CLASS) return threshold;
+    return threshold + (class-SSDB_LOAD_FREE_SIZE_CLASS);
+}
+
 /* If the object decrement time is reached, decrement the LFU counter and
  * update the decrement time field. Return the object frequency counter.
  *
@@ -607,6 +676,7 @@ int epilogOfEvictingToSSDB(robj *keyobj) {
     sds db_key, evdb_key;
     unsigned int lfu;
     robj* tmpargv[3];
+    robj *sizeobj;
 
     db = server.db + dbid;
     expiretime = getExpire(db, keyobj);
@@ -630,6 +700,9 @@ int epilogOfEvictingToSSDB(robj *keyobj) {
     /* save lfu info when transfer. */
     db_key = dictGetKey(de);
     lfu = sdsgetlfu(db_key);
+    sizeobj = server.ssdb_size_aware_swap ?
+        shared.integers[coldKeySizeClass(estimateKeyMemoryUsage(de))] :
+        shared.integers[0];
 
     latencyStartMonitor(eviction_latency);
     if (server.lazyfree_lazy_eviction)
@@ -640,11 +713,13 @@ int epilogOfEvictingToSSDB(robj *keyobj) {
     latencyAddSampleIfNeeded("coldkey-transfer",eviction_latency);
 
     /* Record the evicted keys in an extra redis db. */
-    setKey(evicteddb, keyobj, shared.integers[0]);
+    setKey(evicteddb, keyobj, sizeobj);
     /* update LFU with old value. */
     ev_de = dictFind(evicteddb->dict, keyobj->ptr);
     evdb_key = dictGetKey(ev_de);
     sdssetlfu(evdb_key, lfu);
+    swapGhostEvicted(keyobj->ptr);
+    replyCacheInvalidate(keyobj->ptr);
 
     server.dirty ++;
 
@@ -666,7 +741,7 @@ int epilogOfEvictingToSSDB(robj *keyobj) {
     robj* setCmdObj = createStringObject("set",3);
     tmpargv[0] = setCmdObj;
     tmpargv[1] = keyobj;
-    tmpargv[2] = shared.integers[0];
+    tmpargv[2] = sizeobj;
     propagate(server.setCommand,EVICTED_DATA_DBID, tmpargv, 3, PROPAGATE_AOF);
     decrRefCount(setCmdObj);
 
@@ -702,8 +777,91 @@ int epilogOfEvictingToSSDB(robj *keyobj) {
     return C_OK;
 }
 
+/* Append the command loading 'keyobj' from SSDB to 'cmd', the transfer id
+ * of the load is returned. */
+static unsigned long long appendLoadingCommand(rio *cmd, robj *keyobj) {
+    char *load_class;
+    int keep = server.ssdb_keep_loaded_keys && server.masterhost == NULL;
+
+    /* tell SSDB whether some clients are blocked on this key, so that it can
+     * schedule the load ahead of rule-driven loads and evictions. */
+    load_class = dictFind(server.db[0].ssdb_blocking_keys, keyobj) ?
+        "blocking" : "hot";
+
+    serverAssert(rioWriteBulkCount(cmd, '*', keep ? 5 : 4));
+    serverAssert(rioWriteBulkString(cmd, "redis_req_dump", strlen("redis_req_dump")));
+    serverAssert(sdsEncodedObject(keyobj));
+    serverAssert(rioWriteBulkString(cmd, keyobj->ptr, sdslen(keyobj->ptr)));
+    server.global_transfer_id++;
+    serverAssert(rioWriteBulkLongLong(cmd, server.global_transfer_id));
+    serverAssert(rioWriteBulkString(cmd, load_class, strlen(load_class)));
+    /* ask SSDB not to delete the key, see keepLoadedKeyCopy. */
+    if (keep) serverAssert(rioWriteBulkString(cmd, "keep", 4));
+
+    return server.global_transfer_id;
+}
+
+/* Append to 'cmd' the loads of the cold keys related to 'keyobj', see
+ * swapcoaccess.c, their objects and transfer ids are stored in 'related'
+ * and 'ids'. Return their number. */
+static int appendRelatedLoadingCommands(rio *cmd, robj *keyobj, robj **related,
+                                        unsigned long long *ids)
+{
+    int j, numkeys;
+
+    if (!server.ssdb_coaccess_keys || server.masterhost) return 0;
+    numkeys = coaccessRelatedKeys(keyobj->ptr, related);
+    for (j = 0; j < numkeys; j++) ids[j] = appendLoadingCommand(cmd, related[j]);
+    return numkeys;
+}
+
+/* Mark the related keys as loading if their loads were sent, and release
+ * them. */
+static void endRelatedLoading(robj **related, unsigned long long *ids,
+                              int numkeys, int sent)
+{
+    int j;
+
+    for (j = 0; j < numkeys; j++) {
+        if (sent) setLoadingDB(related[j], ids[j]);
+        decrRefCount(related[j]);
+    }
+    if (sent && numkeys) {
+        coaccessPrefetched(numkeys);
+        serverLog(LL_DEBUG, "Loading %d keys related to the previous one.", numkeys);
+    }
+}
+
+/* Start loading the keys related to 'keyobj', which is loaded by the reply
+ * of a read, see sendPromotingReadToSSDB(). */
+void prologOfLoadingRelatedKeysFromSSDB(robj *keyobj) {
+    robj *related[COACCESS_SUCCESSORS];
+    unsigned long long ids[COACCESS_SUCCESSORS];
+    rio cmd;
+    int numkeys, sent;
+
+    if (!server.ssdb_coaccess_keys || !isMeetLoadCondition()) return;
+
+    transferDictSync();
+
+    rioInitWithBuffer(&cmd, sdsempty());
+    numkeys = appendRelatedLoadingCommands(&cmd, keyobj, related, ids);
+    if (!numkeys) {
+        sdsfree(cmd.io.buffer.ptr);
+        return;
+    }
+    sent = sendCommandToSSDB(server.ssdb_client, cmd.io.buffer.ptr) == C_OK;
+    endRelatedLoading(related, ids, numkeys, sent);
+}
+
+/* Start loading 'keyobj'. When redis loads the key by itself ('c' is NULL),
+ * the keys related to it are loaded with the same write. */
 int prologOfLoadingFromSSDB(client* c, robj *keyobj) {
+    robj *related[COACCESS_SUCCESSORS];
+    unsigned long long ids[COACCESS_SUCCESSORS];
+    int numkeys = 0;
     rio cmd;
+    unsigned long long id;
 
     if (expireIfNeeded(EVICTED_DATA_DB, keyobj)) {
         serverLog(LL_DEBUG, "key: %s is expired in redis.", (char *)keyobj->ptr);
@@ -711,29 +869,168 @@ int prologOfLoadingFromSSDB(client* c, robj *keyobj) {
         return C_OK;
     }
 
+    transferDictSync();
+
     rioInitWithBuffer(&cmd, sdsempty());
-    serverAssert(rioWriteBulkCount(&cmd, '*', 3));
-    serverAssert(rioWriteBulkString(&cmd, "redis_req_dump", strlen("redis_req_dump")));
-    serverAssert(sdsEncodedObject(keyobj));
-    serverAssert(rioWriteBulkString(&cmd, keyobj->ptr, sdslen(keyobj->ptr)));
-    server.global_transfer_id++;
-    serverAssert(rioWriteBulkLongLong(&cmd, server.global_transfer_id));
+    id = appendLoadingCommand(&cmd, keyobj);
+    if (!c) numkeys = appendRelatedLoadingCommands(&cmd, keyobj, related, ids);
 
     /* sendCommandToSSDB will free cmd.io.buffer.ptr. */
     if (sendCommandToSSDB(server.ssdb_client, cmd.io.buffer.ptr) != C_OK) {
+        endRelatedLoading(related, ids, numkeys, 0);
         if (c) addReplyError(c, "ssdb transfer/loading connection is disconnected.");
         return C_ERR;
     }
 
-    setLoadingDB(keyobj, server.global_transfer_id);
+    setLoadingDB(keyobj, id);
+    endRelatedLoading(related, ids, numkeys, 1);
     if (c) addReply(c,shared.ok);
 
     serverLog(LL_DEBUG, "Loading key: %s from SSDB started.", (char *)(keyobj->ptr));
     return C_OK;
 }
 
+/* Start loading the keys of server.hot_keys among 'keys' with a single
+ * write to SSDB, rather than one command and one write per key. Keys that
+ * can't be loaded now stay in server.hot_keys, and the keys of the batch go
+ * back there if it can't be sent: startToLoadIfNeeded will try them again.
+ * Return the number of keys whose loading started. */
+int prologOfLoadingKeysFromSSDB(robj **keys, int numkeys) {
+    unsigned long long *ids;
+    rio cmd;
+    int j, started = 0;
+
+    if (!isMeetLoadCondition()) return 0;
+
+    transferDictSync();
+
+    ids = zcalloc(sizeof(unsigned long long)*numkeys);
+    rioInitWithBuffer(&cmd, sdsempty());
+    for (j = 0; j < numkeys; j++) {
+        sds key = keys[j]->ptr;
+
+        /* Not wanted any more, or already added to the batch. */
+        if (!(swapKeyState(key) & SWAP_KEY_HOT)) continue;
+
+        if (!dictFind(EVICTED_DATA_DB->dict, key)
+            || expireIfNeeded(EVICTED_DATA_DB, keys[j])) {
+            if (dictDelete(server.hot_keys, key) == DICT_OK)
+                signalBlockingKeyAsReady(&server.db[0], keys[j]);
+            continue;
+        }
+
+        if (swapKeyState(key) & (SWAP_KEY_VISITING|SWAP_KEY_MIGRATING))
+            continue;
+
+        ids[j] = appendLoadingCommand(&cmd, keys[j]);
+        /* setLoadingDB is called once the batch is sent, drop the key from
+         * server.hot_keys to skip duplicates meanwhile. */
+        dictDelete(server.hot_keys, key);
+        started++;
+    }
+
+    if (started == 0) {
+        sdsfree(cmd.io.buffer.ptr);
+    } else if (sendCommandToSSDB(server.ssdb_client, cmd.io.buffer.ptr) != C_OK) {
+        /* Let the blocked clients try again, like isMeetLoadCondition
+         * does when SSDB is not connected. */
+        for (j = 0; j < numkeys; j++) {
+            if (!ids[j]) continue;
+            dictAddOrFind(server.hot_keys, keys[j]->ptr);
+            signalBlockingKeyAsReady(&server.db[0], keys[j]);
+        }
+        started = 0;
+    } else {
+        for (j = 0; j < numkeys; j++)
+            if (ids[j]) setLoadingDB(keys[j], ids[j]);
+        server.stat_batched_loads++;
+        server.stat_batched_loaded_keys += started;
+        serverLog(LL_DEBUG, "Loading %d keys from SSDB started.", started);
+    }
+
+    zfree(ids);
+    return started;
+}
+
+/* Clean/dirty tracking of loaded keys.
+ *
+ * With ssdb-keep-loaded-keys, SSDB doesn't delete the keys it loads to
+ * redis, and server.ssdb_kept_keys remembers the keys whose copy is still in
+ * SSDB, stamped with the transfer id of the load. Any change of the key in
+ * redis marks it dirty. A key that is still clean when it gets cold again
+ * is just moved back to EVICTED_DATA_DB, SSDB isn't involved at all. A dirty
+ * key is transferred as usual, the restore overwrites the stale copy.
+ *
+ * The kept keys are saved in the RDB, so a restarted server or a slave taking
+ * over still knows the copies to delete with their keys. */
+void keepLoadedKeyCopy(robj *key, unsigned long long version) {
+    ssdbKeptKey *kept = zmalloc(sizeof(*kept));
+
+    kept->version = version;
+    kept->expire = getExpire(server.db, key);
+    kept->dirty = 0;
+    dictReplace(server.ssdb_kept_keys, key->ptr, kept);
+}
+
+void markKeptKeyDirty(robj *key) {
+    dictEntry *de;
+
+    if (!dictSize(server.ssdb_kept_keys)) return;
+    if ((de = dictFind(server.ssdb_kept_keys, key->ptr)) != NULL)
+        ((ssdbKeptKey *)dictGetVal(de))->dirty = 1;
+}
+
+/* Called when a key is deleted from db 0, the copy in SSDB is useless. */
+void forgetKeptKeyCopy(robj *key) {
+    if (!dictSize(server.ssdb_kept_keys)) return;
+    if (dictDelete(server.ssdb_kept_keys, key->ptr) == DICT_OK
+        && server.masterhost == NULL)
+        dictAddOrFind(EVICTED_DATA_DB->ssdb_keys_to_clean, key->ptr);
+}
+
+/* Called for every kept key read from the RDB. SSDB may have moved on since
+ * the RDB was saved, so the copy is only trusted to exist: the key is marked
+ * dirty and transferred again when evicted. The copy of a key no longer in
+ * redis is deleted, unless SSDB holds the key itself. */
+void loadKeptKeyCopy(sds key) {
+    robj keyobj;
+
+    initStaticStringObject(keyobj, key);
+    if (dictFind(server.db[0].dict, key)) {
+        keepLoadedKeyCopy(&keyobj, 0);
+        markKeptKeyDirty(&keyobj);
+    } else if (!dictFind(EVICTED_DATA_DB->dict, key) && server.masterhost == NULL) {
+        dictAddOrFind(EVICTED_DATA_DB->ssdb_keys_to_clean, key);
+    }
+}
+
+/* Evict a key of db 0 whose copy in SSDB is up to date without sending it
+ * to SSDB. Return C_ERR if the key must be transferred. */
+static int evictKeptKeyToSSDB(robj *keyobj, long long expiretime) {
+    dictEntry *de = dictFind(server.ssdb_kept_keys, keyobj->ptr);
+    ssdbKeptKey *kept;
+
+    if (!de) return C_ERR;
+
+    kept = dictGetVal(de);
+    if (kept->dirty || kept->expire != expiretime) {
+        /* the restore overwrites the copy. */
+        dictDelete(server.ssdb_kept_keys, keyobj->ptr);
+        return C_ERR;
+    }
+
+    serverLog(LL_DEBUG, "key: %s is clean since load %llu, evicted without transfer.",
+              (char *)keyobj->ptr, kept->version);
+    dictDelete(server.ssdb_kept_keys, keyobj->ptr);
+    server.ssdb_write_epoch++;
+    if (epilogOfEvictingToSSDB(keyobj) == C_OK)
+        server.stat_clean_evictions++;
+    return C_OK;
+}
+
 int prologOfEvictingToSSDB(robj *keyobj, redisDb *db) {
     rio cmd, payload;
+    size_t bytes;
     long long ttl = 0;
     long long expiretime;
     long long now = mstime();
@@ -754,11 +1051,20 @@ int prologOfEvictingToSSDB(robj *keyobj, redisDb *db) {
 
     /* when the key was expired/evicted before but had not been deleted from SSDB. but now
      * we are sure it's a new key, so remove it from ssdb_keys_to_clean to avoid deleting
-     * a key by mistake. */
+     * a key by mistake. If the DEL is already sent, the restore could reach SSDB before
+     * it on the other connection: the key is evicted after the DEL is done. */
     if (dictFind(EVICTED_DATA_DB->ssdb_keys_to_clean, keyobj->ptr)) {
+        if (isSSDBkeyCleaning(keyobj->ptr)) {
+            serverLog(LL_DEBUG, "key: %s is being deleted in SSDB, evicted later.",
+                      (char *)keyobj->ptr);
+            return C_ERR;
+        }
         dictDelete(EVICTED_DATA_DB->ssdb_keys_to_clean, keyobj->ptr);
     }
 
+    if (db->id == 0 && evictKeptKeyToSSDB(keyobj, expiretime) == C_OK)
+        return C_OK;
+
     if (expiretime != -1) {
         /* todo: to optimize for keys with very little ttl time, we
          * don't transfer but let redis expire them. */
@@ -778,7 +1084,11 @@ int prologOfEvictingToSSDB(robj *keyobj, redisDb *db) {
 
     o = dictGetVal(de);
     serverAssert(o);
+    transferDictFeed(o);
+    transferDictSync();
+    transferDictBeginPayload();
     createDumpPayload(&payload, o);
+    transferDictEndPayload();
 
     serverAssert(rioWriteBulkString(&cmd, payload.io.buffer.ptr,
                                     sdslen(payload.io.buffer.ptr)));
@@ -789,6 +1099,7 @@ int prologOfEvictingToSSDB(robj *keyobj, redisDb *db) {
     serverAssert(rioWriteBulkString(&cmd, "REPLACE", strlen("REPLACE")));
     server.global_transfer_id++;
     serverAssert(rioWriteBulkLongLong(&cmd, server.global_transfer_id));
+    bytes = sdslen(cmd.io.buffer.ptr);
 
     /* sendCommandToSSDB will free cmd.io.buffer.ptr. */
     /* Using the same connection with propagate method. */
@@ -797,7 +1108,7 @@ int prologOfEvictingToSSDB(robj *keyobj, redisDb *db) {
         return C_FD_ERR;
     }
 
-    setTransferringDB(db, keyobj, server.global_transfer_id);
+    setTransferringDB(db, keyobj, server.global_transfer_id, bytes);
     serverLog(LL_DEBUG, "Evicting key: %s to SSDB, maxmemory: %lld, zmalloc_used_memory: %lu.",
               (char *)(keyobj->ptr), server.maxmemory, zmalloc_used_memory());
 
@@ -816,13 +1127,16 @@ size_t estimateKeyMemoryUsage(dictEntry *de) {
 void addHotKeys() {
     int k;
     dictEntry* de;
+    unsigned long state;
     struct evictionPoolEntry *pool = HotKeyPool;
 
     /* limit the max num of concurrent loading keys, which may block redis and
      * reduce performance. */
     if (dictSize(server.hot_keys)+dictSize(EVICTED_DATA_DB->loading_hot_keys) >=
-        (unsigned long)server.master_max_concurrent_loading_keys)
+        (unsigned long)swapLoadingLimit()) {
+        swapLimitReached(1);
         return;
+    }
 
     /* Go backward from best to worst element to evict. */
     for (k = EVPOOL_SIZE-1; k >= 0; k--) {
@@ -836,10 +1150,10 @@ void addHotKeys() {
          * NOTE: we don't care visiting_ssdb_keys, because we must ensure there is a
          * chance for a very hot key to be loaded.
          * */
-        if (!de || dictFind(EVICTED_DATA_DB->loading_hot_keys, dictGetKey(de))) {
+        state = de ? swapKeyState(dictGetKey(de)) : 0;
+        if (!de || (state & SWAP_KEY_LOADING)) {
             /* don't need to load this key, just remove it from the pool. */
-        } else if (NULL == dictFind(EVICTED_DATA_DB->transferring_keys, dictGetKey(de))
-            && NULL == dictFind(EVICTED_DATA_DB->delete_confirm_keys, dictGetKey(de))) {
+        } else if (!(state & (SWAP_KEY_TRANSFERRING|SWAP_KEY_DELETE_CONFIRM))) {
             serverLog(LL_DEBUG, "key: %s is added to server.hot_keys", (sds)dictGetKey(de));
             dictAddOrFind(server.hot_keys, dictGetKey(de));
         } else
@@ -861,16 +1175,31 @@ void addHotKeys() {
         }
 
         if (dictSize(server.hot_keys)+dictSize(EVICTED_DATA_DB->loading_hot_keys) >=
-            (unsigned long)server.master_max_concurrent_loading_keys)
+            (unsigned long)swapLoadingLimit())
             return;
     }
 }
 
-int tryEvictingKeysToSSDB(size_t *mem_tofree) {
+/* Return 1 if no more transfers can be started for now. */
+int transferLimitReached(void) {
+    if (dictSize(EVICTED_DATA_DB->transferring_keys) >=
+        (unsigned long)swapTransferLimit()) {
+        swapLimitReached(0);
+        return 1;
+    }
+    if (server.ssdb_transfer_max_inflight_bytes &&
+        server.ssdb_transferring_bytes >= server.ssdb_transfer_max_inflight_bytes)
+        return 1;
+    return 0;
+}
+
+/* Sample the keys of db 0 into ColdKeyPool and start the transfer of the
+ * candidates from the best to the worst, until 'mem_tofree' bytes are being
+ * evicted, the transfer limits are reached or 'deadline' (in microseconds)
+ * is passed. Return C_ERR if no transfer can be started. */
+int tryEvictingKeysToSSDB(size_t *mem_tofree, long long deadline) {
     mstime_t latency;
-    int k, i;
-    sds bestkey = NULL;
-    int bestdbid;
+    int k, i, started = 0;
     redisDb *db;
     dict *dict;
     dictEntry *de;
@@ -892,11 +1221,12 @@ int tryEvictingKeysToSSDB(size_t *mem_tofree) {
     /* there are no keys in ColdKeyPool to evict. */
     if (!total_keys || !ColdKeyPool[0].key) return C_ERR; /* No keys to evict. */
 
-    /* limit concurrent number of transferring keys */
-    if (dictSize(EVICTED_DATA_DB->transferring_keys) >= (unsigned long)server.master_max_concurrent_transferring_keys) return C_ERR;
+    if (transferLimitReached()) return C_ERR;
 
     /* Go backward from best to worst element to evict. */
     for (k = EVPOOL_SIZE-1; k >= 0; k--) {
+        int bestdbid;
+
         if (pool[k].key == NULL) continue;
         bestdbid = pool[k].dbid;
 
@@ -909,45 +1239,44 @@ int tryEvictingKeysToSSDB(size_t *mem_tofree) {
         pool[k].key = NULL;
         pool[k].idle = 0;
 
-        /* If the key exists, is our pick. Otherwise it is
+        /* If the key exists, is a pick. Otherwise it is
          * a ghost and we need to try the next element. */
-        if (de && dictFind(EVICTED_DATA_DB->transferring_keys, dictGetKey(de)) == NULL
-            && dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, dictGetKey(de)) == NULL
-            && dictFind(EVICTED_DATA_DB->delete_confirm_keys, dictGetKey(de)) == NULL
-            && dictFind(server.hot_keys, dictGetKey(de)) == NULL
-            && dictFind(EVICTED_DATA_DB->loading_hot_keys, dictGetKey(de)) == NULL) {
+        if (de && !(swapKeyState(dictGetKey(de)) &
+                    (SWAP_KEY_TRANSFERRING|SWAP_KEY_VISITING|SWAP_KEY_DELETE_CONFIRM|
+                     SWAP_KEY_HOT|SWAP_KEY_LOADING))) {
             //&& !isMigratingSSDBKey(dictGetKey(de))) {
+            unsigned int lfu_counter = 255 & sdsgetlfu(dictGetKey(de));
+            unsigned int idle = 255 - lfu_counter;
+            sds bestkey = dictGetKey(de);
             size_t usage;
-            bestkey = dictGetKey(de);
+            robj *keyobj;
+            int ret;
+
+            if (idle < (unsigned long long)server.lowest_idle_val_of_cold_key)
+                continue;
+
             /* Estimate the memory usage of the bestkey. */
             usage = estimateKeyMemoryUsage(de);
-
             serverLog(LL_DEBUG, "The best key size: %lu", usage);
-            *mem_tofree = *mem_tofree - usage;
-            break;
-        }
-    }
 
-    /* Try to remove the selected key. */
-    if (bestkey) {
-        if (de) {
-            unsigned int lfu_counter = 255 & sdsgetlfu(dictGetKey(de));
-            unsigned int idle = 255 - lfu_counter;
-            if (idle >= (unsigned long long)server.lowest_idle_val_of_cold_key) {
-                robj *keyobj = createStringObject(bestkey,sdslen(bestkey));
-
-                db = server.db+bestdbid;
-                /* Try restoring the redis dumped data to SSDB. */
-                if (prologOfEvictingToSSDB(keyobj, db) == C_FD_ERR)
-                    return C_ERR;
-                decrRefCount(keyobj);
-            }
+            keyobj = createStringObject(bestkey,sdslen(bestkey));
+            /* Try restoring the redis dumped data to SSDB. */
+            ret = prologOfEvictingToSSDB(keyobj, server.db+bestdbid);
+            decrRefCount(keyobj);
+            if (ret == C_FD_ERR) break;
+            if (ret == C_OK) started++;
+
+            *mem_tofree = usage < *mem_tofree ? *mem_tofree - usage : 0;
+            if (*mem_tofree == 0 || transferLimitReached() ||
+                ustime() >= deadline)
+                break;
         }
     }
 
     latencyEndMonitor(latency);
     latencyAddSampleIfNeeded("tryEvictingKeysToSSDB", latency);
-    return C_OK;
+    if (started) server.stat_evict_cycle_keys += started;
+    return started ? C_OK : C_ERR;
 }
 
 /* ----------------------------------------------------------------------------
@@ -1065,7 +1394,7 @@ int freeMemoryIfNeeded(void) {
                     }
 
                     if (server.swap_mode
-                        && dictFind(EVICTED_DATA_DB->transferring_keys, pool[k].key) != NULL)
+                        && (swapKeyState(pool[k].key) & SWAP_KEY_TRANSFERRING))
                         key_is_transfering = 1;
 
                     /* Remove the entry from the pool. */
@@ -1252,7 +1581,10 @@ void handleClientsBlockedOnSSDB(void) {
                             confirmAndRetrySlaveSSDBwriteOp(c, server.blocked_write_op->time, server.blocked_write_op->index);
                         } else {
                             size_t prev_offset = c->reploff;
-                            if (tryBlockingClient(c) == C_OK && runCommand(c) == C_OK) {
+                            int ret = tryBlockingClient(c);
+                            /* already replied, like processCommand. */
+                            if (ret == C_NOTSUPPORT_ERR) resetClient(c);
+                            if (ret == C_OK && runCommand(c) == C_OK) {
                                 if (c->flags & CLIENT_MASTER) {
                                     size_t applied = c->reploff - prev_offset;
                                     if (applied) {
@@ -1295,8 +1627,8 @@ void handleClientsBlockedOnCustomizedPsync(void) {
 
         /* Convert block type. */
         if ((ret = tryBlockingClient(c)) != C_OK) {
-            /* C_NOTSUPPORT_ERR should be handled before. */
-            serverAssert(ret != C_NOTSUPPORT_ERR);
+            /* already replied, like processCommand. */
+            if (ret == C_NOTSUPPORT_ERR) resetClient(c);
             continue;
         }
         if (runCommand(c) == C_OK)
@@ -1400,23 +1732,15 @@ client* removeFirstClientFromListForBlockedKey(dict* blocked_dict, robj* key) {
 int blockForLoadingkeys(client *c, struct redisCommand* cmd, robj **keys, int numkeys, mstime_t timeout) {
     dictEntry *de;
     list *l;
+    unsigned long blocking = SWAP_KEY_LOADING|SWAP_KEY_HOT|SWAP_KEY_DELETE_CONFIRM;
     int j, blockednum = 0;
 
+    /* Reads can go on while the key is transferred to SSDB. */
+    if (!(cmd->flags & CMD_READONLY)) blocking |= SWAP_KEY_TRANSFERRING;
+
     c->bpop.timeout = timeout;
     for (j = 0; j < numkeys; j++) {
-        if (((cmd->flags & CMD_WRITE)
-             && (dictFind(EVICTED_DATA_DB->transferring_keys, keys[j]->ptr)
-                 || dictFind(EVICTED_DATA_DB->loading_hot_keys, keys[j]->ptr)
-                 || dictFind(server.hot_keys, keys[j]->ptr)
-                 || dictFind(EVICTED_DATA_DB->delete_confirm_keys, keys[j]->ptr))
-            )
-            ||
-            ( (cmd->flags & CMD_READONLY)
-              && (dictFind(EVICTED_DATA_DB->loading_hot_keys, keys[j]->ptr)
-                  || dictFind(server.hot_keys, keys[j]->ptr)
-                  || dictFind(EVICTED_DATA_DB->delete_confirm_keys, keys[j]->ptr))
-            )
-        ) {
+        if (swapKeyState(keys[j]->ptr) & blocking) {
             if (dictAdd(c->bpop.loading_or_transfer_keys, keys[j], NULL) != DICT_OK) continue;
 
             serverLog(LL_DEBUG, "key: %s is added to loading_or_transfer_keys.", (char *)keys[j]->ptr);
@@ -1460,14 +1784,16 @@ void removeBlockedKeysFromTransferOrLoadingKeys(client* c) {
 
     while((de = dictNext(di)) != NULL) {
         robj * keyobj = dictGetKey(de);
+        unsigned long state = swapKeyState(keyobj->ptr);
+
         /* remove the key from transferring/loading keys, and signal */
-        if (dictFind(EVICTED_DATA_DB->transferring_keys, keyobj->ptr))
+        if (state & SWAP_KEY_TRANSFERRING)
             dictDelete(EVICTED_DATA_DB->transferring_keys, keyobj->ptr);
-        else if (dictFind(EVICTED_DATA_DB->loading_hot_keys, keyobj->ptr))
+        else if (state & SWAP_KEY_LOADING)
             dictDelete(EVICTED_DATA_DB->loading_hot_keys, keyobj->ptr);
-        else if (dictFind(server.hot_keys, keyobj->ptr))
+        else if (state & SWAP_KEY_HOT)
             dictDelete(server.hot_keys, keyobj->ptr);
-        else if (dictFind(EVICTED_DATA_DB->delete_confirm_keys, keyobj->ptr))
+        else if (state & SWAP_KEY_DELETE_CONFIRM)
             dictDelete(EVICTED_DATA_DB->delete_confirm_keys, keyobj->ptr);
         else
             found = 0;
@@ -1520,8 +1846,9 @@ void ssdbRespDelCommand(client *c) {
         addReplyError(c, "key is already unblocked");
         return;
     }
-    long long resp_transfer_id;
-    unsigned long long transfer_id = dictGetUnsignedIntegerVal(de);
+    long long resp_transfer_id, queued = -1;
+    transferringKey *tk = dictGetVal(de);
+    unsigned long long transfer_id = tk->id;
 
     if (string2ll(c->argv[2]->ptr, sdslen(c->argv[2]->ptr), &resp_transfer_id) != 1 ||
             resp_transfer_id != (long long)transfer_id) {
@@ -1529,6 +1856,13 @@ void ssdbRespDelCommand(client *c) {
         return;;
     }
 
+    /* Newer SSDB tells the depth of its transfer queue. */
+    if (c->argc > 3 &&
+        string2ll(c->argv[3]->ptr, sdslen(c->argv[3]->ptr), &queued) != 1)
+        queued = -1;
+    swapLimitTransferConfirmed(tk->start, queued);
+    swapLatencyRecord(SWAP_LATENCY_TRANSFER, ustime()-tk->start);
+
     if (server.is_doing_flushall) {
         addReplyError(c, "flushall is going");
         return;
@@ -1547,12 +1881,83 @@ void ssdbRespDelCommand(client *c) {
     addReplyLongLong(c, numdel);
 }
 
+/* Called once the value of 'key' loaded from SSDB is in db 0: take over
+ * the lfu and the expire of the cold key, remove it from EVICTED_DATA_DB and
+ * propagate the load, "restore" + "del" to the AOF and "dumpfromssdb" to the
+ * slaves. 'ttl' and 'payload' are the arguments of the restore. */
+void epilogOfLoadingFromSSDB(client *c, robj *key, robj *ttl, robj *payload, long long dict_decoded) {
+    mstime_t when;
+    dictEntry* ev_de = dictFind(EVICTED_DATA_DB->dict, key->ptr);
+    dictEntry* de = dictFind(server.db[0].dict, key->ptr);
+    robj *argv[5];
+
+    /* copy lfu info when load ssdb key to redis.*/
+    sds evdb_key = dictGetKey(ev_de);
+    unsigned int lfu = sdsgetlfu(evdb_key);
+    sds db_key = dictGetKey(de);
+    sdssetlfu(db_key, lfu);
+
+    when = getExpire(EVICTED_DATA_DB, key);
+
+    /* remove the key from db 16 */
+    dictDelete(EVICTED_DATA_DB->expires,key->ptr);
+    dictDelete(EVICTED_DATA_DB->dict,key->ptr);
+    swapGhostLoaded(key->ptr);
+    replyCacheInvalidate(key->ptr);
+
+    /* propagate aof */
+    argv[0] = createStringObject("restore", 7);
+    argv[1] = key;
+    argv[2] = ttl;
+    argv[3] = payload;
+    argv[4] = createStringObject("replace", 7);
+
+    /* the AOF can't be loaded with the transfer dictionary, dump
+     * the value again if SSDB's payload used it. */
+    if (transferDictDecodedCount() != dict_decoded) {
+        rio rdbpayload;
+        createDumpPayload(&rdbpayload, dictGetVal(de));
+        argv[3] = createObject(OBJ_STRING, rdbpayload.io.buffer.ptr);
+    }
+
+    propagate(server.restoreCommand,0,argv,5,PROPAGATE_AOF);
+    decrRefCount(argv[0]);
+    decrRefCount(argv[4]);
+    if (argv[3] != payload) decrRefCount(argv[3]);
+
+    argv[0] = createStringObject("del",3);
+    argv[1] = key;
+    propagate(server.delCommand,EVICTED_DATA_DBID,argv,2,PROPAGATE_AOF);
+    decrRefCount(argv[0]);
+
+    /* Restore ttl info if needed. */
+    if (when >= 0) {
+        setExpire(c, server.db, key, when);
+
+        argv[0] = createStringObject("PEXPIREAT", 9);
+        argv[1] = key;
+        argv[2] = createStringObjectFromLongLong(when);
+        propagate(server.pexpireatCommand, 0, argv, 3, PROPAGATE_AOF);
+        decrRefCount(argv[0]);
+        decrRefCount(argv[2]);
+    }
+
+    // progate dumpfromssdb to slaves
+    argv[0] = shared.dumpcmdobj;
+    argv[1] = key;
+    propagate(lookupCommand(shared.dumpcmdobj->ptr), 0, argv, 2, PROPAGATE_REPL);
+}
+
 /* must reply to SSDB avoid SSDB blocked. */
 void ssdbRespRestoreCommand(client *c) {
     robj * key = c->argv[1];
     long long old_dirty = server.dirty;
+    int argc = c->argc, keep;
     dictEntry* de;
-    serverAssert(c->db->id == 0 && c->argc == 6);
+    serverAssert(c->db->id == 0 && (c->argc == 6 || c->argc == 7));
+
+    /* SSDB still has the key if it was loaded with "keep". */
+    keep = c->argc == 7 && !strcasecmp(c->argv[6]->ptr, "keep");
 
     preventCommandPropagation(c);
 
@@ -1582,56 +1987,16 @@ void ssdbRespRestoreCommand(client *c) {
         }
 
         /* remove transfer id before call restore command. */
+        long long dict_decoded = transferDictDecodedCount();
         c->argc = 5;
-        restoreCommand(c);
+        restoreGenericCommand(c, 1);
 
        /* Delete key from EVICTED_DATA_DB if restoreCommand is OK. */
         if (server.dirty == old_dirty + 1) {
-            mstime_t when;
-            dictEntry* ev_de = dictFind(EVICTED_DATA_DB->dict, c->argv[1]->ptr);
-            dictEntry* de = dictFind(c->db->dict, c->argv[1]->ptr);
-            robj *argv[5];
-
-            /* copy lfu info when load ssdb key to redis.*/
-            sds evdb_key = dictGetKey(ev_de);
-            unsigned int lfu = sdsgetlfu(evdb_key);
-            sds db_key = dictGetKey(de);
-            sdssetlfu(db_key, lfu);
-
-            when = getExpire(EVICTED_DATA_DB, c->argv[1]);
-
-            /* remove the key from db 16 */
-            dictDelete(EVICTED_DATA_DB->expires,key->ptr);
-            dictDelete(EVICTED_DATA_DB->dict,key->ptr);
-
-            /* propagate aof */
-            argv[0] = createStringObject("restore", 7);
-            memcpy(argv+1,c->argv+1,(c->argc-1) * sizeof(robj*));
-
-            propagate(server.restoreCommand,c->db->id,argv,c->argc,PROPAGATE_AOF);
-            decrRefCount(argv[0]);
-
-            argv[0] = createStringObject("del",3);
-            argv[1] = key;
-            propagate(server.delCommand,EVICTED_DATA_DBID,argv,2,PROPAGATE_AOF);
-            decrRefCount(argv[0]);
-
-            /* Restore ttl info if needed. */
-            if (when >= 0) {
-                setExpire(c, server.db, c->argv[1], when);
-
-                argv[0] = createStringObject("PEXPIREAT", 9);
-                argv[1] = c->argv[1];
-                argv[2] = createStringObjectFromLongLong(when);
-                propagate(server.pexpireatCommand, 0, argv, 3, PROPAGATE_AOF);
-                decrRefCount(argv[0]);
-                decrRefCount(argv[2]);
-            }
-
-            // progate dumpfromssdb to slaves
-            argv[0] = shared.dumpcmdobj;
-            argv[1] = key;
-            propagate(lookupCommand(shared.dumpcmdobj->ptr), 0, argv, 2, PROPAGATE_REPL);
+            epilogOfLoadingFromSSDB(c, key, c->argv[2], c->argv[3], dict_decoded);
+            if (keep) keepLoadedKeyCopy(key, transfer_id);
+            swapLatencyLoadDone(transfer_id);
+            swapTierLoaded(stringObjectLen(c->argv[3]));
             serverLog(LL_DEBUG, "ssdbRespRestoreCommand succeed.");
         } else
             serverLog(LL_WARNING, "ssdbRespRestoreCommand failed.");
@@ -1643,8 +2008,199 @@ void ssdbRespRestoreCommand(client *c) {
             signalBlockingKeyAsReady(c->db, key);
             serverLog(LL_DEBUG, "key: %s is deleted from loading_hot_keys.", (char *)key->ptr);
         }
-        c->argc = 6;
+        c->argc = argc;
+    }
+}
+
+/* Piggy-backed promotion: when a read hits a cold key hot enough to be
+ * loaded, send it as "rr_promote <id> <cmd> <key> ...", SSDB runs the read
+ * and returns the dump of the key in the extra reply, so that the key is
+ * loaded in the same round trip instead of a later redis_req_dump.
+ *
+ * SSDB doesn't delete its copy, which is kept like the ones of
+ * ssdb-keep-loaded-keys: it is up to date until the key changes in redis.
+ * server.ssdb_promoting_keys maps the key to the id of the read in flight,
+ * any write, load or transfer of the key removes it, and the payload is
+ * dropped then.
+ *
+ * Return C_OK if the read was sent, C_ERR if it must be sent as usual, or
+ * the error of sendCommandToSSDB. */
+int sendPromotingReadToSSDB(client *c, robj *keyobj) {
+    robj **argv;
+    sds finalcmd;
+    unsigned long state;
+    int j, ret;
+
+    if (!server.ssdb_promote_with_read || server.masterhost
+        || server.is_doing_flushall)
+        return C_ERR;
+
+    if (!(c->cmd->flags & CMD_READONLY) || c->first_key_index != 1
+        || (c->flags & (CLIENT_MULTI|CLIENT_LUA)))
+        return C_ERR;
+
+    state = swapKeyState(keyobj->ptr);
+    if (state & (SWAP_KEY_LOADING|SWAP_KEY_TRANSFERRING|
+                 SWAP_KEY_DELETE_CONFIRM|SWAP_KEY_MIGRATING)
+        || ((state & SWAP_KEY_VISITING) && isThisKeyVisitingWriteSSDB(keyobj->ptr)))
+        return C_ERR;
+
+    if (dictFind(server.ssdb_promoting_keys, keyobj->ptr)) return C_ERR;
+
+    if (!isColdKeyHot(keyobj)) return C_ERR;
+
+    argv = zmalloc(sizeof(robj*) * (c->argc+2));
+    argv[0] = createStringObject("rr_promote", 10);
+    /* not a shared integer, composeCmdFromArgs needs the sds. */
+    argv[1] = createObject(OBJ_STRING, sdsfromlonglong(++server.global_transfer_id));
+    for (j = 0; j < c->argc; j++) argv[j+2] = c->argv[j];
+    finalcmd = composeCmdFromArgs(c->argc+2, argv);
+    decrRefCount(argv[0]);
+    decrRefCount(argv[1]);
+    zfree(argv);
+
+    if (!finalcmd) return C_ERR;
+
+    transferDictSync();
+
+    ret = sendCommandToSSDB(c, finalcmd);
+    if (ret != C_OK) return ret;
+
+    c->promote_id = server.global_transfer_id;
+    dictSetUnsignedIntegerVal(dictAddRaw(server.ssdb_promoting_keys, keyobj->ptr, NULL),
+                              c->promote_id);
+    return C_OK;
+}
+
+/* Forget the promoting read of 'c', if any. */
+void forgetPromotingRead(client *c) {
+    dictEntry *de;
+
+    if (!c->promote_id) return;
+    de = dictFind(server.ssdb_promoting_keys, c->argv[1]->ptr);
+    if (de && dictGetUnsignedIntegerVal(de) == c->promote_id)
+        dictDelete(server.ssdb_promoting_keys, c->argv[1]->ptr);
+    c->promote_id = 0;
+}
+
+/* Called when the copy of a cold key in SSDB may change. */
+void forgetPromotingKey(sds key) {
+    if (dictSize(server.ssdb_promoting_keys))
+        dictDelete(server.ssdb_promoting_keys, key);
+}
+
+/* Load the key of a read sent by sendPromotingReadToSSDB if SSDB returned
+ * its dump, extra reply: "check 0|1", "repopid ...", "promote", <id>, <payload>. */
+void handlePromotingReadReply(client *c) {
+    redisReply *reply = c->ssdb_replies[1];
+    robj *key = c->argv[1], *payload, *ttl;
+    unsigned long long promote_id = c->promote_id;
+    long long id, dict_decoded;
+    unsigned long state;
+    dictEntry *de;
+    rio rdb;
+    robj *obj;
+    int type, changed;
+
+    if (!promote_id) return;
+    de = dictFind(server.ssdb_promoting_keys, key->ptr);
+    changed = !de || dictGetUnsignedIntegerVal(de) != promote_id;
+    forgetPromotingRead(c);
+
+    if (reply->elements < 5 || reply->element[2]->type != REDIS_REPLY_STRING
+        || strcmp(reply->element[2]->str, "promote")
+        || reply->element[4]->type != REDIS_REPLY_STRING)
+        return;
+
+    if (string2ll(reply->element[3]->str, reply->element[3]->len, &id) != 1
+        || (unsigned long long)id != promote_id) goto dropped;
+
+    /* The key may have changed in SSDB after the dump was taken. */
+    if (changed || server.is_doing_flushall
+        || !dictFind(EVICTED_DATA_DB->dict, key->ptr)
+        || dictFind(server.db[0].dict, key->ptr)
+        || (state = swapKeyState(key->ptr)) & (SWAP_KEY_LOADING|SWAP_KEY_TRANSFERRING|
+                                              SWAP_KEY_DELETE_CONFIRM|SWAP_KEY_MIGRATING)
+        || ((state & SWAP_KEY_VISITING) && isThisKeyVisitingWriteSSDB(key->ptr)))
+        goto dropped;
+
+    if (expireIfNeeded(EVICTED_DATA_DB, key)) goto dropped;
+
+    if (verifyDumpPayload((unsigned char*)reply->element[4]->str, reply->element[4]->len) == C_ERR)
+        goto dropped;
+
+    payload = createStringObject(reply->element[4]->str, reply->element[4]->len);
+    dict_decoded = transferDictDecodedCount();
+    rioInitWithBuffer(&rdb, payload->ptr);
+    if (((type = rdbLoadObjectType(&rdb)) == -1) ||
+        ((obj = rdbLoadObject(type, &rdb)) == NULL)) {
+        decrRefCount(payload);
+        goto dropped;
+    }
+
+    /* The value doesn't change, the clients watching the key are not
+     * touched, like restoreGenericCommand does for loaded keys. */
+    dbAdd(&server.db[0], key, obj);
+    server.dirty++;
+
+    ttl = createStringObjectFromLongLong(0);
+    epilogOfLoadingFromSSDB(c, key, ttl, payload, dict_decoded);
+    decrRefCount(ttl);
+    decrRefCount(payload);
+
+    /* SSDB only returned a copy. */
+    keepLoadedKeyCopy(key, promote_id);
+
+    dictDelete(server.hot_keys, key->ptr);
+    signalBlockingKeyAsReady(&server.db[0], key);
+
+    server.stat_promote_with_read++;
+    serverLog(LL_DEBUG, "key: %s is loaded with the reply of %s.",
+              (char *)key->ptr, c->cmd->name);
+    return;
+
+dropped:
+    server.stat_promote_with_read_dropped++;
+    serverLog(LL_DEBUG, "promoted payload of key: %s is dropped.", (char *)key->ptr);
+}
+
+/* ssdb-resp-hot <key> <weight> [<key> <weight> ...]
+ *
+ * Pushed by SSDB with the cold keys whose reads cost it the most, heaviest
+ * first, see util/hot_keys.h of SSDB. The keys are put in the hot pool like
+ * the ones chosen by their LFU counter, ranked by their order unless redis
+ * already finds them hotter, and are loaded by addHotKeys() once a load rule
+ * matches. */
+void ssdbRespHotCommand(client *c) {
+    int j, pooled = 0;
+
+    if (!server.swap_mode) {
+        addReplyErrorFormat(c,"Command only supported in swap-mode '%s'",
+                            (char *)c->argv[0]->ptr);
+        return;
+    }
+    if (c->argc % 2 == 0) {
+        addReply(c, shared.syntaxerr);
+        return;
+    }
+
+    for (j = 1; j < c->argc; j += 2) {
+        sds key = c->argv[j]->ptr;
+        dictEntry *de = dictFind(EVICTED_DATA_DB->dict, key);
+        unsigned long long idle = (j-1)/2;
+
+        server.stat_ssdb_hot_keys++;
+        if (!de || (swapKeyState(dictGetKey(de)) & SWAP_KEY_LOADING))
+            continue;
+        if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+            unsigned long long lfu_idle = 255-(sdsgetlfu(dictGetKey(de)) & 255);
+            if (lfu_idle < idle) idle = lfu_idle;
+        }
+        replaceKeyInHotPool(key, EVICTED_DATA_DBID, idle);
+        pooled++;
     }
+    server.stat_ssdb_hot_keys_pooled += pooled;
+    addReplyLongLong(c, pooled);
 }
 
 void ssdbRespNotfoundCommand(client *c) {
@@ -1726,7 +2282,8 @@ void ssdbRespFailCommand(client *c) {
 
     serverAssert(de);
     long long resp_transfer_id;
-    unsigned long long transfer_id = dictGetUnsignedIntegerVal(de);
+    unsigned long long transfer_id = !sdscmp(cmd->ptr, fail_dump) ?
+        ((transferringKey *)dictGetVal(de))->id : dictGetUnsignedIntegerVal(de);
 
     if (string2ll(c->argv[3]->ptr, sdslen(c->argv[3]->ptr), &resp_transfer_id) != 1 ||
             resp_transfer_id != (long long)transfer_id) {
@@ -1757,6 +2314,7 @@ void ssdbRespFailCommand(client *c) {
 
 void storetossdbCommand(client *c) {
     robj *keyobj;
+    unsigned long state;
     int ret;
 
     preventCommandPropagation(c);
@@ -1774,19 +2332,20 @@ void storetossdbCommand(client *c) {
         return;
     }
 
-    if (dictFind(EVICTED_DATA_DB->transferring_keys, keyobj->ptr)) {
+    state = swapKeyState(keyobj->ptr);
+    if (state & SWAP_KEY_TRANSFERRING) {
         addReplyError(c, "In transferring_keys.");
         server.cmdNotDone = 1;
         return;
-    } else if (dictFind(EVICTED_DATA_DB->loading_hot_keys, keyobj->ptr)) {
+    } else if (state & SWAP_KEY_LOADING) {
         addReplyError(c, "In loading_hot_keys.");
         server.cmdNotDone = 1;
         return;
-    } else if (dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, keyobj->ptr)) {
+    } else if (state & SWAP_KEY_VISITING) {
         addReplyError(c, "In visiting_ssdb_keys.");
         server.cmdNotDone = 1;
         return;
-    } else if (dictFind(EVICTED_DATA_DB->delete_confirm_keys, keyobj->ptr)) {
+    } else if (state & SWAP_KEY_DELETE_CONFIRM) {
         addReplyError(c, "In delete_confirm_keys.");
         server.cmdNotDone = 1;
         return;
@@ -1813,6 +2372,7 @@ void storetossdbCommand(client *c) {
 
 void dumpfromssdbCommand(client *c) {
     robj *keyobj = c->argv[1];
+    unsigned long state;
 
     if (!server.swap_mode) {
         addReplyErrorFormat(c,"Command only supported in swap-mode '%s'",
@@ -1820,19 +2380,20 @@ void dumpfromssdbCommand(client *c) {
         return;
     }
 
-    if (dictFind(EVICTED_DATA_DB->transferring_keys, keyobj->ptr)) {
+    state = swapKeyState(keyobj->ptr);
+    if (state & SWAP_KEY_TRANSFERRING) {
         addReplyError(c, "In transferring_keys.");
         server.cmdNotDone = 1;
         return;
-    } else if (dictFind(EVICTED_DATA_DB->loading_hot_keys, keyobj->ptr)) {
+    } else if (state & SWAP_KEY_LOADING) {
         addReplyError(c, "In loading_hot_keys.");
         server.cmdNotDone = 1;
         return;
-    } else if (dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, keyobj->ptr)) {
+    } else if (state & SWAP_KEY_VISITING) {
         addReplyError(c, "In visiting_ssdb_keys.");
         server.cmdNotDone = 1;
         return;
-    } else if (dictFind(EVICTED_DATA_DB->delete_confirm_keys, keyobj->ptr)) {
+    } else if (state & SWAP_KEY_DELETE_CONFIRM) {
         addReplyError(c, "In delete_confirm_keys.");
         server.cmdNotDone = 1;
         return;
@@ -82,6 +82,7 @@ int dbAsyncDelete(redisDb *db, robj *key) {
     if (de) {
         dictFreeUnlinkedEntry(db->dict,de);
         if (server.cluster_enabled) slotToKeyDel(key);
+        if (server.swap_mode && db->id == 0) forgetKeptKeyCopy(key);
         return 1;
     } else {
         return 0;
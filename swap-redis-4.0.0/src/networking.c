@@ -35,6 +35,10 @@
 #include "slowlog.h"
 
 static void setProtocolError(const char *errstr, client *c, int pos);
+static void revertClientBufReply(client *c, size_t revertlen);
+static void resumeSSDBoutputPausedClients(void);
+static client *ssdbReplyTargetOf(client *conn);
+static int handleSSDBconnectionBroken(client *conn, client *c);
 
 /* Return the size consumed from the allocator, for the specified SDS string,
  * including internal fragmentation. This function is used in order to compute
@@ -137,6 +141,17 @@ client *createClient(int fd) {
         c->ssdb_replies[1] = NULL;
         c->revert_len = 0;
         c->first_key_index = 0;
+        c->promote_id = 0;
+        c->ssdb_pool_conn = NULL;
+        c->ssdb_pool_waiting = NULL;
+        c->ssdb_pool_pending = 0;
+        c->ssdb_obuf = sdsempty();
+        c->ssdb_fanout = NULL;
+        c->ssdb_read_flight = NULL;
+        c->swap_blocked_since = 0;
+        c->ssdb_shm_ring = NULL;
+        c->coaccess_key = NULL;
+        c->coaccess_time = 0;
     }
     c->bpop.target = NULL;
     c->bpop.numreplicas = 0;
@@ -600,6 +615,15 @@ void addReplyBulkLongLong(client *c, long long ll) {
     addReplyBulkCBuffer(c,buf,len);
 }
 
+/* Like addReplyBulkLongLong, for SCAN cursors which may use all the bits. */
+void addReplyBulkUnsignedLong(client *c, unsigned long ul) {
+    char buf[64];
+    int len;
+
+    len = snprintf(buf,sizeof(buf),"%lu",ul);
+    addReplyBulkCBuffer(c,buf,len);
+}
+
 /* Copy 'src' client output buffers into 'dst' client output buffers.
  * The function takes care of freeing the old output buffers of the
  * destination client. */
@@ -618,6 +642,11 @@ int clientHasPendingReplies(client *c) {
 }
 
 void handleConnectSSDBok(client* c) {
+    if (server.ssdb_shm_ring_size && attachSSDBshmRing(c) == C_ERR) {
+        serverLog(LL_WARNING, "SSDB connection lost while setting up the shared memory ring");
+        handleSSDBconnectionDisconnect(c);
+        return;
+    }
     serverLog(LL_DEBUG, "connect ssdb success");
     if (server.ssdb_is_down) {
         serverLog(LL_NOTICE, "[!!!]SSDB is up now");
@@ -642,6 +671,9 @@ void handleConnectSSDBok(client* c) {
     } else {
         c->ssdb_conn_flags |= CONN_SUCCESS;
     }
+
+    /* negotiate the transfer dictionary before any transfer command. */
+    if (c == server.ssdb_client) transferDictSync();
 }
 
 void ssdbConnectCallback(aeEventLoop *el, int fd, void *privdata, int mask) {
@@ -775,7 +807,8 @@ sds composeCmdFromArgs(int argc, robj** obj_argv) {
     return finalcmd;
 }
 
-void handleSSDBconnectionDisconnect(client* c) {
+/* The check replies this client waits for will never come. */
+static void abortSSDBcheckOfClient(client *c) {
     if ((c->ssdb_conn_flags & CONN_WAIT_FLUSH_CHECK_REPLY) && server.flush_check_begin_time != -1) {
         server.flush_check_unresponse_num -= 1;
         c->ssdb_conn_flags &= ~CONN_WAIT_FLUSH_CHECK_REPLY;
@@ -798,18 +831,109 @@ void handleSSDBconnectionDisconnect(client* c) {
                 resetCustomizedReplication();
         }
     }
+}
+
+/* Fail the clients waiting for replies on the pooled connection 'conn',
+ * which is disconnected, like we do for a lost per-client connection. */
+static void failSSDBpoolWaiters(client *conn) {
+    list *waiting = conn->ssdb_pool_waiting;
+    listNode *ln;
+    listIter li;
+
+    /* the flush/write check handlers may send commands to SSDB again. */
+    conn->ssdb_pool_waiting = listCreate();
+
+    listRewind(waiting, &li);
+    while ((ln = listNext(&li))) {
+        client *c = listNodeValue(ln);
+
+        if (!c) continue;
+        c->ssdb_pool_pending--;
+        revertClientBufReply(c, c->revert_len);
+        c->revert_len = 0;
+        if (c->ssdb_replies[0]) {
+            freeReplyObject(c->ssdb_replies[0]);
+            c->ssdb_replies[0] = NULL;
+        }
+
+        if (c->flags & CLIENT_BLOCKED
+            && (c->btype == BLOCKED_VISITING_SSDB
+                || c->btype == BLOCKED_MIGRATING_DUMP
+                || c->btype == BLOCKED_BY_FLUSHALL)) {
+            unblockClient(c);
+            resetClient(c);
+            if (c->flags & CLIENT_CLOSE_AFTER_SSDB_WRITE_PROPAGATE)
+                freeClientAsync(c);
+            else
+                addReplyError(c, "SSDB disconnect when read");
+        }
+        abortSSDBcheckOfClient(c);
+    }
+    listRelease(waiting);
+
+    if (conn->ssdb_replies[0]) {
+        freeReplyObject(conn->ssdb_replies[0]);
+        conn->ssdb_replies[0] = NULL;
+    }
+}
+
+/* The client 'c' goes away, the replies it waits for on its pooled
+ * connection will be read and dropped. */
+static void orphanSSDBpoolWaiter(client *c) {
+    client *conn = c->ssdb_pool_conn;
+    listNode *ln;
+    listIter li;
+
+    listRewind(conn->ssdb_pool_waiting, &li);
+    while ((ln = listNext(&li))) {
+        if (listNodeValue(ln) != c) continue;
+        /* the first part of the reply is already read. */
+        if (ln == listFirst(conn->ssdb_pool_waiting) && c->ssdb_replies[0]) {
+            conn->ssdb_replies[0] = c->ssdb_replies[0];
+            c->ssdb_replies[0] = NULL;
+        }
+        listNodeValue(ln) = NULL;
+    }
+    c->ssdb_pool_pending = 0;
+}
+
+void handleSSDBconnectionDisconnect(client* c) {
+    abortSSDBcheckOfClient(c);
+
+    if (c->ssdb_conn_flags & CONN_OUTPUT_PAUSED) {
+        listNode *ln = listSearchKey(server.ssdb_output_paused_clients, c);
+        if (ln) listDelNode(server.ssdb_output_paused_clients, ln);
+        c->ssdb_conn_flags &= ~CONN_OUTPUT_PAUSED;
+    }
+
+    if (c->ssdb_pool_conn) {
+        orphanSSDBpoolWaiter(c);
+        return;
+    }
 
     c->ssdb_conn_flags &= ~CONN_SUCCESS;
     c->ssdb_conn_flags |= CONN_CONNECT_FAILED;
 
+    if (c == server.ssdb_client) transferDictConnectionLost();
+
     if (c->context) {
          /* Unlink resources used in connecting to SSDB. */
         if (c->context->fd > 0)
             aeDeleteFileEvent(server.el, c->context->fd, AE_READABLE|AE_WRITABLE);
+        if (c->ssdb_shm_ring) detachSSDBshmRing(c);
         redisFree(c->context);
         c->context = NULL;
     }
 
+    /* the buffered commands are lost with the connection. */
+    if (sdslen(c->ssdb_obuf)) {
+        server.ssdb_output_pending_bytes -= sdslen(c->ssdb_obuf);
+        sdsclear(c->ssdb_obuf);
+        resumeSSDBoutputPausedClients();
+    }
+
+    if (c->ssdb_pool_waiting) failSSDBpoolWaiters(c);
+
     /* for server.master/server.cached_master only */
     if (c->flags & CLIENT_MASTER) {
         c->ssdb_conn_flags &= ~CONN_CHECK_REPOPID;
@@ -833,38 +957,148 @@ int closeAndReconnectSSDBconnection(client* c) {
     return C_OK;
 }
 
-/* don't call this function directly, use sendCommandToSSDB instead. */
-static int internalSendCommandToSSDB(client *c, sds finalcmd) {
+/* Return 1 if the output buffer of the SSDB connection used by 'c' is
+ * over server.ssdb_output_buffer_limit. */
+static int isSSDBoutputFull(client *c) {
+    client *conn = ssdbConnectionOf(c);
+
+    return server.ssdb_output_buffer_limit &&
+        (long long)sdslen(conn->ssdb_obuf) > server.ssdb_output_buffer_limit;
+}
+
+/* Called before processing a command of 'c': if the SSDB connection is too
+ * slow to take the commands already sent to it, stop processing the commands
+ * of this client until the connection catches up. Return 1 if paused. */
+int pauseClientIfSSDBoutputFull(client *c) {
+    if (!server.swap_mode || c->fd <= 0
+        || c->flags & (CLIENT_MASTER|CLIENT_SLAVE)
+        || isSpecialConnection(c) || !isSSDBoutputFull(c))
+        return 0;
+
+    if (!(c->ssdb_conn_flags & CONN_OUTPUT_PAUSED)) {
+        c->ssdb_conn_flags |= CONN_OUTPUT_PAUSED;
+        listAddNodeTail(server.ssdb_output_paused_clients, c);
+        server.stat_ssdb_output_paused++;
+    }
+    return 1;
+}
+
+/* Process again the commands of the paused clients whose connection has
+ * room again. */
+static void resumeSSDBoutputPausedClients(void) {
+    listNode *ln;
+    listIter li;
+
+    listRewind(server.ssdb_output_paused_clients, &li);
+    while ((ln = listNext(&li))) {
+        client *c = listNodeValue(ln);
+
+        if (isSSDBoutputFull(c)) continue;
+        c->ssdb_conn_flags &= ~CONN_OUTPUT_PAUSED;
+        listDelNode(server.ssdb_output_paused_clients, ln);
+        if (!(c->flags & CLIENT_UNBLOCKED)) {
+            c->flags |= CLIENT_UNBLOCKED;
+            listAddNodeTail(server.unblocked_clients, c);
+        }
+    }
+}
+
+/* Write as much as possible of the output buffer of 'c', return C_ERR if
+ * the connection is broken. */
+static int writeSSDBoutputBuffer(client *c) {
     int nwritten;
+
+    if (c->ssdb_shm_ring) {
+        nwritten = writeSSDBshmRing(c, c->ssdb_obuf, sdslen(c->ssdb_obuf));
+        sdsrange(c->ssdb_obuf, nwritten, -1);
+        server.ssdb_output_pending_bytes -= nwritten;
+        return C_OK;
+    }
+
+    while (sdslen(c->ssdb_obuf) > 0) {
+        nwritten = write(c->context->fd, c->ssdb_obuf, sdslen(c->ssdb_obuf));
+        if (nwritten == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            serverLog(LL_WARNING, "Error writing to SSDB server: %s", strerror(errno));
+            return C_ERR;
+        }
+        sdsrange(c->ssdb_obuf, nwritten, -1);
+        server.ssdb_output_pending_bytes -= nwritten;
+    }
+    return C_OK;
+}
+
+/* Watch writable events when there is something to write, or replies left
+ * in the reader buffer which didn't trigger a readable event. With rings,
+ * SSDB rings when there is room to write. */
+static void updateSSDBwritableEvent(client *c) {
+    redisReader *r = c->context->reader;
+
+    if ((sdslen(c->ssdb_obuf) && !c->ssdb_shm_ring) || r->len - r->pos != 0)
+        aeCreateFileEvent(server.el, c->context->fd, AE_WRITABLE,
+                          ssdbClientWritableHandler, c);
+    else
+        aeDeleteFileEvent(server.el, c->context->fd, AE_WRITABLE);
+}
+
+void ssdbClientWritableHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
+    client *c = (client *)privdata;
+    redisReader *r;
+
+    if (!c || !c->context) return;
+
+    if (sdslen(c->ssdb_obuf)) {
+        if (writeSSDBoutputBuffer(c) == C_ERR) {
+            handleSSDBconnectionBroken(c, ssdbReplyTargetOf(c));
+            return;
+        }
+        if (!isSSDBoutputFull(c)) resumeSSDBoutputPausedClients();
+    }
+
+    r = c->context->reader;
+    if (r->len - r->pos != 0)
+        ssdbClientUnixHandler(el, fd, c, mask);
+    else
+        updateSSDBwritableEvent(c);
+}
+
+/* don't call this function directly, use sendCommandToSSDB instead.
+ * The command is written at once if possible, what SSDB can't take now
+ * is buffered and written from ssdbClientWritableHandler. */
+static int internalSendCommandToSSDB(client *c, sds finalcmd) {
+    int nwritten = 0;
     serverAssert(c && finalcmd);
     if (!c->context)
         return C_FD_ERR;
-
-    while (finalcmd && sdslen(finalcmd) > 0) {
-        nwritten = write(c->context->fd, finalcmd, sdslen(finalcmd));
-        if (nwritten == -1) {
-            if (errno == EAGAIN || errno == EINTR) {
-                /* Try again later. */
-            } else {
-                if (isSpecialConnection(c))
-                    freeClient(c);
-                else {
-                    serverLog(LL_WARNING, "Error writing to SSDB server: %s", strerror(errno));
-                    closeAndReconnectSSDBconnection(c);
-                }
-                sdsfree(finalcmd);
-                return C_FD_ERR;
-            }
-        } else if (nwritten > 0) {
-            if (nwritten == (signed) sdslen(finalcmd)) {
-                sdsfree(finalcmd);
-                finalcmd = NULL;
-            } else {
-                sdsrange(finalcmd, nwritten, -1);
+    swapTierOutput(sdslen(finalcmd));
+
+    if (sdslen(c->ssdb_obuf) == 0 && c->ssdb_shm_ring) {
+        nwritten = writeSSDBshmRing(c, finalcmd, sdslen(finalcmd));
+    } else if (sdslen(c->ssdb_obuf) == 0) {
+        while ((nwritten = write(c->context->fd, finalcmd, sdslen(finalcmd))) == -1
+               && errno == EINTR);
+        if (nwritten == -1 && errno != EAGAIN) {
+            if (isSpecialConnection(c))
+                freeClient(c);
+            else {
+                serverLog(LL_WARNING, "Error writing to SSDB server: %s", strerror(errno));
+                closeAndReconnectSSDBconnection(c);
             }
+            sdsfree(finalcmd);
+            return C_FD_ERR;
         }
+        if (nwritten == -1) nwritten = 0;
     }
 
+    if (nwritten < (signed) sdslen(finalcmd)) {
+        c->ssdb_obuf = sdscatlen(c->ssdb_obuf, finalcmd+nwritten, sdslen(finalcmd)-nwritten);
+        server.ssdb_output_pending_bytes += sdslen(finalcmd)-nwritten;
+        server.stat_ssdb_write_stalls++;
+        updateSSDBwritableEvent(c);
+    }
+    sdsfree(finalcmd);
+
     return C_OK;
 }
 
@@ -913,21 +1147,24 @@ int sendRepopidToSSDB(client* c, time_t op_time, int op_id, int is_slave_retry)
 /* Querying SSDB server if querying redis fails, Compose the finalcmd if finalcmd is NULL. */
 int sendCommandToSSDB(client *c, sds finalcmd) {
     struct redisCommand *cmd = NULL;
+    client *conn;
+    int ret;
 
     if (!c) {
         sdsfree(finalcmd);
         return C_ERR;
     }
+    conn = ssdbConnectionOf(c);
 
     /* only if ssdb connection status is CONN_SUCCESS, it's safe to send commands to SSDB.
      * for example, on server.master connection, we may need to re-send some failed writes
      * to SSDB after re-connect success, before that, we can't send command to SSDB directly.*/
-    if (!(c->ssdb_conn_flags & CONN_SUCCESS) ||
-        !c->context || c->context->fd <= 0) {
+    if (!(conn->ssdb_conn_flags & CONN_SUCCESS) ||
+        !conn->context || conn->context->fd <= 0) {
         if (isSpecialConnection(c))
             freeClient(c);
         else {
-            if ((c->ssdb_conn_flags & CONN_CONNECTING) ||
+            if ((conn->ssdb_conn_flags & CONN_CONNECTING) ||
                 (c->flags & CLIENT_MASTER && (c->ssdb_conn_flags & CONN_CHECK_REPOPID)))
                 serverLog(LL_DEBUG, "ssdb connection status is connecting");
             else
@@ -952,9 +1189,17 @@ int sendCommandToSSDB(client *c, sds finalcmd) {
     }
 
     serverLog(LL_DEBUG, "sendCommandToSSDB context fd: %d, redis fd:%d",
-              c->context ? c->context->fd : -1, c->fd);
-
-    return internalSendCommandToSSDB(c, finalcmd);
+              conn->context->fd, c->fd);
+
+    ret = internalSendCommandToSSDB(conn, finalcmd);
+    /* SSDB replies in order on a connection, the reply will be matched with
+     * the first client in the waiting list. */
+    if (ret == C_OK && conn != c) {
+        listAddNodeTail(conn->ssdb_pool_waiting, c);
+        c->ssdb_pool_pending++;
+        server.stat_ssdb_pool_requests++;
+    }
+    return ret;
 }
 
 void sendFlushCheckCommandToSSDB(aeEventLoop *el, int fd, void *privdata, int mask) {
@@ -1076,7 +1321,11 @@ static void acceptCommonHandler(int fd, int flags, char *ip) {
     if (server.swap_mode) {
         strncpy(c->client_ip, ip, NET_IP_STR_LEN);
 
-        if (server.is_doing_flushall) {
+        if (server.ssdb_connection_pool_size) {
+            /* the pooled connections are kept connected by serverCron, the
+             * client moves to an idle one when it sends commands. */
+            c->ssdb_pool_conn = server.ssdb_pool[c->id % server.ssdb_connection_pool_size];
+        } else if (server.is_doing_flushall) {
             /* maybe redis is doing flush check before flushall, will connect SSDB later.*/
             c->ssdb_conn_flags |= CONN_CONNECT_FAILED;
             serverLog(LL_DEBUG, "is doing flushall, will connnect SSDB later.");
@@ -1143,8 +1392,8 @@ void handleClientsBlockedOnFlushall(void) {
 
         /* Convert block type. */
         if ((ret = tryBlockingClient(c)) != C_OK) {
-            /* C_NOTSUPPORT_ERR should be handled before. */
-            serverAssert(ret != C_NOTSUPPORT_ERR);
+            /* already replied, like processCommand. */
+            if (ret == C_NOTSUPPORT_ERR) resetClient(c);
             continue;
         }
 
@@ -1637,18 +1886,20 @@ int handleResponseOfDeleteCheckConfirm(client *c) {
 
 void checkSSDBkeyIsDeleted(char* check_reply, struct redisCommand* cmd, int argc, robj** argv) {
     int *indexs = NULL;
-    int numkeys = 0;
+    int numkeys = 0, j;
     sds key;
 
     if (check_reply && !strcmp(check_reply, "check 1")) {
         indexs = getKeysFromCommand(cmd, argv, argc, &numkeys);
 
-        key = argv[indexs[0]]->ptr;
+        for (j = 0; j < numkeys; j++) {
+            key = argv[indexs[j]]->ptr;
 
-        if (NULL == dictFind(EVICTED_DATA_DB->delete_confirm_keys, key))
-            dictAddOrFind(server.maybe_deleted_ssdb_keys, key);
+            if (!(swapKeyState(key) & SWAP_KEY_DELETE_CONFIRM))
+                dictAddOrFind(server.maybe_deleted_ssdb_keys, key);
 
-        serverLog(LL_DEBUG, "cmd: %s, key: %s is added to delete_confirm_keys.", cmd->name, key);
+            serverLog(LL_DEBUG, "cmd: %s, key: %s is added to delete_confirm_keys.", cmd->name, key);
+        }
 
         if (indexs) getKeysFreeResult(indexs);
     }
@@ -1833,9 +2084,8 @@ int removeVisitingSSDBKey(struct redisCommand *cmd, int argc, robj** argv) {
     if ( (cmd->flags & (CMD_READONLY | CMD_WRITE)) &&
          (cmd->flags & CMD_SWAP_MODE) ) {
         keys = getKeysFromCommand(cmd, argv, argc, &numkeys);
-        /* in swap_mode, we only support one key command. */
-        if (numkeys > 0) serverAssert(1 == numkeys);
 
+        /* 'removed' is only meaningful for single key commands. */
         for (j = 0; j < numkeys; j ++) {
             robj* key = argv[keys[j]];
             dictEntry *entry = dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, key->ptr);
@@ -1855,7 +2105,7 @@ int removeVisitingSSDBKey(struct redisCommand *cmd, int argc, robj** argv) {
 
                 /* NOTE: if there are some clients blocked by writing on the same key,
                  * we can't load this key before process them. */
-                if (dictFind(server.hot_keys, key->ptr) &&
+                if ((swapKeyState(key->ptr) & SWAP_KEY_HOT) &&
                     NULL == dictFind(server.db[0].blocking_keys_write_same_ssdbkey, key))
                     loadThisKeyImmediately(key->ptr);
                 removed = 1;
@@ -1891,6 +2141,12 @@ int isSpecialCommand(client *c) {
     if (c && c->cmd
         && c->cmd->proc == migrateCommand)
         return 1;
+    /* the reply is merged by replyToSSDBfanout. */
+    else if (c && c->ssdb_fanout)
+        return 1;
+    /* the reply is built by replyToSSDBscan. */
+    else if (c && c->cmd && c->cmd->proc == scanCommand)
+        return 1;
     else
         return 0;
 }
@@ -1934,7 +2190,11 @@ void handleSSDBReply(client *c, int revert_len) {
         serverLog(LL_DEBUG, "reply integer: %lld", reply->integer);
 
     /* Handle special connections. */
-    if (c == server.ssdb_client) return;
+    if (c == server.ssdb_client) {
+        if (reply && reply->type == REDIS_REPLY_STRING)
+            handleResponseOfTransferDict(reply);
+        return;
+    }
 
     if ((c == server.master || c == server.cached_master) &&
         handleResponseOfReplicationConn(c, reply) == C_OK) return;
@@ -1994,6 +2254,13 @@ void handleSSDBReply(client *c, int revert_len) {
     if (c->btype == BLOCKED_VISITING_SSDB
         || c->btype == BLOCKED_MIGRATING_DUMP) {
 
+        if (c->btype == BLOCKED_VISITING_SSDB)
+            handlePromotingReadReply(c);
+        if (c->ssdb_read_flight) finishSSDBreadFlight(c, 1);
+
+        if (c->ssdb_fanout) replyToSSDBfanout(c);
+        else if (c->cmd->proc == scanCommand) replyToSSDBscan(c);
+
         /* Handle the rest of migrating. */
         if (c->cmd->proc == migrateCommand
             && handleResponseOfMigrateDump(c) != C_OK) {
@@ -2038,14 +2305,41 @@ void handleSSDBReply(client *c, int revert_len) {
     }
 }
 
-int syncReadReply(redisContext *c, void **reply, long long timeout) {
+/* Write the buffered commands of the SSDB connection of 'c' before reading
+ * a reply synchronously. */
+int syncWriteSSDBoutput(client *c, long long timeout) {
+    long long start = mstime();
+
+    if (!c->context) return C_ERR;
+    while (sdslen(c->ssdb_obuf)) {
+        if (writeSSDBoutputBuffer(c) == C_ERR) return C_ERR;
+        if (mstime() - start >= timeout) return C_ERR;
+    }
+    return C_OK;
+}
+
+/* Read what SSDB sent on the connection of 'conn' into its reader. */
+static int ssdbBufferRead(client *conn) {
+    if (!conn->ssdb_shm_ring) return redisBufferRead(conn->context);
+    if (readSSDBshmRing(conn) == REDIS_ERR) return REDIS_ERR;
+
+    /* The doorbell may also be for room in the ring of the commands. */
+    if (sdslen(conn->ssdb_obuf)) {
+        writeSSDBoutputBuffer(conn);
+        if (!isSSDBoutputFull(conn)) resumeSSDBoutputPausedClients();
+    }
+    return REDIS_OK;
+}
+
+int syncReadReply(client *conn, void **reply, long long timeout) {
+    redisContext *c = conn->context;
     void *aux = NULL;
     long long start = mstime();
     long long elapsed;
 
     /* Read until there is a reply */
     do {
-        if (redisBufferRead(c) == REDIS_ERR)
+        if (ssdbBufferRead(conn) == REDIS_ERR)
             return REDIS_ERR;
         if (redisGetReplyFromReader(c,&aux,NULL) == REDIS_ERR)
             return REDIS_ERR;
@@ -2061,22 +2355,85 @@ int syncReadReply(redisContext *c, void **reply, long long timeout) {
     return REDIS_OK;
 }
 
-#define AE_BUFFER_HAVE_UNPROCESSED_DATA AE_WRITABLE
+/* Got a malformed reply from SSDB for the client 'c' on 'conn'. */
+static void resetSSDBconnectionOnError(client *conn, client *c) {
+    if (!conn->ssdb_pool_waiting) {
+        freeClient(c);
+        return;
+    }
+
+    if (c->ssdb_replies[1]) {
+        freeReplyObject(c->ssdb_replies[1]);
+        c->ssdb_replies[1] = NULL;
+    }
+    closeAndReconnectSSDBconnection(conn);
+}
+
+/* Return the client the next reply read on the connection of 'conn' is for:
+ * on a pooled connection it's the first waiting client, the connection itself
+ * reads the replies of the clients which went away. */
+static client *ssdbReplyTargetOf(client *conn) {
+    if (conn->ssdb_pool_waiting && listLength(conn->ssdb_pool_waiting)
+        && listNodeValue(listFirst(conn->ssdb_pool_waiting)))
+        return listNodeValue(listFirst(conn->ssdb_pool_waiting));
+    return conn;
+}
+
+/* The connection of 'conn' is broken while 'c' waits for a reply on it, the
+ * c->revert_len bytes of the reply are already in its buffer. Return 1 if
+ * 'c' or 'conn' must not be used anymore. */
+static int handleSSDBconnectionBroken(client *conn, client *c) {
+    if (conn->ssdb_pool_waiting) {
+        /* the waiting clients are failed by closeAndReconnectSSDBconnection. */
+        closeAndReconnectSSDBconnection(conn);
+        return 1;
+    }
+
+    if (isSpecialConnection(c)) {
+        freeClient(c);
+        return 1;
+    }
+
+    revertClientBufReply(c, c->revert_len);
+    c->revert_len = 0;
+    if (c->ssdb_replies[0]) {
+        freeReplyObject(c->ssdb_replies[0]);
+        c->ssdb_replies[0] = NULL;
+    }
+
+    /* we don't need to reply to server.master and server.delete_confirm_client. */
+    if (c->btype == BLOCKED_VISITING_SSDB
+        || c->btype == BLOCKED_MIGRATING_DUMP
+        || c->btype == BLOCKED_BY_FLUSHALL) {
+        unblockClient(c);
+        resetClient(c);
+        if (c->flags & CLIENT_CLOSE_AFTER_SSDB_WRITE_PROPAGATE) {
+            freeClient(c);
+            return 1;
+        }
+        /* only reply to redis user client when there is a write/read SSDB request. */
+        addReplyError(c, "SSDB disconnect when read");
+    }
+    closeAndReconnectSSDBconnection(c);
+    return 0;
+}
+
 void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
     UNUSED(el);
     UNUSED(mask);
     UNUSED(fd);
 
-    client * c = (client *)privdata;
+    client *conn = (client *)privdata, *c;
     void *aux = NULL;
     int flags = CMD_CALL_FULL;
-    long long duration;
+    long long duration, relay_start;
 
-    if (!c || !c->context)
+    if (!conn || !conn->context)
         return;
+    c = ssdbReplyTargetOf(conn);
 
     int total_reply_len = 0;
-    redisReader *r = c->context->reader;
+    redisReader *r = conn->context->reader;
     char* reply_start;
 #ifdef TEST_CLIENT_BUF
     serverLog(LL_DEBUG, "reader process>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>");
@@ -2088,7 +2445,7 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
         int reply_len = 0;
         int oldlen = r->len;
 
-        if (redisBufferRead(c->context) == REDIS_OK) {
+        if (ssdbBufferRead(conn) == REDIS_OK) {
 
             /* the returned 'aux' may be NULL when redisGetReplyFromReader return REDIS_OK,
              * so we may need to read multiple times to get a completed response. */
@@ -2104,41 +2461,21 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
             }
 #endif
             conn_read_bytes = r->len - oldlen;
+            swapTierInput(conn_read_bytes);
         }
 
         /* encountered a read error. */
-        if (c->context->err) {
-            serverLog(LL_WARNING, "ssdb read error: %s ", c->context->errstr);
+        if (conn->context->err) {
+            serverLog(LL_WARNING, "ssdb read error: %s ", conn->context->errstr);
 
-            if (isSpecialConnection(c)) {
-                freeClient(c);
-                return;
-            } else {
-                if (c->ssdb_replies[0])
-                    revertClientBufReply(c, c->revert_len);
-                else
-                    revertClientBufReply(c, total_reply_len);
-
-                /* we don't need to reply to server.master and server.delete_confirm_client. */
-                if (c->btype == BLOCKED_VISITING_SSDB
-                    || c->btype == BLOCKED_MIGRATING_DUMP
-                    || c->btype == BLOCKED_BY_FLUSHALL) {
-                    unblockClient(c);
-                    resetClient(c);
-                    if (c->flags & CLIENT_CLOSE_AFTER_SSDB_WRITE_PROPAGATE) {
-                        freeClient(c);
-                        return;
-                    }
-                    /* only reply to redis user client when there is a write/read SSDB request. */
-                    addReplyError(c, "SSDB disconnect when read");
-                }
-                closeAndReconnectSSDBconnection(c);
-                goto clean;
-            }
+            /* the second reply is not copied to the client buffer. */
+            if (!c->ssdb_replies[0]) c->revert_len += total_reply_len;
+            if (handleSSDBconnectionBroken(conn, c)) return;
+            goto clean;
         }
 
         /* the returned 'aux' may be NULL when redisGetReplyFromReader return REDIS_OK */
-        if (redisGetSSDBreplyFromReader(c->context, &aux, &reply_len) == REDIS_ERR)
+        if (redisGetSSDBreplyFromReader(conn->context, &aux, &reply_len) == REDIS_ERR)
             break;
         total_reply_len += reply_len;
 
@@ -2148,8 +2485,11 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
                 reply_start = r->buf+r->pos-reply_len;
                 /* Forbid to reply to client when cmd is spacial,
                    the intermedia will be handled. */
-                if (!isSpecialConnection(c) && !isSpecialCommand(c))
+                if (!isSpecialConnection(c) && !isSpecialCommand(c)) {
                     addReplyString(c, reply_start, reply_len);
+                    if (c->ssdb_read_flight)
+                        feedSSDBreadFlight(c, reply_start, reply_len);
+                }
 #ifdef TEST_CLIENT_BUF
                 tmp = sdscatlen(tmp, reply_start, reply_len);
 #endif
@@ -2164,7 +2504,7 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
                 /* NOTE: discardSSDBreaderBuffer may change r->pos */
                 if (r->pos >= 1024 &&
                     (r->pos > (r->len - r->pos)/10 || r->pos > 1024000))
-                    discardSSDBreaderBuffer(c->context->reader, 1024);
+                    discardSSDBreaderBuffer(conn->context->reader, 1024);
             }
         }
 
@@ -2176,6 +2516,9 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
             if (!c->ssdb_replies[0]) {
                 c->revert_len += total_reply_len;
             }
+            /* the rest of the reply will trigger a readable event. */
+            if (!sdslen(conn->ssdb_obuf))
+                aeDeleteFileEvent(server.el, conn->context->fd, AE_WRITABLE);
             return;
         }
 
@@ -2197,7 +2540,7 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
 
             /* the returned 'aux' may be NULL when redisGetReplyFromReader return REDIS_OK */
             /* the 'redisBufferRead' may read muliple responses, so we just try to get the sencond replies. */
-            if (redisGetSSDBreplyFromReader(c->context, &aux, &reply_len) == REDIS_ERR)
+            if (redisGetSSDBreplyFromReader(conn->context, &aux, &reply_len) == REDIS_ERR)
                 break;
             total_reply_len += reply_len;
         }
@@ -2217,16 +2560,16 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
             /* NOTE: discardSSDBreaderBuffer may change r->pos */
             if (r->pos >= 1024 &&
                 (r->pos > (r->len - r->pos)/10 || r->pos > 1024000))
-                discardSSDBreaderBuffer(c->context->reader, 1024);
+                discardSSDBreaderBuffer(conn->context->reader, 1024);
 
             break;
         }
     } while (aux == NULL);
 
     /* this is a protocol error, free the client. */
-    if (c->context->err) {
+    if (conn->context->err) {
         serverLog(LL_WARNING, "redis reader protocol error!");
-        freeClient(c);
+        resetSSDBconnectionOnError(conn, c);
         return;
     }
     serverAssert(c->ssdb_replies[0] && c->ssdb_replies[1]);
@@ -2238,7 +2581,7 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
 
         if ( reply->type != REDIS_REPLY_ARRAY ||
              (element->type != REDIS_REPLY_STRING || (strcmp(element->str, "check 1") && strcmp(element->str, "check 0"))) ) {
-            freeClient(c);
+            resetSSDBconnectionOnError(conn, c);
             return;
         }
     }
@@ -2246,11 +2589,17 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
     /* the redisBufferRead function may read more than two ssdb replies, the rest replies
      * will be stored in the buffer of c->context->reader, use writeable fd event
      * to trigger this callback again, to avoid the rest replies not processed. */
-    if (r->len - r->pos != 0) {
-        aeCreateFileEvent(server.el, c->context->fd,
-                              AE_BUFFER_HAVE_UNPROCESSED_DATA, ssdbClientUnixHandler, c);
-    } else {
-        aeDeleteFileEvent(server.el, c->context->fd, AE_BUFFER_HAVE_UNPROCESSED_DATA);
+    updateSSDBwritableEvent(conn);
+
+    /* the reply is complete, the next one is for the next waiting client. */
+    if (conn->ssdb_pool_waiting) {
+        if (listLength(conn->ssdb_pool_waiting))
+            listDelNode(conn->ssdb_pool_waiting, listFirst(conn->ssdb_pool_waiting));
+        if (c == conn) {
+            server.stat_ssdb_pool_orphaned++;
+            goto clean;
+        }
+        c->ssdb_pool_pending--;
     }
 
 #ifdef TEST_CLIENT_BUF
@@ -2279,7 +2628,9 @@ void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
         }
     }
 
+    relay_start = ustime();
     handleSSDBReply(c, c->revert_len);
+    swapLatencyRecord(SWAP_LATENCY_SSDB_REPLY, ustime()-relay_start);
 
 clean:
     c->revert_len = 0;
@@ -2313,6 +2664,62 @@ void connectSepecialSSDBclients() {
     server.slave_ssdb_load_evict_client = createSpecialSSDBclient();
     server.delete_confirm_client = createSpecialSSDBclient();
     server.expired_delete_client = createSpecialSSDBclient();
+
+    if (server.ssdb_connection_pool_size) {
+        int j;
+
+        server.ssdb_pool = zmalloc(sizeof(client*)*server.ssdb_connection_pool_size);
+        for (j = 0; j < server.ssdb_connection_pool_size; j++) {
+            server.ssdb_pool[j] = createSpecialSSDBclient();
+            server.ssdb_pool[j]->ssdb_pool_waiting = listCreate();
+        }
+    }
+}
+
+static int isSSDBpoolConnectionUp(client *conn) {
+    return (conn->ssdb_conn_flags & CONN_SUCCESS) && conn->context
+        && conn->context->fd > 0;
+}
+
+/* Return the client owning the SSDB connection used by the next command
+ * of 'c'.
+ *
+ * SSDB runs the commands of a link one at a time, so a pooled connection
+ * serializes the commands sent on it: the clients move to an idle connection
+ * when they have one, to the connection with the fewest waiting replies when
+ * all are busy. At most ssdb-connection-pool-size commands of the pooled
+ * clients run in SSDB at the same time. A client still waiting for replies
+ * stays on its connection, so that its commands and the flush/write checks
+ * sent after them are answered in order. */
+client *ssdbConnectionOf(client *c) {
+    client *best = c->ssdb_pool_conn, *conn;
+    int j, start;
+
+    if (!best) return c;
+    if (c->ssdb_pool_pending
+        || (isSSDBpoolConnectionUp(best) && !listLength(best->ssdb_pool_waiting)))
+        return best;
+
+    start = c->id % server.ssdb_connection_pool_size;
+    for (j = 0; j < server.ssdb_connection_pool_size; j++) {
+        conn = server.ssdb_pool[(start+j) % server.ssdb_connection_pool_size];
+        if (!isSSDBpoolConnectionUp(conn)) continue;
+        if (!isSSDBpoolConnectionUp(best)
+            || listLength(conn->ssdb_pool_waiting) < listLength(best->ssdb_pool_waiting))
+            best = conn;
+        if (!listLength(best->ssdb_pool_waiting)) break;
+    }
+    c->ssdb_pool_conn = best;
+    return best;
+}
+
+unsigned long ssdbPoolWaitingReplies(void) {
+    unsigned long waiting = 0;
+    int j;
+
+    for (j = 0; j < server.ssdb_connection_pool_size; j++)
+        waiting += listLength(server.ssdb_pool[j]->ssdb_pool_waiting);
+    return waiting;
 }
 
 static void freeClientArgv(client *c) {
@@ -2323,6 +2730,7 @@ static void freeClientArgv(client *c) {
             decrRefCount(c->argv[j]);
     c->argc = 0;
     c->cmd = NULL;
+    if (server.swap_mode) freeSSDBfanout(c);
 }
 
 /* Close all the slaves connections. This is useful in chained replication
@@ -2523,6 +2931,7 @@ void freeClient(client *c) {
 
     /* Free data structures. */
     listRelease(c->reply);
+    if (server.swap_mode) forgetPromotingRead(c);
     freeClientArgv(c);
 
     /* Unlink the client: this will close the socket, remove the I/O
@@ -2575,6 +2984,8 @@ void freeClient(client *c) {
     if (server.swap_mode) {
         if (c->ssdb_replies[0]) freeReplyObject(c->ssdb_replies[0]);
         if (c->ssdb_replies[1]) freeReplyObject(c->ssdb_replies[1]);
+        sdsfree(c->ssdb_obuf);
+        sdsfree(c->coaccess_key);
 
         resetSpecialCient(c);
     }
@@ -2739,6 +3150,7 @@ void resetClient(client *c) {
     //serverLog(LL_DEBUG, "resetClient called: redis fd: %d, context fd:%d", c->fd, c->context ? c->context->fd : -1);
     redisCommandProc *prevcmd = c->cmd ? c->cmd->proc : NULL;
 
+    if (server.swap_mode) forgetPromotingRead(c);
     freeClientArgv(c);
     c->reqtype = 0;
     c->multibulklen = 0;
@@ -3023,6 +3435,9 @@ void processInputBuffer(client *c) {
         /* Immediately abort if the client is in the middle of something. */
         if (c->flags & CLIENT_BLOCKED) break;
 
+        /* Wait for SSDB to take the commands already sent to it. */
+        if (pauseClientIfSSDBoutputFull(c)) break;
+
         /* CLIENT_CLOSE_AFTER_REPLY closes the connection once the reply is
          * written to the client. Make sure to not let the reply grow after
          * this flag has been set (i.e. don't process more commands).
@@ -326,6 +326,55 @@ ssize_t rdbSaveLzfStringObject(rio *rdb, unsigned char *s, size_t len) {
     return nwritten;
 }
 
+/* Like rdbSaveLzfStringObject() but with LZF primed by the transfer
+ * dictionary, only used for the payloads sent to SSDB (see transdict.c):
+ * [RDB_ENC_LZF_DICT][dict version][compressed len][original len][data] */
+ssize_t rdbSaveLzfDictStringObject(rio *rdb, unsigned char *s, size_t len) {
+    const char *dict;
+    uint32_t version;
+    size_t dictlen, comprlen, outlen;
+    unsigned char byte, *buf, *out;
+    ssize_t n, nwritten = 0;
+
+    if ((dict = transferDictForEncoding(&version,&dictlen)) == NULL) return 0;
+
+    /* We require at least four bytes compression for this to be worth it */
+    if (len <= 4) return 0;
+    outlen = len-4;
+
+    /* lzf_compress_dict() wants the dictionary and the input contiguous. */
+    buf = zmalloc(dictlen+len);
+    memcpy(buf,dict,dictlen);
+    memcpy(buf+dictlen,s,len);
+    out = zmalloc(outlen+1);
+    comprlen = lzf_compress_dict(buf,dictlen,len,out,outlen);
+    zfree(buf);
+    if (comprlen == 0) {
+        zfree(out);
+        return 0;
+    }
+
+    byte = (RDB_ENCVAL<<6)|RDB_ENC_LZF_DICT;
+    if ((n = rdbWriteRaw(rdb,&byte,1)) == -1) goto writeerr;
+    nwritten += n;
+    if ((n = rdbSaveLen(rdb,version)) == -1) goto writeerr;
+    nwritten += n;
+    if ((n = rdbSaveLen(rdb,comprlen)) == -1) goto writeerr;
+    nwritten += n;
+    if ((n = rdbSaveLen(rdb,len)) == -1) goto writeerr;
+    nwritten += n;
+    if ((n = rdbWriteRaw(rdb,out,comprlen)) == -1) goto writeerr;
+    nwritten += n;
+    zfree(out);
+
+    transferDictCountEncoded(len,nwritten);
+    return nwritten;
+
+writeerr:
+    zfree(out);
+    return -1;
+}
+
 /* Load an LZF compressed string in RDB format. The returned value
  * changes according to 'flags'. For more info check the
  * rdbGenericLoadStringObject() function. */
@@ -370,6 +419,59 @@ err:
     return NULL;
 }
 
+/* Load a string encoded with rdbSaveLzfDictStringObject(). NULL is returned
+ * if the dictionary version is unknown, that is, the payload was encoded
+ * with a dictionary this instance no longer (or never) had. */
+void *rdbLoadLzfDictStringObject(rio *rdb, int flags, size_t *lenptr) {
+    int plain = flags & RDB_LOAD_PLAIN;
+    int sds = flags & RDB_LOAD_SDS;
+    uint64_t version, len, clen;
+    const char *dict;
+    size_t dictlen;
+    unsigned char *c = NULL, *buf = NULL;
+    char *val;
+
+    if ((version = rdbLoadLen(rdb,NULL)) == RDB_LENERR) return NULL;
+    if ((clen = rdbLoadLen(rdb,NULL)) == RDB_LENERR) return NULL;
+    if ((len = rdbLoadLen(rdb,NULL)) == RDB_LENERR) return NULL;
+    if (version > UINT32_MAX ||
+        (dict = transferDictLookup(version,&dictlen)) == NULL) {
+        serverLog(LL_WARNING, "Unknown transfer dictionary version: %llu",
+                  (unsigned long long)version);
+        goto err;
+    }
+
+    c = zmalloc(clen);
+    if (rioRead(rdb,c,clen) == 0) goto err;
+
+    /* The dictionary is the prefix of the decompression buffer. */
+    buf = zmalloc(dictlen+len);
+    memcpy(buf,dict,dictlen);
+    if (lzf_decompress_dict(c,clen,buf,dictlen,len) != len) goto err;
+    zfree(c);
+
+    if (plain) {
+        val = zmalloc(len);
+        memcpy(val,buf+dictlen,len);
+        if (lenptr) *lenptr = len;
+    } else {
+        val = sdsnewlen(buf+dictlen,len);
+    }
+    zfree(buf);
+    transferDictCountDecoded(1);
+
+    if (plain || sds) {
+        return val;
+    } else {
+        return createObject(OBJ_STRING,val);
+    }
+err:
+    transferDictCountDecoded(0);
+    zfree(c);
+    zfree(buf);
+    return NULL;
+}
+
 /* Save a string object as [len][data] on disk. If the object is a string
  * representation of an integer value we try to save it in a special form */
 ssize_t rdbSaveRawString(rio *rdb, unsigned char *s, size_t len) {
@@ -385,6 +487,14 @@ ssize_t rdbSaveRawString(rio *rdb, unsigned char *s, size_t len) {
         }
     }
 
+    /* Payloads for SSDB try the shared transfer dictionary first, it
+     * returns 0 when there is no dictionary to use. */
+    if (len > 20) {
+        n = rdbSaveLzfDictStringObject(rdb,s,len);
+        if (n == -1) return -1;
+        if (n > 0) return n;
+    }
+
     /* Try LZF compression - under 20 bytes it's unable to compress even
      * aaaaaaaaaaaaaaaaaa so skip it */
     if (server.rdb_compression && len > 20) {
@@ -464,6 +574,8 @@ void *rdbGenericLoadStringObject(rio *rdb, int flags, size_t *lenptr) {
             return rdbLoadIntegerObject(rdb,len,flags,lenptr);
         case RDB_ENC_LZF:
             return rdbLoadLzfStringObject(rdb,flags,lenptr);
+        case RDB_ENC_LZF_DICT:
+            return rdbLoadLzfDictStringObject(rdb,flags,lenptr);
         default:
             rdbExitReportCorruptRDB("Unknown RDB string encoding type %d",len);
         }
@@ -942,6 +1054,20 @@ int rdbSaveRio(rio *rdb, int *error, int flags, rdbSaveInfo *rsi) {
     }
     di = NULL; /* So that we don't release it again on error. */
 
+    /* The keys of db 0 whose copy is still in SSDB, after the databases so
+     * they are found in db 0 when loaded, see loadKeptKeyCopy(). */
+    if (server.swap_mode && dictSize(server.ssdb_kept_keys)) {
+        di = dictGetIterator(server.ssdb_kept_keys);
+        while((de = dictNext(di)) != NULL) {
+            sds keystr = dictGetKey(de);
+
+            if (rdbSaveAuxField(rdb,"ssdb-kept-key",13,keystr,sdslen(keystr))
+                == -1) goto werr;
+        }
+        dictReleaseIterator(di);
+        di = NULL;
+    }
+
     /* EOF opcode */
     if (rdbSaveType(rdb,RDB_OPCODE_EOF) == -1) goto werr;
 
@@ -1589,6 +1715,8 @@ int rdbLoadRio(rio *rdb, rdbSaveInfo *rsi) {
                 }
             } else if (!strcasecmp(auxkey->ptr,"repl-offset")) {
                 if (rsi) rsi->repl_offset = strtoll(auxval->ptr,NULL,10);
+            } else if (!strcasecmp(auxkey->ptr,"ssdb-kept-key")) {
+                if (server.swap_mode) loadKeptKeyCopy(auxval->ptr);
             } else {
                 /* We ignore fields we don't understand, as by AUX field
                  * contract. */
@@ -0,0 +1,220 @@
+/* Read flights: coalescing of identical reads of a cold key.
+ *
+ * Every client visiting SSDB sends its own command, so when a popular key
+ * was just evicted, thousands of clients may read it from RocksDB at once.
+ * With ssdb-read-coalescing-window-us set, a read-only command sent to SSDB
+ * becomes the leader of a flight, identified by the command and its
+ * arguments. The same command from another client during the window doesn't
+ * visit SSDB: the client joins the flight as a follower, and is blocked
+ * until the reply of the leader is in, which it gets a copy of.
+ *
+ * A follower only joins if no write could have reached SSDB after the
+ * leader was sent (server.ssdb_write_epoch is unchanged), and before the
+ * reply started arriving. If the leader fails, its followers get an error.
+ *
+ * Flights are also started when the reply cache is enabled, to capture the
+ * reply, see replycache.c.
+ */
+
+#include "server.h"
+
+/* Followers per flight, to bound the work of a single reply. */
+#define READ_FLIGHT_MAX_FOLLOWERS 1024
+
+typedef struct ssdbReadFlight {
+    sds sig;                    /* Command and arguments. */
+    client *leader;
+    list *followers;
+    long long start;            /* ustime() the leader was sent. */
+    unsigned long long epoch;   /* server.ssdb_write_epoch at that time. */
+    int closed;                 /* Not in rf.flights, no more followers. */
+    sds reply;                  /* Reply of the leader, once it's read. */
+} ssdbReadFlight;
+
+/* sig -> flight, the key is owned by the flight. */
+static dictType readFlightDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    NULL,                       /* key destructor */
+    NULL                        /* val destructor */
+};
+
+static struct {
+    dict *flights;
+    long long stat_flights;     /* Flights which had followers. */
+    long long stat_coalesced;   /* Reads served by the reply of a leader. */
+    long long stat_failed;      /* Followers whose leader failed. */
+} rf;
+
+/* Identify the command of 'c' and its arguments. */
+sds ssdbReadSignature(client *c) {
+    sds sig = sdsnew(c->cmd->name);
+    int j;
+
+    for (j = 1; j < c->argc; j++) {
+        robj *o = getDecodedObject(c->argv[j]);
+
+        sig = sdscatfmt(sig, "\r\n%U:", (unsigned long long)sdslen(o->ptr));
+        sig = sdscatsds(sig, o->ptr);
+        decrRefCount(o);
+    }
+    return sig;
+}
+
+static int readFlightCandidate(client *c) {
+    return (server.ssdb_read_coalescing_window_us || replyCacheable(c))
+        && !server.masterhost && !server.is_doing_flushall
+        && (c->cmd->flags & CMD_READONLY)
+        && !(c->flags & (CLIENT_MASTER|CLIENT_MULTI|CLIENT_LUA))
+        && !c->ssdb_fanout;
+}
+
+static void closeReadFlight(ssdbReadFlight *f) {
+    if (f->closed) return;
+    dictDelete(rf.flights, f->sig);
+    f->closed = 1;
+}
+
+static void freeReadFlight(ssdbReadFlight *f) {
+    closeReadFlight(f);
+    if (f->leader) f->leader->ssdb_read_flight = NULL;
+    listRelease(f->followers);
+    sdsfree(f->sig);
+    sdsfree(f->reply);
+    zfree(f);
+}
+
+/* Make 'c' wait for the reply of an identical read in flight. Return C_OK
+ * if it's blocked as a follower, C_ERR if it must visit SSDB itself. */
+int joinSSDBreadFlight(client *c) {
+    ssdbReadFlight *f;
+    dictEntry *de;
+    sds sig;
+
+    if (!server.ssdb_read_coalescing_window_us || !readFlightCandidate(c)
+        || !rf.flights || !dictSize(rf.flights))
+        return C_ERR;
+
+    sig = ssdbReadSignature(c);
+    de = dictFind(rf.flights, sig);
+    sdsfree(sig);
+    if (!de) return C_ERR;
+
+    f = dictGetVal(de);
+    if (f->epoch != server.ssdb_write_epoch
+        || ustime() - f->start > server.ssdb_read_coalescing_window_us)
+    {
+        closeReadFlight(f);
+        return C_ERR;
+    }
+    if (listLength(f->followers) >= READ_FLIGHT_MAX_FOLLOWERS) return C_ERR;
+
+    if (!listLength(f->followers)) rf.stat_flights++;
+    listAddNodeTail(f->followers, c);
+    c->ssdb_read_flight = f;
+    c->bpop.timeout = server.client_visiting_ssdb_timeout + mstime();
+    blockClient(c, BLOCKED_SSDB_READ_FLIGHT);
+    return C_OK;
+}
+
+/* 'c' just sent its read to SSDB, let identical reads join it. */
+void startSSDBreadFlight(client *c) {
+    ssdbReadFlight *f;
+
+    if (!readFlightCandidate(c)) return;
+    if (!rf.flights) rf.flights = dictCreate(&readFlightDictType, NULL);
+
+    f = zmalloc(sizeof(*f));
+    f->sig = ssdbReadSignature(c);
+    if (dictAdd(rf.flights, f->sig, f) != DICT_OK) {
+        /* An older flight that can't be joined anymore is still waiting. */
+        sdsfree(f->sig);
+        zfree(f);
+        return;
+    }
+    f->leader = c;
+    f->followers = listCreate();
+    f->start = ustime();
+    f->epoch = server.ssdb_write_epoch;
+    f->closed = 0;
+    f->reply = NULL;
+    c->ssdb_read_flight = f;
+}
+
+/* Called with every part of the reply of the leader 'c' copied to its
+ * output buffer. */
+void feedSSDBreadFlight(client *c, const char *s, size_t len) {
+    ssdbReadFlight *f = c->ssdb_read_flight;
+
+    closeReadFlight(f);
+    if (!listLength(f->followers) && !replyCacheable(c)) {
+        freeReadFlight(f);
+        return;
+    }
+    if (!f->reply) f->reply = sdsempty();
+    f->reply = sdscatlen(f->reply, s, len);
+}
+
+/* Return 1 if the reply SSDB sent to 'c' can be served again later. */
+static int readFlightReplyCacheable(client *c, ssdbReadFlight *f) {
+    redisReply *check = c->ssdb_replies[1];
+
+    /* "check 1" means the key may not exist in SSDB anymore. */
+    return f->reply && f->epoch == server.ssdb_write_epoch
+        && replyCacheable(c) && c->first_key_index
+        && c->ssdb_replies[0] && c->ssdb_replies[0]->type != REDIS_REPLY_ERROR
+        && check && check->type == REDIS_REPLY_ARRAY && check->elements
+        && check->element[0]->type == REDIS_REPLY_STRING
+        && !strcmp(check->element[0]->str, "check 0");
+}
+
+/* The leader 'c' got its reply ('ok') or failed, reply to its followers and
+ * unblock them. */
+void finishSSDBreadFlight(client *c, int ok) {
+    ssdbReadFlight *f = c->ssdb_read_flight;
+    listNode *ln;
+
+    closeReadFlight(f);
+    if (ok && readFlightReplyCacheable(c, f))
+        replyCacheStore(c->argv[c->first_key_index]->ptr, f->sig, f->reply);
+    while ((ln = listFirst(f->followers)) != NULL) {
+        client *follower = listNodeValue(ln);
+
+        listDelNode(f->followers, ln);
+        follower->ssdb_read_flight = NULL;
+        unblockClient(follower);
+        if (ok && f->reply) {
+            addReplyString(follower, f->reply, sdslen(f->reply));
+            server.stat_numcommands++;
+            rf.stat_coalesced++;
+        } else {
+            addReplyError(follower, "SSDB disconnect when read");
+            rf.stat_failed++;
+        }
+        resetClient(follower);
+    }
+    freeReadFlight(f);
+}
+
+/* The follower 'c' is unblocked before the reply of the leader. */
+void leaveSSDBreadFlight(client *c) {
+    ssdbReadFlight *f = c->ssdb_read_flight;
+    listNode *ln = listSearchKey(f->followers, c);
+
+    if (ln) listDelNode(f->followers, ln);
+    c->ssdb_read_flight = NULL;
+}
+
+sds genSSDBreadFlightInfoString(sds info) {
+    return sdscatprintf(info,
+        "read_flights_in_progress:%lu\r\n"
+        "read_flights:%lld\r\n"
+        "reads_coalesced:%lld\r\n"
+        "reads_coalesced_failed:%lld\r\n",
+        rf.flights ? dictSize(rf.flights) : 0,
+        rf.stat_flights,
+        rf.stat_coalesced,
+        rf.stat_failed);
+}
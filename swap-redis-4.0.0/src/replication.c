@@ -2272,8 +2272,10 @@ int cancelReplicationHandshake(void) {
 void replicationSetMaster(char *ip, int port) {
     int was_master = server.masterhost == NULL;
 
-    if (server.swap_mode)
+    if (server.swap_mode) {
         cleanSpecialClientsAndIntermediateKeys(0);
+        replyCacheFlush();
+    }
 
     sdsfree(server.masterhost);
     server.masterhost = sdsnew(ip);
@@ -0,0 +1,208 @@
+/* Reply cache: recent replies of SSDB to reads of cold keys.
+ *
+ * Many cold keys are read a few times in a burst without ever getting hot
+ * enough to be loaded, and every read pays a round trip to SSDB. With
+ * ssdb-reply-cache-size set, the raw replies of read-only commands on cold
+ * keys are kept, indexed by the command and its arguments, and the same
+ * command is then answered from the cache without visiting SSDB.
+ *
+ * The replies come from the read flights (see readflight.c), and are only
+ * cached if no write could have reached SSDB while the read was in flight.
+ * All the replies of a key are dropped when a write to the key is sent to
+ * SSDB, and when the key is transferred or loaded. The least recently used
+ * replies are evicted to keep the cache under its size. Time dependent and
+ * random commands (TTL, SRANDMEMBER...) are never cached.
+ */
+
+#include "server.h"
+
+/* A single reply can't take more than this fraction of the cache. */
+#define REPLY_CACHE_MAX_ENTRY_RATIO 8
+/* Estimated overhead of an entry in the dicts and lists. */
+#define REPLY_CACHE_ENTRY_OVERHEAD 96
+
+typedef struct replyCacheEntry {
+    sds key;                    /* The cold key. */
+    sds sig;                    /* Command and arguments, see ssdbReadSignature(). */
+    sds reply;
+    listNode *lru;              /* Node in rc.lru, the head is the most recent. */
+    listNode *bykey;            /* Node in the list of the key in rc.keys. */
+    size_t size;
+} replyCacheEntry;
+
+static void dictListDestructor(void *privdata, void *val) {
+    DICT_NOTUSED(privdata);
+    listRelease((list *)val);
+}
+
+/* sig -> replyCacheEntry, the key is owned by the entry. */
+static dictType replyCacheDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    NULL,                       /* key destructor */
+    NULL                        /* val destructor */
+};
+
+/* cold key -> list of replyCacheEntry. */
+static dictType replyCacheKeysDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    dictListDestructor          /* val destructor */
+};
+
+static struct {
+    dict *entries;
+    dict *keys;
+    list *lru;
+    size_t used;
+    long long stat_hits;
+    long long stat_misses;
+    long long stat_invalidations;
+    long long stat_evictions;
+} rc;
+
+static void freeReplyCacheEntry(replyCacheEntry *e) {
+    dictEntry *de = dictFind(rc.keys, e->key);
+    list *l = dictGetVal(de);
+
+    dictDelete(rc.entries, e->sig);
+    listDelNode(rc.lru, e->lru);
+    listDelNode(l, e->bykey);
+    if (!listLength(l)) dictDelete(rc.keys, e->key);
+    rc.used -= e->size;
+    sdsfree(e->key);
+    sdsfree(e->sig);
+    sdsfree(e->reply);
+    zfree(e);
+}
+
+static void trimReplyCache(size_t limit) {
+    while (rc.lru && rc.used > limit && listLength(rc.lru)) {
+        freeReplyCacheEntry(listNodeValue(listLast(rc.lru)));
+        rc.stat_evictions++;
+    }
+}
+
+/* Drop everything, or just what's over the size after CONFIG SET. */
+void replyCacheResize(void) {
+    trimReplyCache((size_t)server.ssdb_reply_cache_size);
+}
+
+void replyCacheFlush(void) {
+    trimReplyCache(0);
+}
+
+/* Return 1 if the reply of the command of 'c' may be cached. */
+int replyCacheable(client *c) {
+    return server.ssdb_reply_cache_size
+        && !(c->cmd->flags & CMD_RANDOM)
+        && c->cmd->proc != ttlCommand
+        && c->cmd->proc != pttlCommand;
+}
+
+/* Reply to 'c' from the cache. Return C_OK if it got its reply. */
+int replyCacheLookup(client *c) {
+    dictEntry *de;
+    replyCacheEntry *e;
+    sds sig;
+
+    if (!rc.entries || !dictSize(rc.entries) || !replyCacheable(c)
+        || server.masterhost || (c->flags & (CLIENT_MULTI|CLIENT_LUA)))
+        return C_ERR;
+
+    sig = ssdbReadSignature(c);
+    de = dictFind(rc.entries, sig);
+    sdsfree(sig);
+    if (!de) {
+        rc.stat_misses++;
+        return C_ERR;
+    }
+
+    e = dictGetVal(de);
+    listDelNode(rc.lru, e->lru);
+    listAddNodeHead(rc.lru, e);
+    e->lru = listFirst(rc.lru);
+    addReplyString(c, e->reply, sdslen(e->reply));
+    rc.stat_hits++;
+    return C_OK;
+}
+
+/* Cache the reply of SSDB to the command 'sig' on the cold 'key'. */
+void replyCacheStore(sds key, sds sig, sds reply) {
+    size_t size = sdsAllocSize(sig)+sdsAllocSize(reply)+sdsAllocSize(key)+
+        sizeof(replyCacheEntry)+REPLY_CACHE_ENTRY_OVERHEAD;
+    replyCacheEntry *e;
+    dictEntry *de;
+    list *l;
+
+    if (size > (size_t)server.ssdb_reply_cache_size/REPLY_CACHE_MAX_ENTRY_RATIO)
+        return;
+
+    if (!rc.entries) {
+        rc.entries = dictCreate(&replyCacheDictType, NULL);
+        rc.keys = dictCreate(&replyCacheKeysDictType, NULL);
+        rc.lru = listCreate();
+    }
+    if ((de = dictFind(rc.entries, sig)) != NULL)
+        freeReplyCacheEntry(dictGetVal(de));
+
+    e = zmalloc(sizeof(*e));
+    e->key = sdsdup(key);
+    e->sig = sdsdup(sig);
+    e->reply = sdsdup(reply);
+    e->size = size;
+    dictAdd(rc.entries, e->sig, e);
+    listAddNodeHead(rc.lru, e);
+    e->lru = listFirst(rc.lru);
+
+    if ((de = dictFind(rc.keys, key)) == NULL) {
+        l = listCreate();
+        dictAdd(rc.keys, sdsdup(key), l);
+    } else {
+        l = dictGetVal(de);
+    }
+    listAddNodeTail(l, e);
+    e->bykey = listLast(l);
+
+    rc.used += size;
+    trimReplyCache((size_t)server.ssdb_reply_cache_size);
+}
+
+/* The value of 'key' in SSDB changed, or it's not a cold key anymore. */
+void replyCacheInvalidate(sds key) {
+    dictEntry *de;
+    list *l;
+
+    if (!rc.keys || !dictSize(rc.keys)) return;
+    if ((de = dictFind(rc.keys, key)) == NULL) return;
+
+    /* The list is released with the last entry. */
+    l = dictGetVal(de);
+    while (listLength(l) > 1)
+        freeReplyCacheEntry(listNodeValue(listFirst(l)));
+    freeReplyCacheEntry(listNodeValue(listFirst(l)));
+    rc.stat_invalidations++;
+}
+
+sds genReplyCacheInfoString(sds info) {
+    return sdscatprintf(info,
+        "reply_cache_entries:%lu\r\n"
+        "reply_cache_keys:%lu\r\n"
+        "reply_cache_bytes:%lu\r\n"
+        "reply_cache_hits:%lld\r\n"
+        "reply_cache_misses:%lld\r\n"
+        "reply_cache_invalidations:%lld\r\n"
+        "reply_cache_evictions:%lld\r\n",
+        rc.entries ? dictSize(rc.entries) : 0,
+        rc.keys ? dictSize(rc.keys) : 0,
+        (unsigned long)rc.used,
+        rc.stat_hits,
+        rc.stat_misses,
+        rc.stat_invalidations,
+        rc.stat_evictions);
+}
@@ -534,6 +534,18 @@ int luaRedisGenericCommand(lua_State *lua, int raise_error) {
         }
     }
 
+    /* In swap mode the keys declared by the script were loaded from SSDB
+     * before it started, see blockForPreloadingKeys(). The other keys may
+     * still be in SSDB, the script only runs in redis. */
+    if (server.swap_mode && !server.loading &&
+        !(server.lua_caller->flags & CLIENT_MASTER) &&
+        isCommandUsingSSDBkeys(c->cmd,c->argv,c->argc))
+    {
+        luaPushError(lua,
+            "Lua script attempted to access a key in SSDB it didn't declare");
+        goto cleanup;
+    }
+
     /* If we are using single commands replication, we need to wrap what
      * we propagate into a MULTI/EXEC block, so that it will be atomic like
      * a Lua script in the context of AOF and slaves. */
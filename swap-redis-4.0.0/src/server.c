@@ -143,10 +143,9 @@ struct redisCommand redisCommandTable[] = {
     {"psetex",psetexCommand,4,"wmJ",0,NULL,1,1,1,0,0},
     {"append",appendCommand,3,"wmJ",0,NULL,1,1,1,0,0},
     {"strlen",strlenCommand,2,"rFJ",0,NULL,1,1,1,0,0},
-    /* in swap mode, we only support one key command */
-    {"del",delCommand,2,"wJ",0,NULL,1,1,1,0,0},
+    {"del",delCommand,-2,"wJ",0,NULL,1,-1,1,0,0},
     {"unlink",unlinkCommand,2,"wF",0,NULL,1,1,1,0,0},
-    {"exists",existsCommand,2,"rFJ",0,NULL,1,1,1,0,0},
+    {"exists",existsCommand,-2,"rFJ",0,NULL,1,-1,1,0,0},
     {"setbit",setbitCommand,4,"wmJ",0,NULL,1,1,1,0,0},
     {"getbit",getbitCommand,3,"rFJ",0,NULL,1,1,1,0,0},
     {"bitfield",bitfieldCommand,-2,"wm",0,NULL,1,1,1,0,0},
@@ -159,7 +158,7 @@ struct redisCommand redisCommandTable[] = {
     {"incr",incrCommand,2,"wmFJ",0,NULL,1,1,1,0,0},
 #endif
     {"decr",decrCommand,2,"wmFJ",0,NULL,1,1,1,0,0},
-    {"mget",mgetCommand,-2,"rF",0,NULL,1,-1,1,0,0},
+    {"mget",mgetCommand,-2,"rFJ",0,NULL,1,-1,1,0,0},
     {"rpush",rpushCommand,-3,"wmFJ",0,NULL,1,1,1,0,0},
     {"lpush",lpushCommand,-3,"wmFJ",0,NULL,1,1,1,0,0},
     {"rpushx",rpushxCommand,-3,"wmFJ",0,NULL,1,1,1,0,0},
@@ -232,7 +231,7 @@ struct redisCommand redisCommandTable[] = {
     {"decrby",decrbyCommand,3,"wmFJ",0,NULL,1,1,1,0,0},
     {"incrbyfloat",incrbyfloatCommand,3,"wmFJ",0,NULL,1,1,1,0,0},
     {"getset",getsetCommand,3,"wmJ",0,NULL,1,1,1,0,0},
-    {"mset",msetCommand,-3,"wm",0,NULL,1,-1,2,0,0},
+    {"mset",msetCommand,-3,"wmJ",0,NULL,1,-1,2,0,0},
     {"msetnx",msetnxCommand,-3,"wm",0,NULL,1,-1,2,0,0},
     {"randomkey",randomkeyCommand,1,"rR",0,NULL,0,0,0,0,0},
     {"select",selectCommand,2,"lF",0,NULL,0,0,0,0,0},
@@ -247,7 +246,7 @@ struct redisCommand redisCommandTable[] = {
     {"keys",keysCommand,2,"rSj",0,NULL,0,0,0,0,0},
     {"rediskeys",keysCommand,2,"rSj",0,NULL,0,0,0,0,0},
     {"ssdbkeys",keysCommand,2,"rSj",0,NULL,0,0,0,0,0},
-    {"scan",scanCommand,-2,"rR",0,NULL,0,0,0,0,0},
+    {"scan",scanCommand,-2,"rRJ",0,NULL,0,0,0,0,0},
     {"dbsize",dbsizeCommand,1,"rFj",0,NULL,0,0,0,0,0},
     {"auth",authCommand,2,"sltF",0,NULL,0,0,0,0,0},
     {"ping",pingCommand,-1,"tF",0,NULL,0,0,0,0,0},
@@ -258,9 +257,9 @@ struct redisCommand redisCommandTable[] = {
     {"shutdown",shutdownCommand,-1,"alt",0,NULL,0,0,0,0,0},
     {"lastsave",lastsaveCommand,1,"RF",0,NULL,0,0,0,0,0},
     {"type",typeCommand,2,"rFJ",0,NULL,1,1,1,0,0},
-    {"multi",multiCommand,1,"sFn",0,NULL,0,0,0,0,0},
-    {"exec",execCommand,1,"sMn",0,NULL,0,0,0,0,0},
-    {"discard",discardCommand,1,"sFn",0,NULL,0,0,0,0,0},
+    {"multi",multiCommand,1,"sF",0,NULL,0,0,0,0,0},
+    {"exec",execCommand,1,"sM",0,NULL,0,0,0,0,0},
+    {"discard",discardCommand,1,"sF",0,NULL,0,0,0,0,0},
     {"sync",syncCommand,1,"arsj",0,NULL,0,0,0,0,0},
     {"psync",syncCommand,3,"arsj",0,NULL,0,0,0,0,0},
     {"replconf",replconfCommand,-1,"aslt",0,NULL,0,0,0,0,0},
@@ -284,8 +283,8 @@ struct redisCommand redisCommandTable[] = {
     {"punsubscribe",punsubscribeCommand,-1,"pslt",0,NULL,0,0,0,0,0},
     {"publish",publishCommand,3,"pltF",0,NULL,0,0,0,0,0},
     {"pubsub",pubsubCommand,-2,"pltR",0,NULL,0,0,0,0,0},
-    {"watch",watchCommand,-2,"sFn",0,NULL,1,-1,1,0,0},
-    {"unwatch",unwatchCommand,1,"sFn",0,NULL,0,0,0,0,0},
+    {"watch",watchCommand,-2,"sF",0,NULL,1,-1,1,0,0},
+    {"unwatch",unwatchCommand,1,"sF",0,NULL,0,0,0,0,0},
     {"cluster",clusterCommand,-2,"a",0,NULL,0,0,0,0,0},
     {"restore",restoreCommand,-4,"wmJ",0,NULL,1,1,1,0,0},
     // todo: support migrate and restore-asking(?)
@@ -298,10 +297,10 @@ struct redisCommand redisCommandTable[] = {
     {"object",objectCommand,3,"rj",0,NULL,2,2,2,0,0},
     {"memory",memoryCommand,-2,"rj",0,NULL,0,0,0,0,0},
     {"client",clientCommand,-2,"as",0,NULL,0,0,0,0,0},
-    {"eval",evalCommand,-3,"sn",0,evalGetKeys,0,0,0,0,0},
-    {"evalsha",evalShaCommand,-3,"sn",0,evalGetKeys,0,0,0,0,0},
+    {"eval",evalCommand,-3,"s",0,evalGetKeys,0,0,0,0,0},
+    {"evalsha",evalShaCommand,-3,"s",0,evalGetKeys,0,0,0,0,0},
     {"slowlog",slowlogCommand,-2,"a",0,NULL,0,0,0,0,0},
-    {"script",scriptCommand,-2,"sn",0,NULL,0,0,0,0,0},
+    {"script",scriptCommand,-2,"s",0,NULL,0,0,0,0,0},
     {"time",timeCommand,1,"RF",0,NULL,0,0,0,0,0},
     {"bitop",bitopCommand,-4,"wm",0,NULL,2,-1,1,0,0},
     {"bitcount",bitcountCommand,-2,"rJ",0,NULL,1,1,1,0,0},
@@ -324,12 +323,14 @@ struct redisCommand redisCommandTable[] = {
     {"post",securityWarningCommand,-1,"lt",0,NULL,0,0,0,0,0},
     {"host:",securityWarningCommand,-1,"lt",0,NULL,0,0,0,0,0},
     {"latency",latencyCommand,-2,"aslt",0,NULL,0,0,0,0,0},
+    {"swap",swapCommand,-2,"aslt",0,NULL,0,0,0,0,0},
 
     /* Interfaces called by SSDB. */
-    {"ssdb-resp-del",ssdbRespDelCommand,3,"wj",0,NULL,1,-1,1,0,0},
-    {"ssdb-resp-restore",ssdbRespRestoreCommand,6,"wmj",0,NULL,1,1,1,0,0},
+    {"ssdb-resp-del",ssdbRespDelCommand,-3,"wj",0,NULL,1,1,1,0,0},
+    {"ssdb-resp-restore",ssdbRespRestoreCommand,-6,"wmj",0,NULL,1,1,1,0,0},
     {"ssdb-resp-fail",ssdbRespFailCommand,4,"wj",0,NULL,1,1,1,0,0},
     {"ssdb-resp-notfound",ssdbRespNotfoundCommand,4,"wj",0,NULL,1,1,1,0,0},
+    {"ssdb-resp-hot",ssdbRespHotCommand,-3,"j",0,NULL,0,0,0,0,0},
 
     /* used by slave ssdb to notify slave redis when transfer ssdb snapshot. */
     {"ssdb-notify-redis",ssdbNotifyCommand,-4,"lj",0,NULL,0,0,0,0,0},
@@ -798,6 +799,16 @@ dictType replScriptCacheDictType = {
     NULL                        /* val destructor */
 };
 
+/* server.ssdb_kept_keys, sds -> ssdbKeptKey */
+dictType keptKeyDictType = {
+    dictSdsHash,                /* hash function */
+    dictSdsDup,                 /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    dictVanillaFree             /* val destructor */
+};
+
 /* Db->visiting_ssdb_keys */
 dictType keyDictType = {
     dictSdsHash,                /* hash function */
@@ -808,6 +819,65 @@ dictType keyDictType = {
     NULL                        /* val destructor */
 };
 
+/* The dicts tracking the intermediate states of keys in swap mode are
+ * created with the SWAP_KEY_* flag of their state as privdata, so that
+ * server.swap_key_states follows their keys. A key has a single copy, owned
+ * by server.swap_key_states and shared by the state dicts it is in, which
+ * is released once the key has no state left. */
+static void *dictSwapStateKeyDup(void *privdata, const void *key) {
+    dictEntry *existing, *de = dictAddRaw(server.swap_key_states, (void *)key, &existing);
+
+    /* The value of a new entry is not initialized. */
+    if (de) {
+        dictSetUnsignedIntegerVal(de, (unsigned long)privdata);
+    } else {
+        de = existing;
+        dictSetUnsignedIntegerVal(de, dictGetUnsignedIntegerVal(de) | (unsigned long)privdata);
+    }
+    return dictGetKey(de);
+}
+
+static void dictSwapStateKeyDestructor(void *privdata, void *key) {
+    dictEntry *de = dictFind(server.swap_key_states, key);
+    uint64_t state;
+
+    serverAssert(de != NULL);
+    state = dictGetUnsignedIntegerVal(de) & ~(unsigned long)privdata;
+    if (state)
+        dictSetUnsignedIntegerVal(de, state);
+    else
+        dictDelete(server.swap_key_states, key);
+}
+
+/* Db->transferring_keys, loading_hot_keys..., see swapKeyState(). */
+dictType swapStateKeyDictType = {
+    dictSdsHash,                /* hash function */
+    dictSwapStateKeyDup,        /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSwapStateKeyDestructor, /* key destructor */
+    NULL                        /* val destructor */
+};
+
+static void dictTransferringKeyDestructor(void *privdata, void *val) {
+    transferringKey *tk = val;
+    DICT_NOTUSED(privdata);
+
+    server.ssdb_transferring_bytes -= tk->bytes;
+    zfree(tk);
+}
+
+/* EVICTED_DATA_DB->transferring_keys, the bytes in flight are released
+ * however the key leaves the dict. */
+dictType transferringKeysDictType = {
+    dictSdsHash,                /* hash function */
+    dictSwapStateKeyDup,        /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSwapStateKeyDestructor, /* key destructor */
+    dictTransferringKeyDestructor /* val destructor */
+};
+
 int htNeedsResize(dict *dict) {
     long long size, used;
 
@@ -981,6 +1051,7 @@ void reconnectSSDB() {
     }
     int total_ssdb_conn = 0;
     int total_ssdb_disconnected = 0;
+    int j;
 
     RECONNECT_SPECIAL_CLIENT(server.ssdb_client);
     RECONNECT_SPECIAL_CLIENT(server.delete_confirm_client);
@@ -998,9 +1069,14 @@ void reconnectSSDB() {
         RECONNECT_SPECIAL_CLIENT(server.cached_master);
     }
 
+    for (j = 0; j < server.ssdb_connection_pool_size; j++)
+        RECONNECT_SPECIAL_CLIENT(server.ssdb_pool[j]);
+
     listRewind(server.clients, &li);
     while ((ln = listNext(&li))) {
         client *c = listNodeValue(ln);
+        /* the pooled connection is handled above. */
+        if (c->ssdb_pool_conn) continue;
         total_ssdb_conn++;
         if (IS_NOT_CONNECTED(c))
             total_ssdb_disconnected++;
@@ -1164,6 +1240,11 @@ int serverCron(struct aeEventLoop *eventLoop, long long id, void *clientData) {
                 server.stat_net_input_bytes);
         trackInstantaneousMetric(STATS_METRIC_NET_OUTPUT,
                 server.stat_net_output_bytes);
+        if (server.swap_mode) {
+            trackInstantaneousMetric(STATS_METRIC_SWAP_THRASH,
+                    server.stat_swap_thrash);
+            swapTierTrackMetrics();
+        }
     }
 
     /* We have just LRU_BITS bits per object for LRU information.
@@ -1361,6 +1442,11 @@ int serverCron(struct aeEventLoop *eventLoop, long long id, void *clientData) {
         if (server.sentinel_mode) sentinelTimer();
     }
 
+    /* Adapt the limits of the transfers and loads to SSDB. */
+    run_with_period(SWAP_LIMIT_PERIOD_MS) {
+        if (server.swap_mode && server.masterhost == NULL) swapLimitCron();
+    }
+
     /* Cleanup expired MIGRATE cached sockets. */
     run_with_period(1000) {
         migrateCloseTimedoutSockets();
@@ -1418,9 +1504,14 @@ int memoryReachLoadUpperLimit() {
     return 0;
 }
 
+/* Start transferring cold keys to SSDB, as many as the eviction cycle
+ * allows. The time budget of the cycle grows with how far used memory is
+ * above ssdb-transfer-lower-limit: a quarter of ssdb-evict-cycle-budget-us
+ * right above it, all of it when maxmemory is reached. */
 void startToEvictIfNeeded() {
-    size_t mem_tofree, old_mem_tofree = 0;
+    size_t mem_tofree, used, lower;
     float transfer_lower_threshold;
+    long long start, budget;
 
     if (server.ssdb_client == NULL || !(server.ssdb_client->ssdb_conn_flags & CONN_SUCCESS)) return;
 
@@ -1437,13 +1528,28 @@ void startToEvictIfNeeded() {
         return;
 
     transfer_lower_threshold = 1.0 * server.ssdb_transfer_lower_limit/100;
-    mem_tofree = zmalloc_used_memory() - server.maxmemory * transfer_lower_threshold;
+    used = zmalloc_used_memory();
+    lower = server.maxmemory * transfer_lower_threshold;
+    mem_tofree = used > lower ? used - lower : 0;
 
-    while ( mem_tofree > 0 && mem_tofree != old_mem_tofree) {
-        old_mem_tofree = mem_tofree;
-        if (C_ERR == tryEvictingKeysToSSDB(&mem_tofree)) {
-            break;
+    budget = server.ssdb_evict_cycle_budget_us/4;
+    if (server.maxmemory > lower) {
+        double pressure = (double)mem_tofree/(server.maxmemory - lower);
+
+        if (pressure > 1) pressure = 1;
+        budget += (long long)(pressure * (server.ssdb_evict_cycle_budget_us - budget));
+    } else {
+        budget = server.ssdb_evict_cycle_budget_us;
+    }
+
+    start = ustime();
+    if (mem_tofree > 0 && !transferLimitReached()) {
+        server.stat_evict_cycles++;
+        while (mem_tofree > 0 && !transferLimitReached() && ustime()-start < budget) {
+            if (C_ERR == tryEvictingKeysToSSDB(&mem_tofree, start+budget))
+                break;
         }
+        swapLatencyRecord(SWAP_LATENCY_EVICT_CYCLE, ustime()-start);
     }
 
     while (dictSize(EVICTED_DATA_DB->transferring_keys) <= (unsigned long)server.master_max_concurrent_transferring_keys
@@ -1463,7 +1569,15 @@ void startToEvictIfNeeded() {
 }
 
 #define RESERVED_MEMORY_WHEN_LOAD (1024*1024*2)
-int isMeetLoadCondition() {
+/* Return 1 if there is room in memory to load keys from SSDB. */
+int isMemoryEnoughToLoad(void) {
+    if (server.maxmemory > 0 &&
+        zmalloc_used_memory() + RESERVED_MEMORY_WHEN_LOAD >= server.maxmemory)
+        return 0;
+    return !memoryReachLoadUpperLimit();
+}
+
+int isMeetLoadCondition(void) {
     if (server.is_allow_ssdb_write == DISALLOW_SSDB_WRITE) {
         serverLog(LL_DEBUG, "replication check write is going on.");
         return 0;
@@ -1479,12 +1593,7 @@ int isMeetLoadCondition() {
         goto clean_hot_keys;
     }
 
-    size_t mem_free = server.maxmemory - zmalloc_used_memory();
-
-    if (server.maxmemory > 0 && mem_free <= RESERVED_MEMORY_WHEN_LOAD)
-        goto clean_hot_keys;
-
-    if (memoryReachLoadUpperLimit())
+    if (!isMemoryEnoughToLoad())
         goto clean_hot_keys;
 
     return 1;
@@ -1601,16 +1710,15 @@ void startToLoadIfNeeded() {
     while((de = dictNext(di)) != NULL) {
         sds key = dictGetKey(de);
 
-        if (dictFind(EVICTED_DATA_DB->transferring_keys, key)
-            || dictFind(EVICTED_DATA_DB->loading_hot_keys, key)
-            || dictFind(EVICTED_DATA_DB->delete_confirm_keys, key)) {
+        unsigned long state = swapKeyState(key);
+
+        if (state & (SWAP_KEY_TRANSFERRING|SWAP_KEY_LOADING|SWAP_KEY_DELETE_CONFIRM)) {
             /* although this is impossible. */
             serverAssert(0);
             continue;
         }
 
-        if (dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, key)
-            || isMigratingSSDBKey(key)) {
+        if (state & (SWAP_KEY_VISITING|SWAP_KEY_MIGRATING)) {
             /* Try to load the key later. */
             continue;
         }
@@ -1764,6 +1872,18 @@ void handleSSDBkeysToClean(void) {
     blockClient(server.expired_delete_client, BLOCKED_BY_EXPIRED_DELETE);
 }
 
+/* Return 1 if the DEL of 'key' sent by handleSSDBkeysToClean() is not done. */
+int isSSDBkeyCleaning(sds key) {
+    client *c = server.expired_delete_client;
+    int j;
+
+    if (!c || !(c->flags & CLIENT_BLOCKED) || c->btype != BLOCKED_BY_EXPIRED_DELETE)
+        return 0;
+    for (j = 1; j < c->argc; j++)
+        if (!sdscmp(c->argv[j]->ptr, key)) return 1;
+    return 0;
+}
+
 void handleDeleteConfirmKeys(void) {
     dictIterator *di;
     dictEntry *de;
@@ -1783,19 +1903,19 @@ void handleDeleteConfirmKeys(void) {
 
     di = dictGetSafeIterator(server.maybe_deleted_ssdb_keys);
     while((de = dictNext(di))) {
-        if (dictFind(EVICTED_DATA_DB->delete_confirm_keys, de->key)) {
+        unsigned long state = swapKeyState(de->key);
+
+        if (state & SWAP_KEY_DELETE_CONFIRM) {
             /* although this is impossible.*/
             dictDelete(server.maybe_deleted_ssdb_keys, de->key);
             continue;
         }
 
-        if (dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, de->key)) {
+        if (state & SWAP_KEY_VISITING) {
             /* will try it the next time. */
             continue;
         }
-        if (dictFind(EVICTED_DATA_DB->transferring_keys, de->key)
-            || dictFind(server.hot_keys, de->key)
-            || dictFind(EVICTED_DATA_DB->loading_hot_keys, de->key)) {
+        if (state & (SWAP_KEY_TRANSFERRING|SWAP_KEY_HOT|SWAP_KEY_LOADING)) {
             /* just remove it. */
             dictDelete(server.maybe_deleted_ssdb_keys, de->key);
             continue;
@@ -2070,6 +2190,8 @@ void initServerConfig(void) {
     server.sofd = -1;
     server.ssdb_client = NULL;
     server.ssdb_replication_client = NULL;
+    server.ssdb_pool = NULL;
+    server.ssdb_output_paused_clients = listCreate();
     server.protected_mode = CONFIG_DEFAULT_PROTECTED_MODE;
     server.swap_mode = CONFIG_DEFAULT_SWAP_MODE;
     server.behave_as_ssdb = CONFIG_DEFAULT_BEHAVE_AS_SSDB;
@@ -2205,10 +2327,30 @@ void initServerConfig(void) {
     server.slave_transfer_ssdb_snapshot_timeout = SLAVE_SSDB_TRANSFER_SNAPSHOT_TIMEOUT;
     server.master_max_concurrent_loading_keys = MASTER_MAX_CONCURRENT_LOADING_KEYS;
     server.master_max_concurrent_transferring_keys = MASTER_MAX_CONCURRENT_TRANSFERRING_KEYS;
+    server.ssdb_evict_cycle_budget_us = SSDB_EVICT_CYCLE_BUDGET_US;
+    server.ssdb_transfer_max_inflight_bytes = SSDB_TRANSFER_MAX_INFLIGHT_BYTES;
     server.slave_max_concurrent_ssdb_swap_count = SLAVE_MAX_CONCURRENT_SSDB_SWAP_COUNT;
     server.slave_max_ssdb_swap_count_everytime = SLAVE_MAX_SSDB_SWAP_COUNT_EVERYTIME;
     server.coldkey_filter_times_everytime = COLDKEY_FILTER_TIMES_EVERYTIME;
     server.lowest_idle_val_of_cold_key = LOWEST_IDLE_VAL_OF_COLD_KEY;
+    server.transfer_dict_compression = TRANSFER_DICT_COMPRESSION;
+    server.transfer_dict_size = TRANSFER_DICT_SIZE;
+    server.ssdb_promote_with_read = SSDB_PROMOTE_WITH_READ;
+    server.ssdb_keep_loaded_keys = SSDB_KEEP_LOADED_KEYS;
+    server.ssdb_load_admission = SSDB_LOAD_ADMISSION;
+    server.ssdb_size_aware_swap = SSDB_SIZE_AWARE_SWAP;
+    server.ssdb_thrash_window = SSDB_THRASH_WINDOW;
+    server.ssdb_thrash_ghost_entries = SSDB_THRASH_GHOST_ENTRIES;
+    server.ssdb_min_residency = SSDB_MIN_RESIDENCY;
+    server.ssdb_thrash_load_penalty = SSDB_THRASH_LOAD_PENALTY;
+    server.ssdb_read_coalescing_window_us = SSDB_READ_COALESCING_WINDOW_US;
+    server.ssdb_reply_cache_size = SSDB_REPLY_CACHE_SIZE;
+    server.ssdb_transfer_target_latency_us = SSDB_TRANSFER_TARGET_LATENCY_US;
+    server.ssdb_connection_pool_size = SSDB_CONNECTION_POOL_SIZE;
+    server.ssdb_output_buffer_limit = SSDB_OUTPUT_BUFFER_LIMIT;
+    server.ssdb_shm_ring_size = SSDB_SHM_RING_SIZE;
+    server.ssdb_coaccess_keys = SSDB_COACCESS_KEYS;
+    server.ssdb_coaccess_window_ms = SSDB_COACCESS_WINDOW_MS;
 
     server.repl_min_slaves_to_write = CONFIG_DEFAULT_MIN_SLAVES_TO_WRITE;
     server.repl_min_slaves_max_lag = CONFIG_DEFAULT_MIN_SLAVES_MAX_LAG;
@@ -2515,6 +2657,22 @@ void resetServerStats(void) {
     server.stat_keyspace_misses = 0;
     server.stat_keyspace_hits = 0;
     server.stat_keyspace_ssdb_hits = 0;
+    server.stat_promote_with_read = 0;
+    server.stat_promote_with_read_dropped = 0;
+    server.stat_ssdb_hot_keys = 0;
+    server.stat_ssdb_hot_keys_pooled = 0;
+    server.stat_clean_evictions = 0;
+    server.stat_ssdb_pool_requests = 0;
+    server.stat_ssdb_pool_orphaned = 0;
+    server.stat_ssdb_write_stalls = 0;
+    server.stat_ssdb_output_paused = 0;
+    server.stat_ssdb_fanout_commands = 0;
+    server.stat_batched_loads = 0;
+    server.stat_batched_loaded_keys = 0;
+    server.stat_evict_cycles = 0;
+    server.stat_evict_cycle_keys = 0;
+    server.stat_swap_thrash = 0;
+    swapTierResetStats();
     server.stat_active_defrag_hits = 0;
     server.stat_active_defrag_misses = 0;
     server.stat_active_defrag_key_hits = 0;
@@ -2616,17 +2774,25 @@ void initServer(void) {
         server.db[0].ssdb_blocking_keys = dictCreate(&keylistDictType,NULL);
         server.db[0].blocking_keys_write_same_ssdbkey = dictCreate(&keylistDictType,NULL);
         server.db[0].ssdb_ready_keys = dictCreate(&objectKeyPointerValueDictType,NULL);
-        server.db[0].migrating_ssdb_keys = dictCreate(&keyDictType,NULL);
-
-        server.db[EVICTED_DATA_DBID].transferring_keys = dictCreate(&keyDictType,NULL);
-        server.db[EVICTED_DATA_DBID].loading_hot_keys = dictCreate(&keyDictType,NULL);
-        server.db[EVICTED_DATA_DBID].visiting_ssdb_keys = dictCreate(&keyDictType,NULL);
-        server.db[EVICTED_DATA_DBID].delete_confirm_keys = dictCreate(&keyDictType,NULL);
+        server.swap_key_states = dictCreate(&keyDictType,NULL);
+        server.db[0].migrating_ssdb_keys =
+            dictCreate(&swapStateKeyDictType,(void *)SWAP_KEY_MIGRATING);
+
+        server.db[EVICTED_DATA_DBID].transferring_keys =
+            dictCreate(&transferringKeysDictType,(void *)SWAP_KEY_TRANSFERRING);
+        server.db[EVICTED_DATA_DBID].loading_hot_keys =
+            dictCreate(&swapStateKeyDictType,(void *)SWAP_KEY_LOADING);
+        server.db[EVICTED_DATA_DBID].visiting_ssdb_keys =
+            dictCreate(&swapStateKeyDictType,(void *)SWAP_KEY_VISITING);
+        server.db[EVICTED_DATA_DBID].delete_confirm_keys =
+            dictCreate(&swapStateKeyDictType,(void *)SWAP_KEY_DELETE_CONFIRM);
         // todo: 优化字典类型,避免较多的内存分配
         server.db[EVICTED_DATA_DBID].ssdb_keys_to_clean = dictCreate(&keyDictType,NULL);
 
-        server.hot_keys = dictCreate(&keyDictType,NULL);
+        server.hot_keys = dictCreate(&swapStateKeyDictType,(void *)SWAP_KEY_HOT);
         server.maybe_deleted_ssdb_keys = dictCreate(&keyDictType,NULL);
+        server.ssdb_kept_keys = dictCreate(&keptKeyDictType,NULL);
+        server.ssdb_promoting_keys = dictCreate(&keyDictType,NULL);
 
         server.storetossdb_migrate_keys = listCreate();
         listSetFreeMethod(server.storetossdb_migrate_keys, (void (*)(void*))decrRefCount);
@@ -2655,6 +2821,8 @@ void initServer(void) {
     resetServerStats();
     /* A few stats we don't want to reset: server startup time, and peak mem. */
     server.stat_starttime = time(NULL);
+    server.ssdb_output_pending_bytes = 0;
+    server.ssdb_transferring_bytes = 0;
     server.stat_peak_memory = 0;
     server.stat_rdb_cow_bytes = 0;
     server.stat_aof_cow_bytes = 0;
@@ -2738,6 +2906,7 @@ void initServer(void) {
         server.ssdbargvlen = zmalloc(sizeof(size_t) * SSDB_CMD_DEFAULT_MAX_ARGC);
 
         server.global_transfer_id = 0;
+        server.ssdb_write_epoch = 0;
         server.loadAndEvictCmdDict = dictCreate(&keyDictType,NULL);
 
         server.delayed_migrate_clients = listCreate();
@@ -2824,6 +2993,7 @@ void resetCommandTableStats(void) {
         c = (struct redisCommand *) dictGetVal(de);
         c->microseconds = 0;
         c->calls = 0;
+        memset(c->swap_tiers,0,sizeof(c->swap_tiers));
     }
     dictReleaseIterator(di);
 
@@ -3298,6 +3468,111 @@ int blockInMediateKey(client* c, struct redisCommand* cmd, robj** argv, int argc
     return C_OK;
 }
 
+/* Return 1 if a key of the command is in SSDB or moving between redis and
+ * SSDB, a command running in redis only can't use it. */
+int isCommandUsingSSDBkeys(struct redisCommand *cmd, robj **argv, int argc) {
+    int *keys, numkeys = 0, used = 0, j;
+
+    keys = getKeysFromCommand(cmd, argv, argc, &numkeys);
+    for (j = 0; j < numkeys && !used; j++) {
+        sds key = argv[keys[j]]->ptr;
+
+        used = dictFind(EVICTED_DATA_DB->dict, key) || swapKeyState(key);
+    }
+    if (keys) getKeysFreeResult(keys);
+    return used;
+}
+
+/* A key in SSDB not already moving between redis and SSDB. */
+static int isKeyToPreload(sds key) {
+    return dictFind(EVICTED_DATA_DB->dict, key) &&
+        !(swapKeyState(key) & (SWAP_KEY_LOADING|SWAP_KEY_TRANSFERRING|
+                               SWAP_KEY_DELETE_CONFIRM));
+}
+
+/* Commands run by EXEC and by scripts never visit SSDB, so the cold keys
+ * they use are loaded first: they are added to server.hot_keys, loaded in a
+ * single batch and the client is blocked on them like any command using a
+ * loading key. Once all the keys are in redis the transaction or the script
+ * runs in memory as usual.
+ *
+ * They never run with some of their keys left in SSDB: when the keys can't
+ * be loaded now, on a slave, with SSDB not connected or memory short, the
+ * command is refused. A script using a key it didn't declare gets an error
+ * from the call, see luaRedisGenericCommand.
+ *
+ * Return C_ERR if the client is blocked, C_NOTSUPPORT_ERR if the command is
+ * refused. */
+static int blockForPreloadingKeys(client *c) {
+    robj **keyobjs = NULL;
+    int *keys, numkeys = 0, total = 0, cold = 0, blocked, j, k;
+    char *err = NULL;
+
+    /* The master loaded the keys of what it replicates. */
+    if (c->flags & CLIENT_MASTER) return C_OK;
+    if (c->cmd->proc == execCommand) {
+        if (!(c->flags & CLIENT_MULTI)
+            || (c->flags & (CLIENT_DIRTY_CAS|CLIENT_DIRTY_EXEC)))
+            return C_OK;
+    } else if (c->cmd->proc != evalCommand && c->cmd->proc != evalShaCommand) {
+        return C_OK;
+    }
+
+    if (c->cmd->proc == execCommand) {
+        for (j = 0; j < c->mstate.count; j++) {
+            multiCmd *mc = c->mstate.commands+j;
+
+            keys = getKeysFromCommand(mc->cmd, mc->argv, mc->argc, &numkeys);
+            if (numkeys) keyobjs = zrealloc(keyobjs, sizeof(robj*)*(total+numkeys));
+            for (k = 0; k < numkeys; k++) keyobjs[total++] = mc->argv[keys[k]];
+            if (keys) getKeysFreeResult(keys);
+        }
+    } else {
+        keys = getKeysFromCommand(c->cmd, c->argv, c->argc, &numkeys);
+        if (numkeys) keyobjs = zmalloc(sizeof(robj*)*numkeys);
+        for (k = 0; k < numkeys; k++) keyobjs[total++] = c->argv[keys[k]];
+        if (keys) getKeysFreeResult(keys);
+    }
+    if (total == 0) return C_OK;
+
+    for (j = 0; j < total; j++)
+        if (isKeyToPreload(keyobjs[j]->ptr)) cold++;
+
+    if (cold) {
+        if (server.masterhost)
+            err = "keys in SSDB are not loaded by a slave";
+        else if (server.ssdb_client == NULL
+                 || !(server.ssdb_client->ssdb_conn_flags & CONN_SUCCESS))
+            err = "SSDB is not connected";
+        else if (server.maxmemory > 0 && (memoryReachLoadUpperLimit() ||
+                 server.maxmemory - RESERVED_MEMORY_WHEN_LOAD <= zmalloc_used_memory()))
+            err = "not enough memory to load keys from SSDB";
+    }
+    if (err) {
+        zfree(keyobjs);
+        if (c->cmd->proc == execCommand) {
+            addReplyErrorFormat(c, "EXECABORT Transaction discarded, %s", err);
+            discardTransaction(c);
+        } else {
+            addReplyErrorFormat(c, "%s", err);
+        }
+        return C_NOTSUPPORT_ERR;
+    }
+
+    for (j = 0; j < total; j++)
+        if (isKeyToPreload(keyobjs[j]->ptr))
+            dictAddOrFind(server.hot_keys, keyobjs[j]->ptr);
+
+    /* EXEC and scripts have no read/write flags, they are blocked as writes.
+     * Every key left in SSDB is in one of the blocking states here. */
+    blocked = blockForLoadingkeys(c, c->cmd, keyobjs, total,
+                                  server.client_blocked_by_keys_timeout + mstime());
+    if (cold) prologOfLoadingKeysFromSSDB(keyobjs, total);
+    zfree(keyobjs);
+
+    return blocked ? C_ERR : C_OK;
+}
+
 /* Return C_ERR if the key is in loading or transferring state. */
 int checkKeysInMediateState(client* c) {
     c->cmd = c->lastcmd = lookupCommand(c->argv[0]->ptr);
@@ -3331,10 +3606,8 @@ int checkKeysForMigrate(client *c) {
     }
 
     keyobj = c->argv[first_key];
-    if (dictFind(EVICTED_DATA_DB->transferring_keys, keyobj->ptr)
-        || dictFind(EVICTED_DATA_DB->loading_hot_keys, keyobj->ptr)
-        || dictFind(EVICTED_DATA_DB->delete_confirm_keys, keyobj->ptr)
-        || dictFind(EVICTED_DATA_DB->visiting_ssdb_keys, keyobj->ptr)) {
+    if (swapKeyState(keyobj->ptr) & (SWAP_KEY_TRANSFERRING|SWAP_KEY_LOADING|
+                                     SWAP_KEY_DELETE_CONFIRM|SWAP_KEY_VISITING)) {
         return C_ERR;
     }
 
@@ -3438,13 +3711,23 @@ int addMigratingSSDBKey(sds keysds) {
 }
 
 int isMigratingSSDBKey(sds keysds) {
-    return dictFind(server.db->migrating_ssdb_keys, keysds) ? 1 : 0;
+    return (swapKeyState(keysds) & SWAP_KEY_MIGRATING) ? 1 : 0;
 }
 
 int delMigratingSSDBKey(sds keysds) {
     return dictDelete(server.db->migrating_ssdb_keys, keysds);
 }
 
+/* Return the SWAP_KEY_* states the key is in. A single lookup tells most
+ * keys are in none, in place of one lookup per state dict. */
+unsigned long swapKeyState(sds key) {
+    dictEntry *de;
+
+    if (!server.swap_key_states || !dictSize(server.swap_key_states)) return 0;
+    de = dictFind(server.swap_key_states, key);
+    return de ? (unsigned long)dictGetUnsignedIntegerVal(de) : 0;
+}
+
 void addVisitingSSDBKey(struct redisCommand* cmd, sds keysds) {
     dictEntry *entry, *existing;
     uint32_t visiting_write_num = 0, visiting_read_num = 0;
@@ -3454,14 +3737,20 @@ void addVisitingSSDBKey(struct redisCommand* cmd, sds keysds) {
         visiting_read_num = dictGetVisitingSSDBreadCount(existing);
 
         /* there are already some clients visiting this key. just increase client visiting count. */
-        if (cmd->flags & CMD_WRITE)
+        if (cmd->flags & CMD_WRITE) {
             dictSetVisitingSSDBwriteCount(existing, visiting_write_num+1);
-        else if (cmd->flags & CMD_READONLY)
+            server.ssdb_write_epoch++;
+            replyCacheInvalidate(keysds);
+            forgetPromotingKey(keysds);
+        } else if (cmd->flags & CMD_READONLY)
             dictSetVisitingSSDBreadCount(existing, visiting_read_num+1);
     } else {
         /* no other clients are visiting this key, set client visiting num to 1. */
         if (cmd->flags & CMD_WRITE) {
             visiting_write_num = 1;
+            server.ssdb_write_epoch++;
+            replyCacheInvalidate(keysds);
+            forgetPromotingKey(keysds);
             dictSetVisitingSSDBwriteCount(entry, 1);
             dictSetVisitingSSDBreadCount(entry, 0);
         } else if (cmd->flags & CMD_READONLY) {
@@ -3760,11 +4049,17 @@ void updateExpireInfo(robj** argv, int argc, struct redisCommand* cmd) {
      * in our master, if we don't delete its key index in ssdb key dict, the following writes
      * of a namesake key may get a wrong expire time. */
     if (cmd->proc == delCommand) {
-        robj *key = argv[1];
-        serverAssert(server.lazyfree_lazy_expire ? dbAsyncDelete(EVICTED_DATA_DB, key) :
-                     dbSyncDelete(EVICTED_DATA_DB, key));
+        int j;
+
+        serverAssert(server.lazyfree_lazy_expire ? dbAsyncDelete(EVICTED_DATA_DB, argv[1]) :
+                     dbSyncDelete(EVICTED_DATA_DB, argv[1]));
+        /* The other keys of a multi-key DEL may be gone already. */
+        for (j = 2; j < argc; j++) {
+            if (server.lazyfree_lazy_expire) dbAsyncDelete(EVICTED_DATA_DB, argv[j]);
+            else dbSyncDelete(EVICTED_DATA_DB, argv[j]);
+        }
         /* TODO: to support slave's slave. */
-        propagate(server.delCommand, EVICTED_DATA_DBID, argv, 2, PROPAGATE_AOF);
+        propagate(server.delCommand, EVICTED_DATA_DBID, argv, argc, PROPAGATE_AOF);
     }
 }
 
@@ -3778,6 +4073,9 @@ int processCommandReplicationConn(client* c, struct ssdb_write_op* slave_retry_w
 
     if (!(c->flags & CLIENT_MASTER))
         return C_ERR;
+    /* The keys of a transaction were loaded by the master before EXEC. */
+    if (c->flags & CLIENT_MULTI && !slave_retry_write)
+        return C_ERR;
 
     if (slave_retry_write) {
         cmd = slave_retry_write->cmd;
@@ -3881,8 +4179,9 @@ int processCommandReplicationConn(client* c, struct ssdb_write_op* slave_retry_w
     return C_ERR;
 }
 
-void chooseHotKeysByLFUcounter(robj* keyobj) {
-    if (!server.load_from_ssdb) return;
+/* Return 1 if the cold key is accessed often enough to be loaded to redis. */
+int isColdKeyHot(robj *keyobj) {
+    if (!server.load_from_ssdb) return 0;
 
     serverAssert(server.maxmemory_policy & MAXMEMORY_FLAG_LFU);
 
@@ -3893,7 +4192,15 @@ void chooseHotKeysByLFUcounter(robj* keyobj) {
 
     unsigned char counter = lfu & 255;
 
-    if ((counter > LFU_INIT_VAL) && !memoryReachLoadUpperLimit()) {
+    return (counter > coldKeyLoadThreshold(db_key)) && !memoryReachLoadUpperLimit() &&
+        loadAdmissionAllows(db_key);
+}
+
+void chooseHotKeysByLFUcounter(robj* keyobj) {
+    if (isColdKeyHot(keyobj)) {
+        dictEntry* de = dictFind(EVICTED_DATA_DB->dict, keyobj->ptr);
+        unsigned char counter = sdsgetlfu(dictGetKey(de)) & 255;
+
         if (server.load_test_mode) {
             /* for test purpose */
 
@@ -3902,9 +4209,8 @@ void chooseHotKeysByLFUcounter(robj* keyobj) {
             if (dictSize(server.hot_keys)+dictSize(EVICTED_DATA_DB->loading_hot_keys) > (unsigned long)server.master_max_concurrent_loading_keys)
                 return;
 
-            if (NULL == dictFind(EVICTED_DATA_DB->loading_hot_keys, dictGetKey(de)) &&
-                NULL == dictFind(EVICTED_DATA_DB->transferring_keys, dictGetKey(de))
-                && NULL == dictFind(EVICTED_DATA_DB->delete_confirm_keys, dictGetKey(de))) {
+            if (!(swapKeyState(dictGetKey(de)) & (SWAP_KEY_LOADING|SWAP_KEY_TRANSFERRING|
+                                                  SWAP_KEY_DELETE_CONFIRM))) {
                 serverLog(LL_DEBUG, "key: %s is added to server.hot_keys", (sds)dictGetKey(de));
                 dictAddOrFind(server.hot_keys, dictGetKey(de));
             }
@@ -3942,11 +4248,339 @@ int processBeforeVisitingSSDB(client *c, robj *keyobj) {
     return C_ERR;
 }
 
+/* Block the client if SSDB can't be visited now, the command will be
+ * processed again later. Return 1 if the client is blocked. */
+static int blockIfSSDBunavailable(client *c) {
+    /* prohibit write operations to SSDB when replication,
+     *
+     * Note: we also can have slaves if this server is a slave. */
+    if ((server.is_allow_ssdb_write == DISALLOW_SSDB_WRITE)
+        && (c->cmd->flags & CMD_WRITE) && (c->cmd->flags & CMD_SWAP_MODE)) {
+        listAddNodeTail(server.no_writing_ssdb_blocked_clients, c);
+        serverLog(LL_DEBUG, "client: %ld is added to server.no_writing_ssdb_blocked_clients", (long)c);
+        c->bpop.timeout = server.client_blocked_by_replication_nowrite_timeout + mstime();
+        blockClient(c, BLOCKED_NO_WRITE_TO_SSDB);
+
+        return 1;
+    }
+
+    /* prohibit read/write operations to SSDB when flushall */
+    if (server.masterhost == NULL && (server.prohibit_ssdb_read_write == PROHIBIT_SSDB_READ_WRITE)
+        && (c->cmd->flags & (CMD_WRITE | CMD_READONLY)) && (c->cmd->flags & CMD_SWAP_MODE)) {
+        listAddNodeTail(server.ssdb_flushall_blocked_clients, c);
+        c->bpop.timeout = server.client_blocked_by_flushall_timeout + mstime();
+        blockClient(c, BLOCKED_NO_READ_WRITE_TO_SSDB);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Multi-key commands with keys both in redis and in SSDB
+ * -------------------------------------------------------------------------- */
+
+static int isSSDBfanoutCommand(client *c) {
+    struct redisCommand *cmd = c->cmd;
+
+    if (cmd->proc == mgetCommand || cmd->proc == msetCommand)
+        return 1;
+    /* single key forms are handled like the other commands. */
+    return (cmd->proc == delCommand || cmd->proc == existsCommand) && c->argc > 2;
+}
+
+static void releaseSSDBfanout(ssdbFanout *fo) {
+    int j;
+
+    if (fo->vals) {
+        for (j = 0; j < fo->numkeys; j++)
+            if (fo->vals[j]) decrRefCount(fo->vals[j]);
+        zfree(fo->vals);
+    }
+    zfree(fo->cold);
+    zfree(fo);
+}
+
+void freeSSDBfanout(client *c) {
+    if (!c->ssdb_fanout) return;
+    releaseSSDBfanout(c->ssdb_fanout);
+    c->ssdb_fanout = NULL;
+}
+
+/* Run the part of the command on the keys in redis, the keys marked in
+ * fo->cold are left to SSDB. Writes are propagated as a command with the
+ * keys in redis only, the rest is propagated when SSDB replies. */
+static void runSSDBfanoutInRedis(client *c, ssdbFanout *fo, int step) {
+    robj **argv = zmalloc(sizeof(robj*)*c->argc);
+    int j, argc = 1;
+
+    argv[0] = c->argv[0];
+    for (j = 0; j < fo->numkeys; j++) {
+        robj *key = c->argv[1+j*step], *val;
+
+        if (fo->cold[j]) continue;
+        if (c->cmd->proc == mgetCommand) {
+            val = lookupKeyRead(c->db, key);
+            if (val && val->type == OBJ_STRING) {
+                incrRefCount(val);
+                fo->vals[j] = val;
+            }
+        } else if (c->cmd->proc == existsCommand) {
+            if (lookupKeyRead(c->db, key)) fo->count++;
+        } else if (c->cmd->proc == delCommand) {
+            expireIfNeeded(c->db, key);
+            if (dbDelete(c->db, key)) {
+                signalModifiedKey(c->db, key);
+                notifyKeyspaceEvent(NOTIFY_GENERIC, "del", key, c->db->id);
+                server.dirty++;
+                fo->count++;
+            }
+            argv[argc++] = key;
+        } else if (c->cmd->proc == msetCommand) {
+            c->argv[2+j*step] = tryObjectEncoding(c->argv[2+j*step]);
+            setKey(c->db, key, c->argv[2+j*step]);
+            notifyKeyspaceEvent(NOTIFY_STRING, "set", key, c->db->id);
+            server.dirty++;
+            argv[argc++] = key;
+            argv[argc++] = c->argv[2+j*step];
+        }
+    }
+
+    if ((c->cmd->flags & CMD_WRITE) && argc > 1)
+        propagate(c->cmd, c->db->id, argv, argc, PROPAGATE_AOF|PROPAGATE_REPL);
+    zfree(argv);
+}
+
+/* MGET, MSET and multi-key DEL/EXISTS are split per tier: the keys in redis
+ * are served from the keyspace, the cold keys are sent to SSDB in a single
+ * command and the reply is merged in the order of the arguments by
+ * replyToSSDBfanout. Cold keys are never loaded because of these commands.
+ *
+ * Return C_ERR if all the keys are in redis, like processCommandMaybeInSSDB. */
+static int processSSDBfanoutCommand(client *c) {
+    int step = (c->cmd->proc == msetCommand) ? 2 : 1;
+    int numkeys = (c->argc-1)/step, ncold = 0, j, ret;
+    ssdbFanout *fo;
+    robj **argv;
+    sds finalcmd;
+
+    if (c->cmd->proc == msetCommand && (c->argc % 2) == 0) return C_ERR;
+
+    fo = zcalloc(sizeof(*fo));
+    fo->numkeys = numkeys;
+    fo->cold = zcalloc(numkeys);
+    for (j = 0; j < numkeys; j++) {
+        robj *key = c->argv[1+j*step];
+
+        if (!dictFind(EVICTED_DATA_DB->dict, key->ptr)) continue;
+        /* Calling lookupKey to update lru or lfu counter. */
+        if (!lookupKey(EVICTED_DATA_DB, key, LOOKUP_NONE)) continue;
+        if (expireIfNeeded(EVICTED_DATA_DB, key) == 1) continue;
+        fo->cold[j] = 1;
+        ncold++;
+    }
+
+    if (ncold == 0) {
+        releaseSSDBfanout(fo);
+        return C_ERR;
+    }
+
+    if (blockIfSSDBunavailable(c)) {
+        releaseSSDBfanout(fo);
+        return C_OK;
+    }
+
+    /* The command sent to SSDB only has the cold keys. It is sent before
+     * anything is done in redis, nothing is done if it can't be sent. */
+    argv = zmalloc(sizeof(robj*)*(1+ncold*step));
+    argv[0] = c->argv[0];
+    incrRefCount(argv[0]);
+    for (j = 0, ncold = 0; j < numkeys; j++) {
+        if (!fo->cold[j]) continue;
+        argv[1+ncold*step] = c->argv[1+j*step];
+        incrRefCount(argv[1+ncold*step]);
+        if (step == 2) {
+            argv[2+ncold*step] = c->argv[2+j*step];
+            incrRefCount(argv[2+ncold*step]);
+        }
+        ncold++;
+    }
+    finalcmd = composeCmdFromArgs(1+ncold*step, argv);
+    ret = finalcmd ? sendCommandToSSDB(c, finalcmd) : C_ERR;
+    if (ret != C_OK) {
+        for (j = 0; j < 1+ncold*step; j++) decrRefCount(argv[j]);
+        zfree(argv);
+        releaseSSDBfanout(fo);
+        return C_FD_ERR;
+    }
+
+    if (listLength(server.monitors) &&
+        !server.loading &&
+        !(c->cmd->flags & (CMD_SKIP_MONITOR|CMD_ADMIN)))
+    {
+        replicationFeedMonitors(c,server.monitors,EVICTED_DATA_DBID,c->argv,c->argc);
+    }
+
+    if (c->cmd->proc == mgetCommand) fo->vals = zcalloc(sizeof(robj*)*numkeys);
+    runSSDBfanoutInRedis(c, fo, step);
+
+    /* The command was rewritten, it can't be run in redis any more. */
+    replaceClientCommandVector(c, 1+ncold*step, argv);
+    c->ssdb_fanout = fo;
+
+    server.stat_keyspace_ssdb_hits++;
+    server.stat_ssdb_fanout_commands++;
+    swapTierRecord(c->cmd, SWAP_TIER_SSDB);
+
+    /* Record the keys visting SSDB. */
+    if (server.masterhost == NULL)
+        recordVisitingSSDBkeys(c->cmd, c->argv, c->argc);
+
+    c->bpop.timeout = server.client_visiting_ssdb_timeout + mstime();
+    blockClient(c, BLOCKED_VISITING_SSDB);
+    return C_OK;
+}
+
+/* Merge the reply of SSDB for the cold keys with the part served by redis. */
+void replyToSSDBfanout(client *c) {
+    ssdbFanout *fo = c->ssdb_fanout;
+    redisReply *reply = c->ssdb_replies[0];
+    int j, k = 0;
+
+    if (!reply || reply->type == REDIS_REPLY_ERROR) {
+        addReplyErrorFormat(c, "%s", reply ? reply->str : "SSDB reply error");
+        return;
+    }
+
+    if (c->cmd->proc == mgetCommand) {
+        if (reply->type != REDIS_REPLY_ARRAY || (int)reply->elements != c->argc-1) {
+            addReplyError(c, "unexpected reply of SSDB");
+            return;
+        }
+        addReplyMultiBulkLen(c, fo->numkeys);
+        for (j = 0; j < fo->numkeys; j++) {
+            if (fo->cold[j]) {
+                redisReply *ele = reply->element[k++];
+
+                if (ele->type == REDIS_REPLY_STRING)
+                    addReplyBulkCBuffer(c, ele->str, ele->len);
+                else
+                    addReply(c, shared.nullbulk);
+            } else if (fo->vals[j]) {
+                addReplyBulk(c, fo->vals[j]);
+            } else {
+                addReply(c, shared.nullbulk);
+            }
+        }
+    } else if (c->cmd->proc == msetCommand) {
+        addReply(c, shared.ok);
+    } else {
+        addReplyLongLong(c, fo->count +
+                         (reply->type == REDIS_REPLY_INTEGER ? reply->integer : 0));
+    }
+}
+
+/* Return 1 if the SCAN of 'c' can go on with the keys in SSDB. Only the
+ * commands of a regular client go through processCommandMaybeInSSDB, the
+ * commands queued by MULTI and the ones of scripts are run by call()
+ * directly, so their SCAN never gets a cursor of SSDB. */
+int isSSDBscanAllowed(client *c) {
+    return server.swap_mode && c->fd != -1 &&
+        !(c->flags & (CLIENT_MULTI|CLIENT_LUA|CLIENT_MASTER));
+}
+
+/* The SSDB part of a SCAN, see SCAN_SSDB_CURSOR_FLAG. The options are
+ * passed as they are, so MATCH and COUNT are applied by SSDB.
+ *
+ * Return C_ERR if the cursor is not a cursor of SSDB, SCAN then runs in
+ * redis. */
+static int processSSDBscanCommand(client *c) {
+    unsigned long cursor;
+    robj **argv;
+    sds finalcmd;
+    char *eptr;
+    int j, ret;
+
+    errno = 0;
+    cursor = strtoul(c->argv[1]->ptr, &eptr, 10);
+    if (isspace(((char*)c->argv[1]->ptr)[0]) || eptr[0] != '\0' || errno == ERANGE)
+        return C_ERR;
+    if (!(cursor & SCAN_SSDB_CURSOR_FLAG)) return C_ERR;
+
+    if (blockIfSSDBunavailable(c)) return C_OK;
+
+    argv = zmalloc(sizeof(robj*)*c->argc);
+    argv[0] = c->argv[0];
+    argv[1] = createObject(OBJ_STRING, sdsfromlonglong(cursor & ~SCAN_SSDB_CURSOR_FLAG));
+    for (j = 2; j < c->argc; j++) argv[j] = c->argv[j];
+    finalcmd = composeCmdFromArgs(c->argc, argv);
+    decrRefCount(argv[1]);
+    zfree(argv);
+
+    ret = sendCommandToSSDB(c, finalcmd);
+    if (ret != C_OK) return ret;
+
+    c->bpop.timeout = server.client_visiting_ssdb_timeout + mstime();
+    blockClient(c, BLOCKED_VISITING_SSDB);
+    return C_OK;
+}
+
+/* Reply to the SSDB part of a SCAN: the cursor of SSDB is tagged, and only
+ * the keys of db 0 or EVICTED_DATA_DB are returned, SSDB may still have
+ * copies of deleted keys. A copy kept by SSDB of a key loaded to redis is
+ * returned: the key may have been loaded after the redis part, and SCAN is
+ * allowed to return a key twice. */
+void replyToSSDBscan(client *c) {
+    redisReply *reply = c->ssdb_replies[0], *keys;
+    unsigned long cursor = 0;
+    size_t j, count = 0;
+    void *replylen;
+    char *eptr = NULL;
+
+    if (!reply || reply->type == REDIS_REPLY_ERROR) {
+        addReplyErrorFormat(c, "%s", reply ? reply->str : "SSDB reply error");
+        return;
+    }
+
+    if (reply->type == REDIS_REPLY_ARRAY && reply->elements == 2
+        && reply->element[0]->type == REDIS_REPLY_STRING) {
+        errno = 0;
+        cursor = strtoul(reply->element[0]->str, &eptr, 10);
+    }
+    if (!eptr || eptr[0] != '\0' || errno == ERANGE
+        || (cursor & SCAN_SSDB_CURSOR_FLAG)
+        || reply->element[1]->type != REDIS_REPLY_ARRAY) {
+        addReplyError(c, "unexpected reply of SSDB");
+        return;
+    }
+
+    if (cursor) cursor |= SCAN_SSDB_CURSOR_FLAG;
+    addReplyMultiBulkLen(c, 2);
+    addReplyBulkUnsignedLong(c, cursor);
+
+    keys = reply->element[1];
+    replylen = addDeferredMultiBulkLength(c);
+    for (j = 0; j < keys->elements; j++) {
+        redisReply *key = keys->element[j];
+        sds k;
+
+        if (key->type != REDIS_REPLY_STRING) continue;
+        k = sdsnewlen(key->str, key->len);
+        if (dictFind(server.db[0].dict, k) || dictFind(EVICTED_DATA_DB->dict, k)) {
+            addReplyBulkCBuffer(c, key->str, key->len);
+            count++;
+        }
+        sdsfree(k);
+    }
+    setDeferredMultiBulkLength(c, replylen, count);
+}
+
 /* Process keys may be in SSDB, only handle the command swap_mode supported.
  The rest cases will be handled by processCommand. */
 int processCommandMaybeInSSDB(client *c) {
     robj *keyobj = NULL;
-    int ret;
+    int ret, promoting = 0;
 
     if ( !c->cmd || !(c->cmd->flags & (CMD_READONLY | CMD_WRITE)) )
         return C_ERR;
@@ -3956,6 +4590,16 @@ int processCommandMaybeInSSDB(client *c) {
     if (c->argc <= 1)
         return C_ERR;
 
+    /* Queued commands run in redis, EXEC loads their keys first. */
+    if (c->flags & CLIENT_MULTI)
+        return C_ERR;
+
+    if (isSSDBfanoutCommand(c))
+        return processSSDBfanoutCommand(c);
+
+    if (c->cmd->proc == scanCommand)
+        return processSSDBscanCommand(c);
+
     /* TODO: support multiple key migrateCommand ??? */
     if (c->cmd->proc == migrateCommand)
         keyobj = c->argv[3];
@@ -3967,28 +4611,7 @@ int processCommandMaybeInSSDB(client *c) {
     if (!keyobj || !dictFind(EVICTED_DATA_DB->dict, keyobj->ptr))
         return C_ERR;
 
-    /* prohibit write operations to SSDB when replication,
-     *
-     * Note: we also can have slaves if this server is a slave. */
-    if ((server.is_allow_ssdb_write == DISALLOW_SSDB_WRITE)
-        && (c->cmd->flags & CMD_WRITE) && (c->cmd->flags & CMD_SWAP_MODE)) {
-        listAddNodeTail(server.no_writing_ssdb_blocked_clients, c);
-        serverLog(LL_DEBUG, "client: %ld is added to server.no_writing_ssdb_blocked_clients", (long)c);
-        c->bpop.timeout = server.client_blocked_by_replication_nowrite_timeout + mstime();
-        blockClient(c, BLOCKED_NO_WRITE_TO_SSDB);
-
-        return C_OK;
-    }
-
-    /* prohibit read/write operations to SSDB when flushall */
-    if (server.masterhost == NULL && (server.prohibit_ssdb_read_write == PROHIBIT_SSDB_READ_WRITE)
-        && (c->cmd->flags & (CMD_WRITE | CMD_READONLY)) && (c->cmd->flags & CMD_SWAP_MODE)) {
-        listAddNodeTail(server.ssdb_flushall_blocked_clients, c);
-        c->bpop.timeout = server.client_blocked_by_flushall_timeout + mstime();
-        blockClient(c, BLOCKED_NO_READ_WRITE_TO_SSDB);
-
-        return C_OK;
-    }
+    if (blockIfSSDBunavailable(c)) return C_OK;
 
     if ((c->cmd->flags & (CMD_READONLY | CMD_WRITE)) &&
          (c->cmd->flags & CMD_SWAP_MODE)) {
@@ -4002,6 +4625,7 @@ int processCommandMaybeInSSDB(client *c) {
                 ret = C_ERR;
                 goto check_blocked_clients;
             }
+            if (!server.masterhost) coaccessRecord(c, keyobj->ptr);
 
             if (processBeforeVisitingSSDB(c, keyobj) == C_OK)
                 return C_OK;
@@ -4015,7 +4639,29 @@ int processCommandMaybeInSSDB(client *c) {
                 replicationFeedMonitors(c,server.monitors,EVICTED_DATA_DBID,c->argv,c->argc);
             }
 
-            ret = sendCommandToSSDB(c, NULL);
+            /* The same read may be answered already, or in flight. */
+            if (replyCacheLookup(c) == C_OK) {
+                server.stat_keyspace_ssdb_hits++;
+                server.stat_numcommands++;
+                swapTierRecord(c->cmd, SWAP_TIER_SHARED);
+                if (!server.masterhost) chooseHotKeysByLFUcounter(keyobj);
+                return C_REPLIED;
+            }
+            if (joinSSDBreadFlight(c) == C_OK) {
+                server.stat_keyspace_ssdb_hits++;
+                swapTierRecord(c->cmd, SWAP_TIER_SHARED);
+                if (!server.masterhost) chooseHotKeysByLFUcounter(keyobj);
+                return C_OK;
+            }
+
+            /* A hot key may be loaded with the reply of this read. */
+            ret = sendPromotingReadToSSDB(c, keyobj);
+            if (ret == C_ERR)
+                ret = sendCommandToSSDB(c, NULL);
+            else if (ret == C_OK) {
+                promoting = 1;
+                prologOfLoadingRelatedKeysFromSSDB(keyobj);
+            }
             if (ret != C_OK)
                 goto check_blocked_clients;
 #ifdef TEST_INCR_CONCURRENT
@@ -4024,6 +4670,7 @@ int processCommandMaybeInSSDB(client *c) {
 #endif
 
             server.stat_keyspace_ssdb_hits ++;
+            swapTierRecord(c->cmd, SWAP_TIER_SSDB);
 
             /* Record the keys visting SSDB. */
             if (server.masterhost == NULL)
@@ -4031,11 +4678,12 @@ int processCommandMaybeInSSDB(client *c) {
 
             c->bpop.timeout = server.client_visiting_ssdb_timeout + mstime();
             blockClient(c, BLOCKED_VISITING_SSDB);
+            if (!promoting) startSSDBreadFlight(c);
 
             /* Slaves do not load data from ssdb automatically. */
             if (server.masterhost) return C_OK;
 
-            if (c->cmd->proc == delCommand) return C_OK;
+            if (c->cmd->proc == delCommand || promoting) return C_OK;
 
             chooseHotKeysByLFUcounter(keyobj);
             return C_OK;
@@ -4210,6 +4858,15 @@ int runCommandReplicationConn(client *c, listNode* writeop_ln) {
         return C_OK;
     }
 
+    if (c->flags & CLIENT_MULTI &&
+        c->cmd->proc != execCommand && c->cmd->proc != discardCommand &&
+        c->cmd->proc != multiCommand && c->cmd->proc != watchCommand)
+    {
+        queueMultiCommand(c);
+        addReply(c,shared.queued);
+        return C_OK;
+    }
+
     call(c,CMD_CALL_FULL);
     c->woff = server.master_repl_offset;
 
@@ -4275,6 +4932,7 @@ int runCommand(client *c) {
     if (((c->cmd->flags & CMD_READONLY || c->cmd->flags & CMD_WRITE)
          && !(c->cmd->flags & CMD_SWAP_MODE) && !(c->cmd->flags & CMD_SWAPMODE_REDIS_ONLY)) ||
         (c->cmd->flags & CMD_SWAPMODE_NOT_ALLOWED)) {
+        flagTransaction(c);
         addReplyErrorFormat(c, "don't support this command in swap mode:%s.", c->cmd->name);
         return C_OK;
     }
@@ -4320,6 +4978,8 @@ int runCommand(client *c) {
         } else if (ret == C_FD_ERR) {
             addReplyErrorFormat(c, "SSDB disconnect");
             return C_OK;
+        } else if (ret == C_REPLIED) {
+            return C_OK;
         }
     }
 
@@ -4330,8 +4990,16 @@ int runCommand(client *c) {
         queueMultiCommand(c);
         addReply(c,shared.queued);
     } else {
+        struct redisCommand *cmd = c->cmd;
+        long long misses = server.stat_keyspace_misses;
+
         call(c,CMD_CALL_FULL);
         c->woff = server.master_repl_offset;
+        /* Only the reads count misses. */
+        if (server.swap_mode && cmd->firstkey && !isSpecialConnection(c)
+            && isSSDBrespCmd(cmd) != C_OK)
+            swapTierRecord(cmd, server.stat_keyspace_misses != misses ?
+                           SWAP_TIER_MISS : SWAP_TIER_MEMORY);
     }
 
     serverLog(LL_DEBUG, "processing %s, fd: %d in redis: %s, dbid: %d, argc: %d",
@@ -4375,6 +5043,11 @@ int tryBlockingClient(client *c) {
         }
     }
 
+    if (server.swap_mode) {
+        ret = blockForPreloadingKeys(c);
+        if (ret != C_OK) return ret;
+    }
+
     /* Check if current cmd contains blocked keys. */
     if (server.swap_mode && c->argc > 1 && checkKeysInMediateState(c) == C_ERR) {
         /* Return C_ERR to keep client info and handle it later. */
@@ -4950,7 +5623,8 @@ sds printIntermediateSSDBkeys(sds info, dict* dictory) {
     dictIterator *di;
     sds key;
 
-    serverAssert(dictory->type == &keyDictType);
+    /* The state dicts have their own types, but all of them have sds keys. */
+    serverAssert(dictory->type->keyCompare == dictSdsKeyCompare);
 
     di = dictGetSafeIterator(dictory);
     while((de = dictNext(di)) != NULL) {
@@ -5525,7 +6199,19 @@ sds genRedisInfoString(char *section) {
                                     "keys_visiting_ssdb:%lu\r\n"
                                     "keys_delete_confirming:%lu\r\n"
                                     "keys_hot_to_be_load:%lu\r\n"
-                                    "keys_may_be_deleted:%lu\r\n",
+                                    "keys_may_be_deleted:%lu\r\n"
+                                    "keys_promoted_with_read:%lld\r\n"
+                                    "keys_promoted_with_read_dropped:%lld\r\n"
+                                    "keys_hot_in_ssdb:%lld\r\n"
+                                    "keys_hot_in_ssdb_pooled:%lld\r\n"
+                                    "keys_kept_in_ssdb:%lu\r\n"
+                                    "keys_evicted_clean:%lld\r\n"
+                                    "cross_tier_commands:%lld\r\n"
+                                    "batched_loads:%lld\r\n"
+                                    "batched_loaded_keys:%lld\r\n"
+                                    "transferring_bytes:%lld\r\n"
+                                    "evict_cycles:%lld\r\n"
+                                    "evict_cycle_keys:%lld\r\n",
                             dictSize(server.db[0].dict),
                             dictSize(EVICTED_DATA_DB->dict),
                             dictSize(EVICTED_DATA_DB->loading_hot_keys),
@@ -5533,9 +6219,49 @@ sds genRedisInfoString(char *section) {
                             dictSize(EVICTED_DATA_DB->visiting_ssdb_keys),
                             dictSize(EVICTED_DATA_DB->delete_confirm_keys),
                             dictSize(server.hot_keys),
-                            dictSize(server.maybe_deleted_ssdb_keys)
+                            dictSize(server.maybe_deleted_ssdb_keys),
+                            server.stat_promote_with_read,
+                            server.stat_promote_with_read_dropped,
+                            server.stat_ssdb_hot_keys,
+                            server.stat_ssdb_hot_keys_pooled,
+                            dictSize(server.ssdb_kept_keys),
+                            server.stat_clean_evictions,
+                            server.stat_ssdb_fanout_commands,
+                            server.stat_batched_loads,
+                            server.stat_batched_loaded_keys,
+                            server.ssdb_transferring_bytes,
+                            server.stat_evict_cycles,
+                            server.stat_evict_cycle_keys
+        );
+        info = genTransferDictInfoString(info);
+        info = genLoadAdmissionInfoString(info);
+        info = genSwapThrashInfoString(info);
+        info = genSSDBreadFlightInfoString(info);
+        info = genReplyCacheInfoString(info);
+        info = genSwapLimitInfoString(info);
+
+        info = sdscatprintf(info, "ssdb_output_pending_bytes:%lld\r\n"
+                                    "ssdb_output_paused_clients:%lu\r\n"
+                                    "ssdb_write_stalls:%lld\r\n"
+                                    "ssdb_output_paused:%lld\r\n",
+                            server.ssdb_output_pending_bytes,
+                            listLength(server.ssdb_output_paused_clients),
+                            server.stat_ssdb_write_stalls,
+                            server.stat_ssdb_output_paused
         );
 
+        if (server.ssdb_connection_pool_size) {
+            info = sdscatprintf(info, "ssdb_connection_pool_size:%d\r\n"
+                                        "ssdb_pool_waiting_replies:%lu\r\n"
+                                        "ssdb_pool_requests:%lld\r\n"
+                                        "ssdb_pool_orphaned_replies:%lld\r\n",
+                                server.ssdb_connection_pool_size,
+                                ssdbPoolWaitingReplies(),
+                                server.stat_ssdb_pool_requests,
+                                server.stat_ssdb_pool_orphaned
+            );
+        }
+
         if (server.masterhost) {
             info = sdscatprintf(info, "\r\nslave_unprocessed_transferring_or_loading_keys:%lu\r\n"
                                         "slave_write_op_list_num:%lu\r\n"
@@ -5553,6 +6279,23 @@ sds genRedisInfoString(char *section) {
             info = listAllIntermediateSSDBkeys(info);
         }
     }
+
+    /* Swap pipeline */
+    if (server.swap_mode && (allsections || !strcasecmp(section,"swap"))) {
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscat(info, "# Swap\r\n");
+        info = genSwapLatencyInfoString(info);
+        info = genSwapTierInfoString(info);
+        info = genSSDBshmRingInfoString(info);
+        info = genCoaccessInfoString(info);
+    }
+
+    /* Commands by tier */
+    if (server.swap_mode && (allsections || !strcasecmp(section,"tierstats"))) {
+        if (sections++) info = sdscat(info,"\r\n");
+        info = sdscat(info, "# Tierstats\r\n");
+        info = genSwapTierCommandsInfoString(info);
+    }
     return info;
 }
 
@@ -86,6 +86,7 @@ typedef long long mstime_t; /* millisecond time type. */
 #define C_RETURN                -5
 #define C_BLOCKED               -6
 #define C_NO_EXPIRE             -7
+#define C_REPLIED               -8
 
 /* SSDB connection flags in swap_mode */
 #define CONN_CONNECT_FAILED         (1<<0)
@@ -98,6 +99,8 @@ typedef long long mstime_t; /* millisecond time type. */
 #define CONN_SUCCESS                (1<<4) /* now we can send command to SSDB. */
 #define CONN_WAIT_WRITE_CHECK_REPLY (1<<9) /* for check write in replication process */
 #define CONN_WAIT_FLUSH_CHECK_REPLY (1<<10) /* for flush check when process 'flushall' */
+#define CONN_OUTPUT_PAUSED          (1<<11) /* don't process commands until the
+ * output buffer of the SSDB connection is drained, see ssdb_output_buffer_limit. */
 
 /* Default max argc of cmds sended to SSDB. */
 #define SSDB_CMD_DEFAULT_MAX_ARGC 10
@@ -231,7 +234,19 @@ long long test_incr_id;
 #define STATS_METRIC_COMMAND 0      /* Number of commands executed. */
 #define STATS_METRIC_NET_INPUT 1    /* Bytes read to network .*/
 #define STATS_METRIC_NET_OUTPUT 2   /* Bytes written to network. */
-#define STATS_METRIC_COUNT 3
+#define STATS_METRIC_SWAP_THRASH 3  /* Keys loaded soon after their eviction. */
+#define STATS_METRIC_SWAP_TIER 4    /* Commands served by every tier, SWAP_TIERS metrics. */
+#define STATS_METRIC_SSDB_OUTPUT (STATS_METRIC_SWAP_TIER+SWAP_TIERS) /* Bytes sent to SSDB. */
+#define STATS_METRIC_SSDB_INPUT (STATS_METRIC_SSDB_OUTPUT+1) /* Bytes read from SSDB. */
+#define STATS_METRIC_COUNT (STATS_METRIC_SSDB_INPUT+1)
+
+/* Tiers serving the commands, see swaptier.c. */
+#define SWAP_TIER_MEMORY 0  /* The key is in redis. */
+#define SWAP_TIER_SSDB 1    /* The command was sent to SSDB. */
+#define SWAP_TIER_SHARED 2  /* Answered with the reply to another read of SSDB. */
+#define SWAP_TIER_MISS 3    /* The key is nowhere. */
+#define SWAP_TIER_BLOCKED 4 /* Waited for its key being loaded or transferred. */
+#define SWAP_TIERS 5
 
 /* Protocol and I/O related defines */
 #define PROTO_MAX_QUERYBUF_LEN  (1024*1024*1024) /* 1GB max query buffer. */
@@ -333,6 +348,8 @@ long long test_incr_id;
 #define BLOCKED_NO_WRITE_TO_SSDB 11 /* Client is blocked as during the process of psync. */
 #define BLOCKED_NO_READ_WRITE_TO_SSDB 12 /* Client is blocked by ssdb flushall. */
 #define BLOCKED_WRITE_SAME_SSDB_KEY 13 /* client is blocked by another write on the same ssdb key*/
+#define BLOCKED_SSDB_READ_FLIGHT 14 /* Client waits for the reply of the same read sent by
+                                     * another client, see readflight.c. */
 /* ================================================= */
 /* the following types are blocked by the client itself. if block timeout, we must
  * disconnect this client to avoid receiving an unexpected response later, which may
@@ -345,6 +362,17 @@ long long test_incr_id;
 #define BLOCKED_MIGRATING_DUMP  25 /* Client is migrating in SSDB. */
 /* ================================================= */
 
+/* Stages of the swap pipeline, see swaplatency.c. */
+#define SWAP_LATENCY_VISITING 0         /* Blocked visiting SSDB. */
+#define SWAP_LATENCY_SSDB_REPLY 1       /* Relay of a reply of SSDB. */
+#define SWAP_LATENCY_BLOCKED_LOADING 2  /* Blocked by a key loading or transferring. */
+#define SWAP_LATENCY_READ_FLIGHT 3      /* Blocked by the read of another client. */
+#define SWAP_LATENCY_BLOCKED_OTHER 4    /* Blocked by flushall, a write on the same key... */
+#define SWAP_LATENCY_TRANSFER 5         /* Transfer of a key to SSDB. */
+#define SWAP_LATENCY_LOAD 6             /* Load of a key from SSDB. */
+#define SWAP_LATENCY_EVICT_CYCLE 7      /* Eviction cycle of serverCron(). */
+#define SWAP_LATENCY_STAGES 8
+
 
 /* Client request types */
 #define PROTO_REQ_INLINE 1
@@ -875,8 +903,41 @@ typedef struct client {
                      * to revert it from client buffer. */
     int first_key_index;
     long long visit_ssdb_start;
+    unsigned long long promote_id; /* Id of the rr_promote read in progress, 0 if none. */
+    struct client *ssdb_pool_conn; /* Pooled connection used to visit SSDB, NULL
+                                    * if the client has its own c->context. */
+    list *ssdb_pool_waiting; /* For pooled connections: the clients waiting for
+                              * a reply, in the order the commands were sent. */
+    int ssdb_pool_pending;   /* Replies still expected on ssdb_pool_conn. */
+    sds ssdb_obuf; /* Commands not written to the SSDB connection yet. */
+    struct ssdbFanout *ssdb_fanout; /* Multi-key command split between redis
+                                     * and SSDB, NULL if none. */
+    struct ssdbReadFlight *ssdb_read_flight; /* Read this client leads or
+                                              * follows, NULL if none. */
+    long long swap_blocked_since; /* ustime() it was blocked in a swap stage. */
+    struct ssdbShmRing *ssdb_shm_ring; /* Rings used instead of the socket of
+                                        * c->context, NULL if none. */
+    sds coaccess_key;       /* Last cold key accessed, NULL if none. */
+    mstime_t coaccess_time; /* When it was accessed. */
 } client;
 
+/* A multi-key command (MGET, MSET, DEL, EXISTS) whose keys are both in redis
+ * and in SSDB: the keys in redis are served at once, the command sent to SSDB
+ * only has the cold keys, and the two parts are merged in the reply. */
+typedef struct ssdbFanout {
+    int numkeys;            /* Keys of the original command. */
+    unsigned char *cold;    /* Per key: 1 if the reply comes from SSDB. */
+    robj **vals;            /* MGET: values of the keys in redis. */
+    long long count;        /* DEL/EXISTS: keys counted in redis. */
+} ssdbFanout;
+
+/* A key loaded from SSDB while SSDB keeps its copy, see server.ssdb_kept_keys. */
+typedef struct ssdbKeptKey {
+    unsigned long long version; /* Transfer id of the load. */
+    long long expire;           /* Expire of the copy in SSDB, -1 if none. */
+    int dirty;                  /* Modified in redis since it was loaded. */
+} ssdbKeptKey;
+
 #define TYPE_TRANSFER_TO_SSDB 999
 #define TYPE_LOAD_KEY_FORM_SSDB 888
 
@@ -1059,7 +1120,10 @@ struct redisServer {
     int hz;                     /* serverCron() calls frequency in hertz */
     redisDb *db;
     dict *hot_keys;             /* dict of keys is to be loaded from SSDB to redis. */
+    dict *swap_key_states;      /* keys in some intermediate state -> SWAP_KEY_* flags. */
     dict *maybe_deleted_ssdb_keys;/* dict of keys that are maybe deleted in SSDB and need to confirm. */
+    dict *ssdb_kept_keys;       /* keys loaded to redis whose copy is still in SSDB. */
+    dict *ssdb_promoting_keys;  /* cold keys with a promoting read in flight -> its id. */
     dict *commands;             /* Command table */
     dict *orig_commands;        /* Command table before command renaming. */
     aeEventLoop *el;
@@ -1097,6 +1161,8 @@ struct redisServer {
                                  * replication state. */
     client *slave_ssdb_load_evict_client;
     client *expired_delete_client; /* use this client to delete expired ssdb keys */
+    client **ssdb_pool;         /* Connections shared by user clients, see
+                                 * ssdb_connection_pool_size. */
     int cfd[CONFIG_BINDADDR_MAX];/* Cluster bus listening socket */
     int cfd_count;              /* Used slots in cfd[] */
     list *clients;              /* List of active clients */
@@ -1439,6 +1505,8 @@ struct redisServer {
     list *storetossdb_migrate_keys;
 
     unsigned long long global_transfer_id;
+    /* Bumped by every write, load and transfer of cold keys, see readflight.c. */
+    unsigned long long ssdb_write_epoch;
 
     /* rules for loading hot keys in ssdb */
     int load_test_mode;
@@ -1459,6 +1527,25 @@ struct redisServer {
     time_t ssdb_down_time;
     int slave_ssdb_critical_err_cnt;
     long long stat_keyspace_ssdb_hits;   /* Number of successful lookups of keys in SSDB. */
+    long long stat_promote_with_read;    /* Keys loaded with the reply of a read. */
+    long long stat_promote_with_read_dropped; /* Piggy-backed payloads not used. */
+    long long stat_ssdb_hot_keys;        /* Promotion candidates pushed by SSDB. */
+    long long stat_ssdb_hot_keys_pooled; /* Of them, cold keys put in the hot pool. */
+    long long stat_clean_evictions;      /* Keys evicted without re-transfer. */
+    long long stat_ssdb_pool_requests;   /* Commands sent on pooled connections. */
+    long long stat_ssdb_pool_orphaned;   /* Replies whose client went away. */
+    long long ssdb_output_pending_bytes; /* Bytes buffered for SSDB connections. */
+    list *ssdb_output_paused_clients;    /* Clients paused by a full output buffer. */
+    long long stat_ssdb_write_stalls;    /* Commands SSDB couldn't take at once. */
+    long long stat_ssdb_output_paused;   /* Times a client was paused. */
+    long long stat_ssdb_fanout_commands; /* Multi-key commands split per tier. */
+    long long stat_batched_loads;        /* Batches of keys loaded for EXEC/EVAL. */
+    long long stat_batched_loaded_keys;  /* Keys loaded in these batches. */
+    long long ssdb_transferring_bytes;   /* Restore commands waiting for SSDB. */
+    long long stat_evict_cycles;         /* Eviction cycles that started transfers. */
+    long long stat_evict_cycle_keys;     /* Transfers started by these cycles. */
+    long long stat_swap_thrash;          /* Keys loaded within the thrash window
+                                            after their eviction. */
 
     int client_visiting_ssdb_timeout;
     int client_blocked_by_keys_timeout;
@@ -1472,11 +1559,50 @@ struct redisServer {
     int slave_transfer_ssdb_snapshot_timeout;
     int master_max_concurrent_loading_keys;
     int master_max_concurrent_transferring_keys;
+    long long ssdb_evict_cycle_budget_us; /* Time an eviction cycle can take
+                                             when used memory hits maxmemory. */
+    long long ssdb_read_coalescing_window_us; /* Identical reads of a cold key sent
+                                                 within it share a reply, 0 to disable. */
+    long long ssdb_transfer_target_latency_us; /* Transfers slower than that
+                                                  lower the limits, 0 for static limits. */
+    long long ssdb_reply_cache_size; /* Memory for replies of SSDB to reads of
+                                        cold keys, 0 to disable. */
+    long long ssdb_transfer_max_inflight_bytes; /* Bytes of transfers waiting
+                                                   for SSDB, 0 for no limit. */
     int slave_max_concurrent_ssdb_swap_count;
     int slave_max_ssdb_swap_count_everytime;
 
     int coldkey_filter_times_everytime;
     int lowest_idle_val_of_cold_key;
+    int transfer_dict_compression; /* Compress transfer payloads with a
+                                      dictionary shared with SSDB. */
+    int transfer_dict_size;
+    int ssdb_promote_with_read; /* Ask SSDB for the dump of hot cold keys
+                                   along with the reply of a read. */
+    int ssdb_keep_loaded_keys;  /* SSDB keeps the keys it loads to redis, so
+                                   unmodified keys are evicted without transfer. */
+    int ssdb_load_admission;    /* Load cold keys more frequent than the keys
+                                   they would evict only. */
+    int ssdb_size_aware_swap;   /* Weigh the size of keys to evict and load. */
+    long long ssdb_thrash_window;  /* Seconds after an eviction a load is a thrash. */
+    long long ssdb_thrash_ghost_entries; /* Evicted and loaded keys remembered
+                                            to detect thrash. */
+    long long ssdb_min_residency;  /* Seconds a loaded key can't be evicted. */
+    int ssdb_thrash_load_penalty;  /* LFU steps needed to load a key evicted
+                                      within the thrash window. */
+    int ssdb_connection_pool_size; /* Connections shared by user clients to
+                                      visit SSDB, 0 for one per client. Also
+                                      the limit of their commands run by SSDB
+                                      at the same time, see ssdbConnectionOf. */
+    long long ssdb_output_buffer_limit; /* Stop processing the commands of a client
+                                           when the output buffer of its SSDB
+                                           connection is larger, 0 for no limit. */
+    long long ssdb_shm_ring_size; /* Shared memory rings replacing the socket
+                                     of new SSDB connections, 0 to disable. */
+    long long ssdb_coaccess_keys; /* Cold keys tracked with the keys accessed
+                                     after them, 0 to disable. */
+    long long ssdb_coaccess_window_ms; /* Max delay between two accesses of a
+                                          client counted as related. */
     /*=======================[END]for swap mode========================*/
 
     /* Mutexes used to protect atomic variables when atomic builtins are
@@ -1507,6 +1633,7 @@ struct redisCommand {
     int lastkey;  /* The last argument that's a key */
     int keystep;  /* The step between first and last key */
     long long microseconds, calls;
+    long long swap_tiers[SWAP_TIERS]; /* Calls by tier serving them. */
 };
 
 struct expiretimeInfo {
@@ -1585,6 +1712,8 @@ extern dictType zsetDictType;
 extern dictType clusterNodesDictType;
 extern dictType clusterNodesBlackListDictType;
 extern dictType dbDictType;
+extern dictType transferringKeysDictType;
+extern dictType swapStateKeyDictType;
 extern dictType shaScriptObjectDictType;
 extern double R_Zero, R_PosInf, R_NegInf, R_Nan;
 extern dictType hashDictType;
@@ -1592,6 +1721,7 @@ extern dictType replScriptCacheDictType;
 extern dictType keyptrDictType;
 extern dictType modulesDictType;
 extern dictType keyDictType;
+extern dictType keptKeyDictType;
 
 /*-----------------------------------------------------------------------------
  * Functions prototypes
@@ -1636,16 +1766,26 @@ void acceptHandler(aeEventLoop *el, int fd, void *privdata, int mask);
 void acceptTcpHandler(aeEventLoop *el, int fd, void *privdata, int mask);
 void acceptUnixHandler(aeEventLoop *el, int fd, void *privdata, int mask);
 void ssdbClientUnixHandler(aeEventLoop *el, int fd, void *private, int mask);
-int syncReadReply(redisContext *c, void **reply, long long timeout);
+void ssdbClientWritableHandler(aeEventLoop *el, int fd, void *privdata, int mask);
+int syncWriteSSDBoutput(client *c, long long timeout);
+int syncReadReply(client *c, void **reply, long long timeout);
 int isSpecialConnection(client *c);
 client* createSpecialSSDBclient();
 void connectSepecialSSDBclients();
+client *ssdbConnectionOf(client *c);
+unsigned long ssdbPoolWaitingReplies(void);
+int pauseClientIfSSDBoutputFull(client *c);
+void replyToSSDBfanout(client *c);
+void replyToSSDBscan(client *c);
+int isSSDBscanAllowed(client *c);
+void freeSSDBfanout(client *c);
 void readQueryFromClient(aeEventLoop *el, int fd, void *privdata, int mask);
 void addReplyString(client *c, const char *s, size_t len);
 void addReplyBulk(client *c, robj *obj);
 void addReplyBulkCString(client *c, const char *s);
 void addReplyBulkCBuffer(client *c, const void *p, size_t len);
 void addReplyBulkLongLong(client *c, long long ll);
+void addReplyBulkUnsignedLong(client *c, unsigned long ul);
 void addReply(client *c, robj *obj);
 void addReplySds(client *c, sds s);
 void addReplyBulkSds(client *c, sds s);
@@ -1933,7 +2073,8 @@ void handleClientsBlockedOnFlushall(void);
 void handleClientsBlockedOnMigrate(void);
 void handleLoadAndEvictCmdInSlave(void);
 void prepareSSDBreplication(client* slave);
-int tryEvictingKeysToSSDB(size_t *mem_tofree);
+int transferLimitReached(void);
+int tryEvictingKeysToSSDB(size_t *mem_tofree, long long deadline);
 size_t objectComputeSize(robj *o, size_t sample_size);
 size_t estimateKeyMemoryUsage(dictEntry *de);
 int processCommand(client *c);
@@ -1948,6 +2089,7 @@ int processCommandMaybeInSSDB(client *c);
 int isMigratingSSDBKey(sds keysds);
 int addMigratingSSDBKey(sds keysds);
 int delMigratingSSDBKey(sds keysds);
+unsigned long swapKeyState(sds key);
 int isSSDBrespCmd(struct redisCommand *cmd);
 void setupSignalHandlers(void);
 struct redisCommand *lookupCommand(sds name);
@@ -1979,6 +2121,8 @@ void adjustOpenFilesLimit(void);
 void closeListeningSockets(int unlink_unix_socket);
 void updateCachedTime(void);
 void resetServerStats(void);
+void trackInstantaneousMetric(int metric, long long current_reading);
+long long getInstantaneousMetric(int metric);
 void activeDefragCycle(void);
 unsigned int getLRUClock(void);
 unsigned int LRU_CLOCK(void);
@@ -1989,6 +2133,14 @@ void freeMemoryOverheadData(struct redisMemOverhead *mh);
 #define EVICTED_DATA_DBID (server.dbnum - 1)
 #define EVICTED_DATA_DB (server.db + server.dbnum - 1)
 
+/* Intermediate states of a key in swap mode, one per dict tracking it. */
+#define SWAP_KEY_TRANSFERRING (1<<0)    /* EVICTED_DATA_DB->transferring_keys */
+#define SWAP_KEY_LOADING (1<<1)         /* EVICTED_DATA_DB->loading_hot_keys */
+#define SWAP_KEY_VISITING (1<<2)        /* EVICTED_DATA_DB->visiting_ssdb_keys */
+#define SWAP_KEY_DELETE_CONFIRM (1<<3)  /* EVICTED_DATA_DB->delete_confirm_keys */
+#define SWAP_KEY_HOT (1<<4)             /* server.hot_keys */
+#define SWAP_KEY_MIGRATING (1<<5)       /* server.db[0].migrating_ssdb_keys */
+
 #define RESTART_SERVER_NONE 0
 #define RESTART_SERVER_GRACEFULLY (1<<0)     /* Do proper shutdown. */
 #define RESTART_SERVER_CONFIG_REWRITE (1<<1) /* CONFIG REWRITE before restart.*/
@@ -2058,7 +2210,13 @@ int removeExpire(redisDb *db, robj *key);
 void propagateExpire(redisDb *db, robj *key, int lazy);
 int expireIfNeeded(redisDb *db, robj *key);
 long long getExpire(redisDb *db, robj *key);
-void setTransferringDB(redisDb *db, robj *key, unsigned long long id);
+/* Value of EVICTED_DATA_DB->transferring_keys. */
+typedef struct transferringKey {
+    unsigned long long id;      /* Transfer id echoed by SSDB. */
+    size_t bytes;               /* Size of the restore command sent. */
+    long long start;            /* ustime() the restore was sent. */
+} transferringKey;
+void setTransferringDB(redisDb *db, robj *key, unsigned long long id, size_t bytes);
 void setLoadingDB(robj *key, unsigned long long id);
 void setExpire(client *c, redisDb *db, robj *key, long long when);
 robj *lookupKey(redisDb *db, robj *key, int flags);
@@ -2316,6 +2474,7 @@ void watchCommand(client *c);
 void unwatchCommand(client *c);
 void clusterCommand(client *c);
 void restoreCommand(client *c);
+void restoreGenericCommand(client *c, int loaded);
 void migrateCommand(client *c);
 void askingCommand(client *c);
 void readonlyCommand(client *c);
@@ -2355,6 +2514,7 @@ void ssdbRespDelCommand(client *c);
 void ssdbRespRestoreCommand(client *c);
 void ssdbRespFailCommand(client *c);
 void ssdbRespNotfoundCommand(client *c);
+void ssdbRespHotCommand(client *c);
 void ssdbNotifyCommand(client* c);
 void storetossdbCommand(client *c);
 void locatekeyCommand(client *c);
@@ -2364,10 +2524,116 @@ void slaveDelCommand(client *c);
 void dumpfromssdbCommand(client *c);
 int prologOfEvictingToSSDB(robj *keyobj, redisDb *db);
 int prologOfLoadingFromSSDB(client* c, robj *keyobj);
+void prologOfLoadingRelatedKeysFromSSDB(robj *keyobj);
+int prologOfLoadingKeysFromSSDB(robj **keys, int numkeys);
+int isMeetLoadCondition(void);
+int isMemoryEnoughToLoad(void);
+int isCommandUsingSSDBkeys(struct redisCommand *cmd, robj **argv, int argc);
 int removeVisitingSSDBKey(struct redisCommand *cmd, int argc, robj** argv);
 void handleCustomizedBlockedClients();
 int tryBlockingClient(client *c);
 int handleResponseOfMigrateDump(client *c);
+int isColdKeyHot(robj *keyobj);
+int sendPromotingReadToSSDB(client *c, robj *keyobj);
+void handlePromotingReadReply(client *c);
+void forgetPromotingRead(client *c);
+void forgetPromotingKey(sds key);
+void epilogOfLoadingFromSSDB(client *c, robj *key, robj *ttl, robj *payload, long long dict_decoded);
+void keepLoadedKeyCopy(robj *key, unsigned long long version);
+void markKeptKeyDirty(robj *key);
+void forgetKeptKeyCopy(robj *key);
+void loadKeptKeyCopy(sds key);
+int isSSDBkeyCleaning(sds key);
+
+/* transdict.c -- dictionary shared with SSDB for transfer payloads */
+void transferDictFeed(robj *o);
+void transferDictSync(void);
+void transferDictConnectionLost(void);
+int handleResponseOfTransferDict(redisReply *reply);
+void transferDictBeginPayload(void);
+void transferDictEndPayload(void);
+const char *transferDictForEncoding(uint32_t *version, size_t *len);
+void transferDictCountEncoded(size_t in, size_t out);
+const char *transferDictLookup(uint32_t version, size_t *len);
+void transferDictCountDecoded(int ok);
+long long transferDictDecodedCount(void);
+sds genTransferDictInfoString(sds info);
+
+/* admission.c -- TinyLFU admission of the keys loaded from SSDB */
+void loadAdmissionRecord(sds key);
+int loadAdmissionAllows(sds key);
+void loadAdmissionRelease(void);
+sds genLoadAdmissionInfoString(sds info);
+
+/* thrash.c -- Detection of keys swapped back and forth */
+void swapGhostEvicted(sds key);
+void swapGhostLoaded(sds key);
+int swapGhostResident(sds key);
+unsigned long swapGhostLoadPenalty(sds key);
+void swapGhostResize(void);
+sds genSwapThrashInfoString(sds info);
+
+/* readflight.c -- Coalescing of identical reads of a cold key */
+int joinSSDBreadFlight(client *c);
+void startSSDBreadFlight(client *c);
+void feedSSDBreadFlight(client *c, const char *s, size_t len);
+void finishSSDBreadFlight(client *c, int ok);
+void leaveSSDBreadFlight(client *c);
+sds ssdbReadSignature(client *c);
+sds genSSDBreadFlightInfoString(sds info);
+
+/* replycache.c -- Cache of the replies of SSDB to reads of cold keys */
+int replyCacheable(client *c);
+int replyCacheLookup(client *c);
+void replyCacheStore(sds key, sds sig, sds reply);
+void replyCacheInvalidate(sds key);
+void replyCacheResize(void);
+void replyCacheFlush(void);
+sds genReplyCacheInfoString(sds info);
+
+/* swaplimit.c -- Adaptive limits of the transfers and loads in flight */
+int swapTransferLimit(void);
+int swapLoadingLimit(void);
+void swapLimitReached(int loading);
+void swapLimitTransferConfirmed(long long start, long long queued);
+void swapLimitCron(void);
+long long swapLimitSSDBqueued(void);
+sds genSwapLimitInfoString(sds info);
+
+/* swaplatency.c -- Latency of the stages of the swap pipeline */
+void swapLatencyRecord(int stage, long long us);
+void swapLatencyBlocked(client *c);
+void swapLatencyUnblocked(client *c);
+void swapLatencyLoadStarted(unsigned long long id);
+void swapLatencyLoadDone(unsigned long long id);
+void swapCommand(client *c);
+sds genSwapLatencyInfoString(sds info);
+
+/* swaptier.c -- Accounting of the tier serving every command */
+void swapTierRecord(struct redisCommand *cmd, int tier);
+void swapTierOutput(size_t bytes);
+void swapTierInput(size_t bytes);
+void swapTierTransferred(size_t bytes);
+void swapTierLoaded(size_t bytes);
+void swapTierTrackMetrics(void);
+void swapTierResetStats(void);
+void swapTiersCommand(client *c);
+sds genSwapTierInfoString(sds info);
+sds genSwapTierCommandsInfoString(sds info);
+
+/* shmring.c -- Shared memory rings between redis and SSDB */
+int attachSSDBshmRing(client *c);
+void detachSSDBshmRing(client *c);
+size_t writeSSDBshmRing(client *c, const char *buf, size_t len);
+int readSSDBshmRing(client *c);
+sds genSSDBshmRingInfoString(sds info);
+
+/* swapcoaccess.c -- Co-access prefetch of related cold keys */
+void coaccessRecord(client *c, sds key);
+int coaccessRelatedKeys(sds key, robj **related);
+void coaccessPrefetched(int numkeys);
+void coaccessResize(void);
+sds genCoaccessInfoString(sds info);
 void addClientToListForBlockedKey(client *c, struct redisCommand* cmd, dict* blocked_dict, robj* keyobj);
 void removeClientFromListForBlockedKey(client* c, dict* blocked_dict, robj* key);
 void sendDelSSDBsnapshot();
@@ -2376,10 +2642,17 @@ void doSSDBflushIfCheckDone();
 void makeSSDBsnapshotIfCheckOK();
 void loadThisKeyImmediately(sds key);
 void addHotKeys();
+sds coldKeyEvictionVictim(void);
+unsigned long long coldKeyEvictionScore(dictEntry *de, unsigned long counter);
+int coldKeySizeClass(size_t bytes);
+unsigned long coldKeyLoadThreshold(sds key);
+int memoryReachTransferLowerLimit();
+int memoryReachLoadUpperLimit();
 void updateSlaveSSDBwriteIndex();
 int updateSendRepopidToSSDB(client* c);
 void saveSlaveSSDBwriteOp(client *c, time_t time, int index);
 void unblockClientWritingOnSameKey(robj* keyobj);
+void handleSSDBconnectionDisconnect(client* c);
 int closeAndReconnectSSDBconnection(client* c);
 
 void processInputBufferOfMaster(client* c);
@@ -2444,7 +2717,10 @@ int isThisKeyVisitingWriteSSDB(sds key);
 
 /* config options for swap mode */
 #define MASTER_MAX_CONCURRENT_LOADING_KEYS 5
+/* Transfers are mainly limited by ssdb-transfer-max-inflight-bytes. */
 #define MASTER_MAX_CONCURRENT_TRANSFERRING_KEYS 5
+#define SSDB_EVICT_CYCLE_BUDGET_US 1000
+#define SSDB_TRANSFER_MAX_INFLIGHT_BYTES (16*1024*1024)
 
 #define SLAVE_MAX_CONCURRENT_SSDB_SWAP_COUNT 10
 #define SLAVE_MAX_SSDB_SWAP_COUNT_EVERYTIME 2
@@ -2455,4 +2731,45 @@ int isThisKeyVisitingWriteSSDB(sds key);
 
 #define LOWEST_IDLE_VAL_OF_COLD_KEY (255-LFU_INIT_VAL+1)
 
+#define TRANSFER_DICT_COMPRESSION 0
+#define TRANSFER_DICT_SIZE 4096
+/* LZF back references reach 8k bytes at most, a longer dictionary is useless. */
+#define TRANSFER_DICT_MAX_SIZE 8192
+
+#define SSDB_PROMOTE_WITH_READ 0
+#define SSDB_KEEP_LOADED_KEYS 0
+#define SSDB_LOAD_ADMISSION 0
+#define SSDB_SIZE_AWARE_SWAP 0
+/* Size of a key whose transfer costs twice a round trip to SSDB. */
+#define SSDB_TRANSFER_COST_BYTES (1024*1024)
+/* Cold keys below 128KB are loaded as soon as they are hot, each bigger
+ * size class needs one more LFU step. */
+#define SSDB_LOAD_FREE_SIZE_CLASS 17
+#define SSDB_THRASH_WINDOW 60
+#define SSDB_THRASH_GHOST_ENTRIES (1<<14)
+#define SWAP_GHOST_MAX_ENTRIES (1LL<<30)
+#define SSDB_MIN_RESIDENCY 0
+#define SSDB_THRASH_LOAD_PENALTY 0
+#define SSDB_READ_COALESCING_WINDOW_US 0
+#define SSDB_REPLY_CACHE_SIZE 0
+#define SSDB_TRANSFER_TARGET_LATENCY_US 0
+#define SWAP_LIMIT_PERIOD_MS 100
+#define SSDB_CONNECTION_POOL_SIZE 0
+#define SSDB_CONNECTION_POOL_MAX_SIZE 1024
+#define SSDB_OUTPUT_BUFFER_LIMIT (8*1024*1024)
+#define SSDB_SHM_RING_SIZE 0
+#define SSDB_COACCESS_KEYS 0
+#define SSDB_COACCESS_WINDOW_MS 100
+/* Related keys tracked per cold key, and loaded along with it at most. */
+#define COACCESS_SUCCESSORS 4
+
+/* In swap mode SCAN walks redis first, then SSDB: the cursors of the SSDB
+ * part have this bit set, the rest of the bits is the cursor of SSDB.
+ *
+ * A key loaded from SSDB once the redis part is done is only returned if
+ * SSDB keeps its copy (ssdb-keep-loaded-keys), otherwise SCAN misses it:
+ * the keys moving from SSDB to redis during the iteration are not
+ * guaranteed to be returned. */
+#define SCAN_SSDB_CURSOR_FLAG (1UL<<63)
+
 #endif
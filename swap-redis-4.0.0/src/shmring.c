@@ -0,0 +1,324 @@
+/* Shared memory rings between redis and SSDB on the same host.
+ *
+ * Everything sent to SSDB and read back goes through the unix socket, with
+ * two copies through the kernel, which shows with big replies and with the
+ * dumps of the transfers. With ssdb-shm-ring-size set, every new connection
+ * to SSDB creates a file in SHM_RING_DIR with two single producer, single
+ * consumer rings of that size, for the commands and for the replies, and
+ * asks SSDB to map it with "rr_shm_ring <path> <size>". The file is unlinked
+ * once SSDB replied, if SSDB can't map it the connection keeps using the
+ * socket.
+ *
+ * The commands and replies keep their framing, they are only written to
+ * the rings instead of the socket. The socket stays open for the event
+ * loops: a side waiting for data, or for room in a full ring, asks to be
+ * woken up by a byte written on the socket, and the hangup of SSDB is seen
+ * as before.
+ *
+ * The layout must be the same as in net/shm_ring.h of swap-ssdb.
+ */
+
+#include "server.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#define SHM_RING_DIR "/dev/shm"
+#define SHM_RING_MAGIC 0x31474e5250415753ULL /* "SWAPRNG1" */
+#define SHM_RING_MIN_SIZE (64*1024)
+#define SHM_RING_MAX_SIZE (1024*1024*1024)
+#define SHM_RING_HANDSHAKE_TIMEOUT 1000
+
+/* A ring, followed by its data. Head and tail are never wrapped, they are
+ * on their own cache line as each of them is written by one side only. */
+typedef struct shmRing {
+    uint64_t magic;
+    uint64_t size;              /* Of the data, a power of two. */
+    char pad0[48];
+    uint64_t head;              /* Bytes written, by the producer only. */
+    char pad1[56];
+    uint64_t tail;              /* Bytes read, by the consumer only. */
+    char pad2[56];
+    uint32_t consumer_waiting;  /* The consumer wants a doorbell for data. */
+    uint32_t producer_blocked;  /* The producer wants a doorbell for room. */
+    char pad3[56];
+} shmRing;
+
+typedef struct ssdbShmRing {
+    void *map;
+    size_t len;
+    shmRing *out;               /* Commands to SSDB. */
+    shmRing *in;                /* Replies of SSDB. */
+} ssdbShmRing;
+
+static struct {
+    unsigned long rings;
+    long long bytes_out;
+    long long bytes_in;
+    long long doorbells_out;
+    long long doorbells_in;
+    long long full;             /* Commands left in c->ssdb_obuf, ring full. */
+    long long fallbacks;        /* Connections left on the socket. */
+} sr;
+
+static char *shmRingData(shmRing *r) {
+    return (char *)r + sizeof(shmRing);
+}
+
+/* Consumer side. */
+static uint64_t shmRingUsed(shmRing *r) {
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - r->tail;
+}
+
+/* Producer side. */
+static uint64_t shmRingFree(shmRing *r) {
+    return r->size - (r->head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE));
+}
+
+static size_t shmRingWrite(shmRing *r, const char *buf, size_t len) {
+    uint64_t n = shmRingFree(r), pos, first;
+
+    if (n > len) n = len;
+    if (n == 0) return 0;
+    pos = r->head & (r->size-1);
+    first = r->size-pos < n ? r->size-pos : n;
+    memcpy(shmRingData(r)+pos, buf, first);
+    memcpy(shmRingData(r), buf+first, n-first);
+    __atomic_store_n(&r->head, r->head+n, __ATOMIC_RELEASE);
+    return n;
+}
+
+/* The consumer found the ring empty, return 0 if data came in meanwhile. */
+static int shmRingSleep(shmRing *r) {
+    __atomic_store_n(&r->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return shmRingUsed(r) == 0;
+}
+
+/* The producer wrote, return 1 if the consumer must be woken up. */
+static int shmRingWakeConsumer(shmRing *r) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&r->consumer_waiting, __ATOMIC_SEQ_CST)
+        && __atomic_exchange_n(&r->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+}
+
+/* The producer found the ring full, return 0 if room was made meanwhile. */
+static int shmRingBlock(shmRing *r) {
+    __atomic_store_n(&r->producer_blocked, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return shmRingFree(r) == 0;
+}
+
+/* The consumer read, return 1 if the producer must be woken up. */
+static int shmRingWakeProducer(shmRing *r) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&r->producer_blocked, __ATOMIC_SEQ_CST)
+        && __atomic_exchange_n(&r->producer_blocked, 0, __ATOMIC_SEQ_CST);
+}
+
+static void ringSSDBdoorbell(client *c) {
+    char b = 0;
+
+    /* A doorbell already in the socket is as good. */
+    while (write(c->context->fd, &b, 1) == -1 && errno == EINTR);
+    sr.doorbells_out++;
+}
+
+/* ssdb-shm-ring-size rounded up to a power of two. */
+static size_t shmRingSize(void) {
+    size_t size = SHM_RING_MIN_SIZE;
+
+    while (size < (size_t)server.ssdb_shm_ring_size && size < SHM_RING_MAX_SIZE)
+        size <<= 1;
+    return size;
+}
+
+/* Ask SSDB to use the rings at 'path', return C_ERR if the connection is
+ * broken, otherwise set '*ok' to 1 if SSDB mapped them. */
+static int shmRingHandshake(client *c, const char *path, size_t size, int *ok) {
+    redisReply *reply = NULL, *check = NULL;
+    const char *argv[3];
+    char sizestr[32];
+    sds cmd;
+    int ret = C_ERR;
+
+    ll2string(sizestr, sizeof(sizestr), size);
+    argv[0] = "rr_shm_ring";
+    argv[1] = path;
+    argv[2] = sizestr;
+    cmd = composeRedisCmd(3, argv, NULL);
+    if (!cmd) return C_ERR;
+
+    /* SSDB sends a check reply after every reply on the unix socket. */
+    if (syncWrite(c->context->fd, cmd, sdslen(cmd), SHM_RING_HANDSHAKE_TIMEOUT) == (ssize_t)sdslen(cmd)
+        && syncReadReply(c, (void **)&reply, SHM_RING_HANDSHAKE_TIMEOUT) == REDIS_OK
+        && syncReadReply(c, (void **)&check, SHM_RING_HANDSHAKE_TIMEOUT) == REDIS_OK)
+    {
+        *ok = reply->type == REDIS_REPLY_STATUS && !strcasecmp(reply->str, "ok");
+        if (!*ok)
+            serverLog(LL_VERBOSE, "SSDB can't use the shared memory ring: %s",
+                      reply->type == REDIS_REPLY_ERROR ? reply->str : "unexpected reply");
+        ret = C_OK;
+    }
+    if (reply) freeReplyObject(reply);
+    if (check) freeReplyObject(check);
+    sdsfree(cmd);
+    return ret;
+}
+
+/* Called once connected to SSDB, before anything is sent. Return C_ERR if
+ * the connection is broken, C_OK if it uses the rings or the socket. */
+int attachSSDBshmRing(client *c) {
+    static unsigned long long seq = 0;
+    size_t size = shmRingSize(), len = 2*(sizeof(shmRing)+size);
+    char path[128];
+    void *map;
+    int fd, ok = 0;
+    ssdbShmRing *ring;
+
+    snprintf(path, sizeof(path), "%s/swapdb-%ld-%llu", SHM_RING_DIR,
+             (long)getpid(), ++seq);
+    fd = open(path, O_RDWR|O_CREAT|O_EXCL, 0600);
+    if (fd == -1) {
+        serverLog(LL_WARNING, "Can't create the shared memory ring %s: %s",
+                  path, strerror(errno));
+        sr.fallbacks++;
+        return C_OK;
+    }
+    if (ftruncate(fd, len) == -1 ||
+        (map = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        serverLog(LL_WARNING, "Can't map the shared memory ring %s: %s",
+                  path, strerror(errno));
+        close(fd);
+        unlink(path);
+        sr.fallbacks++;
+        return C_OK;
+    }
+    close(fd);
+
+    ring = zmalloc(sizeof(*ring));
+    ring->map = map;
+    ring->len = len;
+    ring->out = map;
+    ring->in = (shmRing *)((char *)map+sizeof(shmRing)+size);
+    ring->out->magic = ring->in->magic = SHM_RING_MAGIC;
+    ring->out->size = ring->in->size = size;
+    /* Nothing was read yet, both sides want a doorbell for the first data. */
+    ring->out->consumer_waiting = ring->in->consumer_waiting = 1;
+
+    if (shmRingHandshake(c, path, size, &ok) == C_ERR) ok = -1;
+    /* Mapped by SSDB or not, nobody else needs the file. */
+    unlink(path);
+    if (ok != 1) {
+        munmap(map, len);
+        zfree(ring);
+        if (ok == 0) sr.fallbacks++;
+        return ok == 0 ? C_OK : C_ERR;
+    }
+
+    c->ssdb_shm_ring = ring;
+    sr.rings++;
+    return C_OK;
+}
+
+void detachSSDBshmRing(client *c) {
+    ssdbShmRing *ring = c->ssdb_shm_ring;
+
+    munmap(ring->map, ring->len);
+    zfree(ring);
+    c->ssdb_shm_ring = NULL;
+    sr.rings--;
+}
+
+/* Write as much as possible of 'buf' to the ring of 'c', return the bytes
+ * written. What's left is written once SSDB rings for room. */
+size_t writeSSDBshmRing(client *c, const char *buf, size_t len) {
+    shmRing *r = c->ssdb_shm_ring->out;
+    size_t written = 0;
+
+    while (written < len) {
+        size_t n = shmRingWrite(r, buf+written, len-written);
+
+        written += n;
+        if (!n && shmRingBlock(r)) {
+            sr.full++;
+            break;
+        }
+    }
+    if (written && shmRingWakeConsumer(r)) ringSSDBdoorbell(c);
+    sr.bytes_out += written;
+    return written;
+}
+
+static void setSSDBreadError(redisContext *ctx, int type, const char *str) {
+    ctx->err = type;
+    snprintf(ctx->errstr, sizeof(ctx->errstr), "%s", str);
+}
+
+/* Like redisBufferRead() for a connection on rings: take the doorbells from
+ * the socket, then feed the reader with all the replies in the ring, as
+ * there is no doorbell for what is left. */
+int readSSDBshmRing(client *c) {
+    redisContext *ctx = c->context;
+    shmRing *r = c->ssdb_shm_ring->in;
+    char buf[256];
+    int nread, consumed = 0;
+    uint64_t used;
+
+    if (ctx->err) return REDIS_ERR;
+
+    while ((nread = read(ctx->fd, buf, sizeof(buf))) != 0) {
+        if (nread == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            setSSDBreadError(ctx, REDIS_ERR_IO, strerror(errno));
+            return REDIS_ERR;
+        }
+        sr.doorbells_in += nread;
+    }
+    if (nread == 0) {
+        setSSDBreadError(ctx, REDIS_ERR_EOF, "Server closed the connection");
+        return REDIS_ERR;
+    }
+
+    do {
+        while ((used = shmRingUsed(r)) > 0) {
+            uint64_t pos = r->tail & (r->size-1);
+            uint64_t first = r->size-pos < used ? r->size-pos : used;
+
+            if (redisReaderFeed(ctx->reader, shmRingData(r)+pos, first) != REDIS_OK ||
+                (used > first &&
+                 redisReaderFeed(ctx->reader, shmRingData(r), used-first) != REDIS_OK))
+            {
+                setSSDBreadError(ctx, ctx->reader->err, ctx->reader->errstr);
+                return REDIS_ERR;
+            }
+            __atomic_store_n(&r->tail, r->tail+used, __ATOMIC_RELEASE);
+            sr.bytes_in += used;
+            consumed = 1;
+        }
+    } while (!shmRingSleep(r));
+
+    if (consumed && shmRingWakeProducer(r)) ringSSDBdoorbell(c);
+    return REDIS_OK;
+}
+
+sds genSSDBshmRingInfoString(sds info) {
+    return sdscatprintf(info,
+        "ssdb_shm_rings:%lu\r\n"
+        "ssdb_shm_ring_bytes_out:%lld\r\n"
+        "ssdb_shm_ring_bytes_in:%lld\r\n"
+        "ssdb_shm_ring_doorbells_out:%lld\r\n"
+        "ssdb_shm_ring_doorbells_in:%lld\r\n"
+        "ssdb_shm_ring_full:%lld\r\n"
+        "ssdb_shm_ring_fallbacks:%lld\r\n",
+        sr.rings,
+        sr.bytes_out,
+        sr.bytes_in,
+        sr.doorbells_out,
+        sr.doorbells_in,
+        sr.full,
+        sr.fallbacks);
+}
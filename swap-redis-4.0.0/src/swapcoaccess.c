@@ -0,0 +1,187 @@
+/* Co-access prefetch of related cold keys.
+ *
+ * Keys are often read together: a client reading user:123 reads
+ * user:123:cart and user:123:prefs right after. When one of them is loaded
+ * from SSDB, the others are likely to be wanted soon, and can be loaded with
+ * the same write to SSDB instead of being read from SSDB one by one first.
+ *
+ * Every client remembers the last cold key it accessed. A cold key accessed
+ * by the same client within ssdb-coaccess-window-ms is counted as a
+ * successor of it. The successor graph has up to ssdb-coaccess-keys keys,
+ * a random one makes room for a new one, and every key keeps its most
+ * frequent successors like the Misra-Gries summary: a new successor finding
+ * no free slot decrements the count of the others instead, the ones reaching
+ * zero are dropped.
+ *
+ * When a key is loaded, its successors seen at least COACCESS_MIN_COUNT
+ * times are loaded with it, see prologOfLoadingFromSSDB(). They go through
+ * the checks of a regular load: there must be room in memory, the load
+ * admission must let them in, and the extra LFU steps asked by their size
+ * class or a recent eviction must be reached. Being accessed along with the
+ * loaded key stands for the first step only.
+ */
+
+#include "server.h"
+
+#define COACCESS_MIN_COUNT 2
+
+typedef struct coaccessNode {
+    sds succ[COACCESS_SUCCESSORS];
+    unsigned int count[COACCESS_SUCCESSORS];
+} coaccessNode;
+
+static void coaccessNodeDestructor(void *privdata, void *val) {
+    coaccessNode *node = val;
+    int j;
+
+    UNUSED(privdata);
+    for (j = 0; j < COACCESS_SUCCESSORS; j++) sdsfree(node->succ[j]);
+    zfree(node);
+}
+
+static dictType coaccessDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    coaccessNodeDestructor      /* val destructor */
+};
+
+static struct {
+    dict *graph;
+    long long pairs;        /* Accesses counted as a successor. */
+    long long dropped;      /* Keys removed from the graph to make room. */
+    long long prefetched;   /* Keys loaded with a related key. */
+} ca;
+
+static void coaccessAddSuccessor(coaccessNode *node, sds key) {
+    int j, slot = -1;
+
+    for (j = 0; j < COACCESS_SUCCESSORS; j++) {
+        if (node->succ[j] && !sdscmp(node->succ[j], key)) {
+            if (node->count[j] < UINT_MAX) node->count[j]++;
+            return;
+        }
+        if (!node->succ[j] && slot == -1) slot = j;
+    }
+    if (slot != -1) {
+        node->succ[slot] = sdsdup(key);
+        node->count[slot] = 1;
+        return;
+    }
+    for (j = 0; j < COACCESS_SUCCESSORS; j++) {
+        if (--node->count[j] == 0) {
+            sdsfree(node->succ[j]);
+            node->succ[j] = NULL;
+        }
+    }
+}
+
+/* Called for every access of client 'c' to the cold key 'key'. */
+void coaccessRecord(client *c, sds key) {
+    dictEntry *de;
+    mstime_t now;
+
+    if (!server.ssdb_coaccess_keys) return;
+
+    now = mstime();
+    if (c->coaccess_key && now - c->coaccess_time <= server.ssdb_coaccess_window_ms
+        && sdscmp(c->coaccess_key, key))
+    {
+        if (!ca.graph) ca.graph = dictCreate(&coaccessDictType, NULL);
+        de = dictFind(ca.graph, c->coaccess_key);
+        if (!de) {
+            while (dictSize(ca.graph) >= (unsigned long)server.ssdb_coaccess_keys) {
+                dictDelete(ca.graph, dictGetKey(dictGetRandomKey(ca.graph)));
+                ca.dropped++;
+            }
+            de = dictAddRaw(ca.graph, sdsdup(c->coaccess_key), NULL);
+            dictSetVal(ca.graph, de, zcalloc(sizeof(coaccessNode)));
+        }
+        coaccessAddSuccessor(dictGetVal(de), key);
+        ca.pairs++;
+    }
+
+    c->coaccess_key = c->coaccess_key ? sdscpy(c->coaccess_key, key) : sdsdup(key);
+    c->coaccess_time = now;
+}
+
+/* Store in 'related' the cold keys to load along with 'key', most frequent
+ * first, up to COACCESS_SUCCESSORS and within the limit of concurrent loads.
+ * Only the keys in no intermediate state and passing the checks of a load
+ * are returned, the caller owns the objects. Return their number. */
+int coaccessRelatedKeys(sds key, robj **related) {
+    coaccessNode *node;
+    dictEntry *de;
+    int order[COACCESS_SUCCESSORS];
+    int j, k, n = 0, found = 0;
+    long limit;
+
+    if (!ca.graph || !(de = dictFind(ca.graph, key))) return 0;
+    if (!isMemoryEnoughToLoad()) return 0;
+    node = dictGetVal(de);
+
+    /* Successors by count, most frequent first. */
+    for (j = 0; j < COACCESS_SUCCESSORS; j++) {
+        if (!node->succ[j] || node->count[j] < COACCESS_MIN_COUNT) continue;
+        for (k = found; k > 0 && node->count[order[k-1]] < node->count[j]; k--)
+            order[k] = order[k-1];
+        order[k] = j;
+        found++;
+    }
+
+    /* The loads in flight or about to start, plus the one of 'key' itself. */
+    limit = swapLoadingLimit() - (long)dictSize(EVICTED_DATA_DB->loading_hot_keys)
+            - (long)dictSize(server.hot_keys) - 1;
+    for (j = 0; j < found && n < limit; j++) {
+        sds succ = node->succ[order[j]];
+        unsigned long threshold;
+        dictEntry *cde;
+        robj *o;
+
+        if (!(cde = dictFind(EVICTED_DATA_DB->dict, succ)) || swapKeyState(succ)) continue;
+        threshold = coldKeyLoadThreshold(succ);
+        if (threshold > LFU_INIT_VAL &&
+            (sdsgetlfu(dictGetKey(cde)) & 255) <= threshold)
+            continue;
+        if (!loadAdmissionAllows(succ)) continue;
+        o = createStringObject(succ, sdslen(succ));
+        if (expireIfNeeded(EVICTED_DATA_DB, o)) {
+            decrRefCount(o);
+            continue;
+        }
+        related[n++] = o;
+    }
+    return n;
+}
+
+void coaccessPrefetched(int numkeys) {
+    ca.prefetched += numkeys;
+}
+
+/* Apply a new ssdb-coaccess-keys, the graph is released when disabled. */
+void coaccessResize(void) {
+    if (!ca.graph) return;
+    if (!server.ssdb_coaccess_keys) {
+        dictRelease(ca.graph);
+        ca.graph = NULL;
+        return;
+    }
+    while (dictSize(ca.graph) > (unsigned long)server.ssdb_coaccess_keys) {
+        dictDelete(ca.graph, dictGetKey(dictGetRandomKey(ca.graph)));
+        ca.dropped++;
+    }
+}
+
+sds genCoaccessInfoString(sds info) {
+    return sdscatprintf(info,
+        "swap_coaccess_keys:%lu\r\n"
+        "swap_coaccess_pairs:%lld\r\n"
+        "swap_coaccess_dropped:%lld\r\n"
+        "swap_coaccess_prefetched:%lld\r\n",
+        ca.graph ? dictSize(ca.graph) : 0,
+        ca.pairs,
+        ca.dropped,
+        ca.prefetched);
+}
@@ -0,0 +1,264 @@
+/* Latency of the stages of the swap pipeline.
+ *
+ * A command on a cold key goes through several stages, each of them may be
+ * the bottleneck: the client blocked while its request is in SSDB, the relay
+ * of the reply, the wait for a key being loaded or transferred, or for the
+ * read of another client, the transfers and loads themselves, and the
+ * eviction cycles stealing time from the event loop.
+ *
+ * The duration of every stage is counted in a histogram with a bucket per
+ * power of two microseconds, so the percentiles are approximated by the
+ * upper bound of their bucket. The histograms are shown by INFO swap and
+ * SWAP LATENCY, along with the clients blocked and the keys queued in every
+ * stage.
+ */
+
+#include "server.h"
+
+/* Bucket 0 is for 0us, bucket j for [2^(j-1), 2^j) us, the last one for
+ * everything above. */
+#define SWAP_LATENCY_BUCKETS 36
+/* Loads in flight with their start time, indexed by transfer id. */
+#define SWAP_LATENCY_LOADS 1024
+
+typedef struct swapLatencyStage {
+    const char *name;
+    long long calls;
+    long long sum;
+    long long max;
+    long long buckets[SWAP_LATENCY_BUCKETS];
+    unsigned long blocked;      /* Clients blocked in this stage now. */
+} swapLatencyStage;
+
+static struct {
+    swapLatencyStage stages[SWAP_LATENCY_STAGES];
+    struct {
+        unsigned long long id;
+        long long start;
+    } loads[SWAP_LATENCY_LOADS];
+} sw = {
+    .stages = {
+        { .name = "visiting" },
+        { .name = "ssdb-reply" },
+        { .name = "blocked-loading" },
+        { .name = "read-flight" },
+        { .name = "blocked-other" },
+        { .name = "transfer" },
+        { .name = "load" },
+        { .name = "evict-cycle" }
+    }
+};
+
+static int swapLatencyBucket(long long us) {
+    int j = 0;
+
+    while (us > 0 && j < SWAP_LATENCY_BUCKETS-1) {
+        us >>= 1;
+        j++;
+    }
+    return j;
+}
+
+void swapLatencyRecord(int stage, long long us) {
+    swapLatencyStage *s = sw.stages+stage;
+
+    if (us < 0) us = 0;
+    s->calls++;
+    s->sum += us;
+    if (us > s->max) s->max = us;
+    s->buckets[swapLatencyBucket(us)]++;
+}
+
+/* Upper bound of the bucket holding the 'perc' percentile, at most the
+ * max. */
+static long long swapLatencyPercentile(swapLatencyStage *s, double perc) {
+    long long seen = 0, rank = (long long)(s->calls*perc/100);
+    int j;
+
+    if (!s->calls) return 0;
+    if (rank >= s->calls) rank = s->calls-1;
+    for (j = 0; j < SWAP_LATENCY_BUCKETS; j++) {
+        seen += s->buckets[j];
+        if (seen > rank) break;
+    }
+    if (j == 0) return 0;
+    if (j == SWAP_LATENCY_BUCKETS-1 || (1LL<<j)-1 > s->max) return s->max;
+    return (1LL<<j)-1;
+}
+
+/* Stage in which a client blocked with 'btype' waits, -1 if it's not part
+ * of the swap pipeline. */
+static int swapLatencyBlockedStage(int btype) {
+    switch (btype) {
+    case BLOCKED_NONE:
+    case BLOCKED_LIST:
+    case BLOCKED_WAIT:
+    case BLOCKED_MODULE:
+        return -1;
+    case BLOCKED_VISITING_SSDB:
+        return SWAP_LATENCY_VISITING;
+    case BLOCKED_SSDB_LOADING_OR_TRANSFER:
+        return SWAP_LATENCY_BLOCKED_LOADING;
+    case BLOCKED_SSDB_READ_FLIGHT:
+        return SWAP_LATENCY_READ_FLIGHT;
+    default:
+        return SWAP_LATENCY_BLOCKED_OTHER;
+    }
+}
+
+/* Called by blockClient() once c->btype is set. */
+void swapLatencyBlocked(client *c) {
+    int stage = swapLatencyBlockedStage(c->btype);
+
+    if (stage < 0) return;
+    c->swap_blocked_since = ustime();
+    sw.stages[stage].blocked++;
+}
+
+/* Called by unblockClient() before c->btype is reset. */
+void swapLatencyUnblocked(client *c) {
+    int stage = swapLatencyBlockedStage(c->btype);
+
+    if (stage < 0 || !c->swap_blocked_since) return;
+    swapLatencyRecord(stage, ustime()-c->swap_blocked_since);
+    c->swap_blocked_since = 0;
+    sw.stages[stage].blocked--;
+}
+
+/* The load with transfer 'id' was sent to SSDB. */
+void swapLatencyLoadStarted(unsigned long long id) {
+    sw.loads[id % SWAP_LATENCY_LOADS].id = id;
+    sw.loads[id % SWAP_LATENCY_LOADS].start = ustime();
+}
+
+/* The load with transfer 'id' is done. Loads overwritten by a later one
+ * are not counted. */
+void swapLatencyLoadDone(unsigned long long id) {
+    int j = id % SWAP_LATENCY_LOADS;
+
+    if (sw.loads[j].id != id || !sw.loads[j].start) return;
+    swapLatencyRecord(SWAP_LATENCY_LOAD, ustime()-sw.loads[j].start);
+    sw.loads[j].start = 0;
+}
+
+/* Reset the histograms, but not the gauges. Return the stages which had
+ * samples. */
+static int swapLatencyReset(void) {
+    int j, resets = 0;
+
+    for (j = 0; j < SWAP_LATENCY_STAGES; j++) {
+        swapLatencyStage *s = sw.stages+j;
+
+        if (s->calls) resets++;
+        s->calls = s->sum = s->max = 0;
+        memset(s->buckets, 0, sizeof(s->buckets));
+    }
+    return resets;
+}
+
+static int swapLatencyStageByName(char *name) {
+    int j;
+
+    for (j = 0; j < SWAP_LATENCY_STAGES; j++)
+        if (!strcasecmp(sw.stages[j].name, name)) return j;
+    return -1;
+}
+
+/* SWAP LATENCY
+ * SWAP LATENCY HISTOGRAM <stage>
+ * SWAP LATENCY RESET
+ * SWAP TIERS [count], see swaptier.c */
+void swapCommand(client *c) {
+    int j;
+
+    if (!server.swap_mode) {
+        addReplyErrorFormat(c,"Command only supported in swap-mode '%s'",
+                            (char *)c->argv[0]->ptr);
+        return;
+    }
+
+    if (!strcasecmp(c->argv[1]->ptr,"tiers")) {
+        swapTiersCommand(c);
+        return;
+    }
+    if (strcasecmp(c->argv[1]->ptr,"latency")) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+
+    if (c->argc == 2) {
+        addReplyMultiBulkLen(c,SWAP_LATENCY_STAGES);
+        for (j = 0; j < SWAP_LATENCY_STAGES; j++) {
+            swapLatencyStage *s = sw.stages+j;
+
+            addReplyMultiBulkLen(c,7);
+            addReplyBulkCString(c,s->name);
+            addReplyLongLong(c,s->calls);
+            addReplyLongLong(c,s->calls ? s->sum/s->calls : 0);
+            addReplyLongLong(c,swapLatencyPercentile(s,50));
+            addReplyLongLong(c,swapLatencyPercentile(s,99));
+            addReplyLongLong(c,s->max);
+            addReplyLongLong(c,s->blocked);
+        }
+    } else if (!strcasecmp(c->argv[2]->ptr,"histogram") && c->argc == 4) {
+        void *replylen;
+        int stage = swapLatencyStageByName(c->argv[3]->ptr), buckets = 0;
+
+        if (stage < 0) {
+            addReplyErrorFormat(c,"Unknown swap stage '%s'",
+                                (char *)c->argv[3]->ptr);
+            return;
+        }
+        /* Pairs of the upper bound in microseconds and the count. */
+        replylen = addDeferredMultiBulkLength(c);
+        for (j = 0; j < SWAP_LATENCY_BUCKETS; j++) {
+            swapLatencyStage *s = sw.stages+stage;
+
+            if (!s->buckets[j]) continue;
+            addReplyMultiBulkLen(c,2);
+            addReplyLongLong(c,j == SWAP_LATENCY_BUCKETS-1 ? s->max :
+                             j ? (1LL<<j)-1 : 0);
+            addReplyLongLong(c,s->buckets[j]);
+            buckets++;
+        }
+        setDeferredMultiBulkLength(c,replylen,buckets);
+    } else if (!strcasecmp(c->argv[2]->ptr,"reset") && c->argc == 3) {
+        addReplyLongLong(c,swapLatencyReset());
+    } else {
+        addReply(c,shared.syntaxerr);
+    }
+}
+
+sds genSwapLatencyInfoString(sds info) {
+    int j;
+
+    for (j = 0; j < SWAP_LATENCY_STAGES; j++) {
+        swapLatencyStage *s = sw.stages+j;
+
+        info = sdscatprintf(info,
+            "swap_latency_%s:calls=%lld,avg_us=%lld,p50_us=%lld,p99_us=%lld,max_us=%lld\r\n",
+            s->name, s->calls, s->calls ? s->sum/s->calls : 0,
+            swapLatencyPercentile(s,50), swapLatencyPercentile(s,99), s->max);
+    }
+    return sdscatprintf(info,
+        "swap_blocked_visiting:%lu\r\n"
+        "swap_blocked_loading:%lu\r\n"
+        "swap_blocked_read_flight:%lu\r\n"
+        "swap_blocked_other:%lu\r\n"
+        "swap_queued_hot_keys:%lu\r\n"
+        "swap_queued_loads:%lu\r\n"
+        "swap_queued_transfers:%lu\r\n"
+        "swap_queued_ssdb_transfers:%lld\r\n"
+        "swap_queued_ssdb_replies:%lu\r\n"
+        "swap_queued_ssdb_output_bytes:%lld\r\n",
+        sw.stages[SWAP_LATENCY_VISITING].blocked,
+        sw.stages[SWAP_LATENCY_BLOCKED_LOADING].blocked,
+        sw.stages[SWAP_LATENCY_READ_FLIGHT].blocked,
+        sw.stages[SWAP_LATENCY_BLOCKED_OTHER].blocked,
+        dictSize(server.hot_keys),
+        dictSize(EVICTED_DATA_DB->loading_hot_keys),
+        dictSize(EVICTED_DATA_DB->transferring_keys),
+        swapLimitSSDBqueued(),
+        server.ssdb_connection_pool_size ? ssdbPoolWaitingReplies() : 0,
+        server.ssdb_output_pending_bytes);
+}
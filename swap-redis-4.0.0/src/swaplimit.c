@@ -0,0 +1,180 @@
+/* Adaptive limits of the transfers and loads in flight.
+ *
+ * master-max-concurrent-transferring-keys and master-max-concurrent-loading-keys
+ * are static: too low and eviction can't keep up with write bursts, too high
+ * and the transfer workers and the RocksDB write path of SSDB saturate,
+ * slowing down the reads of cold keys. With ssdb-transfer-target-latency-us
+ * set, the limits actually enforced move below these bounds like the
+ * congestion window of TCP, every SWAP_LIMIT_PERIOD_MS:
+ *
+ * - SSDB is congested when the transfers it confirmed during the period took
+ *   more than ssdb-transfer-target-latency-us on average, from the restore to
+ *   its "ssdb-resp-del", or when it reported more than half of the keys in
+ *   flight waiting in its transfer queue. Both limits are halved, and the
+ *   transfers started before are not taken into account anymore.
+ * - Otherwise, a limit that was reached during the period grows by a step:
+ *   the transfer limit if used memory is above ssdb-transfer-lower-limit, by
+ *   up to SWAP_LIMIT_MAX_BOOST steps as it gets closer to maxmemory, the
+ *   loading limit if used memory is below ssdb-load-upper-limit.
+ */
+
+#include "server.h"
+
+/* A step is this fraction of the bound. */
+#define SWAP_LIMIT_STEPS 32
+#define SWAP_LIMIT_MAX_BOOST 4
+/* Queue depths SSDB can have without being congested. */
+#define SWAP_LIMIT_MIN_QUEUE 8
+
+static struct {
+    int transfer_limit;         /* 0 until the controller runs. */
+    int loading_limit;
+    int transfer_limited;       /* The limit was reached during the period. */
+    int loading_limited;
+    long long last_decrease;    /* ustime() of the last decrease. */
+    long long latency_sum;      /* Of the transfers confirmed in the period. */
+    long long samples;
+    long long ssdb_queued;      /* Deepest queue reported in the period, or -1. */
+    long long avg_latency;      /* Of the last period with samples. */
+    long long last_queued;      /* Last queue depth reported by SSDB. */
+    long long stat_increases;
+    long long stat_decreases;
+} sl = { .ssdb_queued = -1, .last_queued = -1 };
+
+static int clampSwapLimit(int limit, int bound) {
+    if (limit < 1) limit = 1;
+    return limit > bound ? bound : limit;
+}
+
+/* Transfers that can be in flight. */
+int swapTransferLimit(void) {
+    int bound = server.master_max_concurrent_transferring_keys;
+
+    if (!server.ssdb_transfer_target_latency_us || !sl.transfer_limit)
+        return bound;
+    return clampSwapLimit(sl.transfer_limit, bound);
+}
+
+/* Loads that can be in flight, hot keys waiting to be loaded included. */
+int swapLoadingLimit(void) {
+    int bound = server.master_max_concurrent_loading_keys;
+
+    if (!server.ssdb_transfer_target_latency_us || !sl.loading_limit)
+        return bound;
+    return clampSwapLimit(sl.loading_limit, bound);
+}
+
+/* A transfer ('loading' is 0) or a load can't be started because of the
+ * limit. */
+void swapLimitReached(int loading) {
+    if (loading)
+        sl.loading_limited = 1;
+    else
+        sl.transfer_limited = 1;
+}
+
+/* SSDB confirmed a transfer sent at 'start', with 'queued' jobs in its
+ * transfer queue, -1 if it didn't tell. */
+void swapLimitTransferConfirmed(long long start, long long queued) {
+    if (queued >= 0) sl.last_queued = queued;
+    if (!server.ssdb_transfer_target_latency_us) return;
+
+    /* Sent with the limits before the last decrease. */
+    if (start < sl.last_decrease) return;
+
+    sl.latency_sum += ustime()-start;
+    sl.samples++;
+    if (queued > sl.ssdb_queued) sl.ssdb_queued = queued;
+}
+
+static int swapLimitStep(int bound) {
+    int step = bound/SWAP_LIMIT_STEPS;
+
+    return step ? step : 1;
+}
+
+/* Steps the transfer limit grows by, more as used memory gets closer to
+ * maxmemory. */
+static int swapLimitTransferBoost(void) {
+    size_t used = zmalloc_used_memory();
+    size_t lower = server.maxmemory/100*server.ssdb_transfer_lower_limit;
+    double pressure;
+
+    if (used >= server.maxmemory || server.maxmemory <= lower) return SWAP_LIMIT_MAX_BOOST;
+    if (used <= lower) return 1;
+    pressure = (double)(used-lower)/(server.maxmemory-lower);
+    return 1+(int)(pressure*(SWAP_LIMIT_MAX_BOOST-1));
+}
+
+/* Called by serverCron() every SWAP_LIMIT_PERIOD_MS. */
+void swapLimitCron(void) {
+    int tbound = server.master_max_concurrent_transferring_keys;
+    int lbound = server.master_max_concurrent_loading_keys;
+    unsigned long inflight;
+    int congested = 0;
+
+    if (!server.ssdb_transfer_target_latency_us) {
+        sl.transfer_limit = sl.loading_limit = 0;
+        goto reset;
+    }
+
+    /* Start from the bounds, they may also have been changed. */
+    sl.transfer_limit = sl.transfer_limit ? clampSwapLimit(sl.transfer_limit, tbound) : tbound;
+    sl.loading_limit = sl.loading_limit ? clampSwapLimit(sl.loading_limit, lbound) : lbound;
+
+    if (sl.samples) {
+        sl.avg_latency = sl.latency_sum/sl.samples;
+        if (sl.avg_latency > server.ssdb_transfer_target_latency_us) congested = 1;
+    }
+    inflight = dictSize(EVICTED_DATA_DB->transferring_keys)+
+        dictSize(EVICTED_DATA_DB->loading_hot_keys);
+    if (sl.ssdb_queued > SWAP_LIMIT_MIN_QUEUE && (unsigned long)sl.ssdb_queued*2 > inflight)
+        congested = 1;
+
+    if (congested) {
+        sl.transfer_limit = clampSwapLimit(sl.transfer_limit/2, tbound);
+        sl.loading_limit = clampSwapLimit(sl.loading_limit/2, lbound);
+        sl.last_decrease = ustime();
+        sl.stat_decreases++;
+    } else {
+        if (sl.transfer_limited && sl.transfer_limit < tbound &&
+            !memoryReachTransferLowerLimit())
+        {
+            sl.transfer_limit = clampSwapLimit(sl.transfer_limit+
+                swapLimitStep(tbound)*swapLimitTransferBoost(), tbound);
+            sl.stat_increases++;
+        }
+        if (sl.loading_limited && sl.loading_limit < lbound &&
+            !memoryReachLoadUpperLimit())
+        {
+            sl.loading_limit = clampSwapLimit(sl.loading_limit+swapLimitStep(lbound), lbound);
+            sl.stat_increases++;
+        }
+    }
+
+reset:
+    sl.transfer_limited = sl.loading_limited = 0;
+    sl.latency_sum = sl.samples = 0;
+    sl.ssdb_queued = -1;
+}
+
+/* Last depth of the transfer queue reported by SSDB, -1 if unknown. */
+long long swapLimitSSDBqueued(void) {
+    return sl.last_queued;
+}
+
+sds genSwapLimitInfoString(sds info) {
+    return sdscatprintf(info,
+        "swap_transfer_limit:%d\r\n"
+        "swap_loading_limit:%d\r\n"
+        "swap_transfer_latency_us:%lld\r\n"
+        "ssdb_transfer_queued:%lld\r\n"
+        "swap_limit_increases:%lld\r\n"
+        "swap_limit_decreases:%lld\r\n",
+        swapTransferLimit(),
+        swapLoadingLimit(),
+        sl.avg_latency,
+        sl.last_queued,
+        sl.stat_increases,
+        sl.stat_decreases);
+}
@@ -0,0 +1,202 @@
+/* Accounting of the tier serving every command.
+ *
+ * What maxmemory needs to be depends on how many commands redis serves from
+ * memory, and how many go to SSDB. Every command on a key is counted, by
+ * command, in the tier which served it:
+ *
+ * memory: the key is in redis.
+ * ssdb:   the command was sent to SSDB.
+ * shared: the key is in SSDB, but the command was answered by the reply
+ *         cache or by the read of another client.
+ * miss:   the key is nowhere, only known for the reads.
+ *
+ * A command that waited for its key to be loaded or transferred is also
+ * counted as blocked, before being counted again in the tier serving it once
+ * unblocked. The bytes exchanged with SSDB are counted as well, the rates
+ * of all of them are tracked by serverCron() like the other instantaneous
+ * metrics.
+ *
+ * SWAP TIERS samples keys from both tiers with their LFU counter, to check
+ * how much hotter the keys in memory are than the ones in SSDB.
+ */
+
+#include "server.h"
+
+#define SWAP_TIER_SAMPLES 16
+#define SWAP_TIER_MAX_SAMPLES 1000
+
+static const char *swapTierNames[SWAP_TIERS] = {
+    "memory", "ssdb", "shared", "miss", "blocked"
+};
+
+static struct {
+    long long commands[SWAP_TIERS];
+    long long ssdb_output_bytes;    /* Commands sent to SSDB, transfers included. */
+    long long ssdb_input_bytes;     /* Replies read from SSDB. */
+    long long transferred_bytes;    /* Dumps of the keys transferred to SSDB. */
+    long long loaded_bytes;         /* Dumps of the keys loaded from SSDB. */
+} st;
+
+void swapTierRecord(struct redisCommand *cmd, int tier) {
+    cmd->swap_tiers[tier]++;
+    st.commands[tier]++;
+}
+
+void swapTierOutput(size_t bytes) {
+    st.ssdb_output_bytes += bytes;
+}
+
+void swapTierInput(size_t bytes) {
+    st.ssdb_input_bytes += bytes;
+}
+
+void swapTierTransferred(size_t bytes) {
+    st.transferred_bytes += bytes;
+}
+
+void swapTierLoaded(size_t bytes) {
+    st.loaded_bytes += bytes;
+}
+
+/* Called by serverCron() with the other instantaneous metrics. */
+void swapTierTrackMetrics(void) {
+    int j;
+
+    for (j = 0; j < SWAP_TIERS; j++)
+        trackInstantaneousMetric(STATS_METRIC_SWAP_TIER+j, st.commands[j]);
+    trackInstantaneousMetric(STATS_METRIC_SSDB_OUTPUT, st.ssdb_output_bytes);
+    trackInstantaneousMetric(STATS_METRIC_SSDB_INPUT, st.ssdb_input_bytes);
+}
+
+void swapTierResetStats(void) {
+    memset(&st, 0, sizeof(st));
+}
+
+/* Add up to 'count' random keys of 'd' to the reply, if 'c' is not NULL,
+ * and return the sum of their LFU counters. */
+static unsigned long long swapTierSample(client *c, dict *d, const char *tier,
+                                         int count, int *sampled)
+{
+    dictEntry **samples = zmalloc(sizeof(dictEntry*)*count);
+    unsigned long long sum = 0;
+    int j;
+
+    *sampled = dictGetSomeKeys(d,samples,count);
+    for (j = 0; j < *sampled; j++) {
+        sds key = dictGetKey(samples[j]);
+        unsigned int counter = sdsgetlfu(key) & 255;
+
+        if (c) {
+            addReplyMultiBulkLen(c,3);
+            addReplyBulkCBuffer(c,key,sdslen(key));
+            addReplyBulkCString(c,tier);
+            addReplyLongLong(c,counter);
+        }
+        sum += counter;
+    }
+    zfree(samples);
+    return sum;
+}
+
+/* SWAP TIERS [count] */
+void swapTiersCommand(client *c) {
+    long long count = SWAP_TIER_SAMPLES;
+    void *replylen;
+    int memory, ssdb;
+
+    if (c->argc > 3) {
+        addReply(c,shared.syntaxerr);
+        return;
+    }
+    if (c->argc == 3) {
+        if (getLongLongFromObjectOrReply(c,c->argv[2],&count,NULL) != C_OK)
+            return;
+        if (count <= 0 || count > SWAP_TIER_MAX_SAMPLES) {
+            addReplyErrorFormat(c,"count must be between 1 and %d",
+                                SWAP_TIER_MAX_SAMPLES);
+            return;
+        }
+    }
+    if (!(server.maxmemory_policy & MAXMEMORY_FLAG_LFU)) {
+        addReplyError(c,"An LFU maxmemory policy is required to compare the tiers");
+        return;
+    }
+
+    /* Arrays of the key, its tier and its LFU counter. */
+    replylen = addDeferredMultiBulkLength(c);
+    swapTierSample(c,server.db[0].dict,"memory",count,&memory);
+    swapTierSample(c,EVICTED_DATA_DB->dict,"ssdb",count,&ssdb);
+    setDeferredMultiBulkLength(c,replylen,memory+ssdb);
+}
+
+static double swapTierRatio(long long part, long long total) {
+    return total ? (double)part/total : 0;
+}
+
+sds genSwapTierInfoString(sds info) {
+    long long served = st.commands[SWAP_TIER_MEMORY]+st.commands[SWAP_TIER_SSDB]+
+        st.commands[SWAP_TIER_SHARED]+st.commands[SWAP_TIER_MISS];
+    int j;
+
+    for (j = 0; j < SWAP_TIERS; j++) {
+        info = sdscatprintf(info,
+            "swap_tier_%s:%lld\r\n"
+            "instantaneous_swap_tier_%s_per_sec:%lld\r\n",
+            swapTierNames[j], st.commands[j],
+            swapTierNames[j], getInstantaneousMetric(STATS_METRIC_SWAP_TIER+j));
+    }
+    info = sdscatprintf(info,
+        "swap_tier_memory_ratio:%.4f\r\n"
+        "swap_tier_ssdb_ratio:%.4f\r\n"
+        "swap_ssdb_output_bytes:%lld\r\n"
+        "swap_ssdb_input_bytes:%lld\r\n"
+        "instantaneous_swap_ssdb_output_kbps:%.2f\r\n"
+        "instantaneous_swap_ssdb_input_kbps:%.2f\r\n"
+        "swap_transferred_bytes:%lld\r\n"
+        "swap_loaded_bytes:%lld\r\n",
+        swapTierRatio(st.commands[SWAP_TIER_MEMORY], served),
+        swapTierRatio(st.commands[SWAP_TIER_SSDB]+st.commands[SWAP_TIER_SHARED], served),
+        st.ssdb_output_bytes,
+        st.ssdb_input_bytes,
+        (float)getInstantaneousMetric(STATS_METRIC_SSDB_OUTPUT)/1024,
+        (float)getInstantaneousMetric(STATS_METRIC_SSDB_INPUT)/1024,
+        st.transferred_bytes,
+        st.loaded_bytes);
+
+    if (server.maxmemory_policy & MAXMEMORY_FLAG_LFU) {
+        unsigned long long memory_sum, ssdb_sum;
+        int memory, ssdb;
+
+        memory_sum = swapTierSample(NULL,server.db[0].dict,"memory",SWAP_TIER_SAMPLES,&memory);
+        ssdb_sum = swapTierSample(NULL,EVICTED_DATA_DB->dict,"ssdb",SWAP_TIER_SAMPLES,&ssdb);
+        info = sdscatprintf(info,
+            "swap_tier_sampled_freq:memory=%.2f,ssdb=%.2f\r\n",
+            memory ? (double)memory_sum/memory : 0,
+            ssdb ? (double)ssdb_sum/ssdb : 0);
+    }
+    return info;
+}
+
+/* Commands on keys by tier, like INFO commandstats. */
+sds genSwapTierCommandsInfoString(sds info) {
+    struct redisCommand *c;
+    dictEntry *de;
+    dictIterator *di;
+    int j;
+
+    di = dictGetSafeIterator(server.commands);
+    while((de = dictNext(di)) != NULL) {
+        long long total = 0;
+
+        c = (struct redisCommand *) dictGetVal(de);
+        for (j = 0; j < SWAP_TIERS; j++) total += c->swap_tiers[j];
+        if (!total) continue;
+        info = sdscatprintf(info,
+            "tierstat_%s:memory=%lld,ssdb=%lld,shared=%lld,miss=%lld,blocked=%lld\r\n",
+            c->name, c->swap_tiers[SWAP_TIER_MEMORY], c->swap_tiers[SWAP_TIER_SSDB],
+            c->swap_tiers[SWAP_TIER_SHARED], c->swap_tiers[SWAP_TIER_MISS],
+            c->swap_tiers[SWAP_TIER_BLOCKED]);
+    }
+    dictReleaseIterator(di);
+    return info;
+}
@@ -0,0 +1,111 @@
+/* Swap thrash detection.
+ *
+ * When the working set is just above maxmemory, the same keys keep being
+ * evicted to SSDB and loaded back, every round costing a dump, a transfer
+ * and two RocksDB writes. A ghost table remembers when keys were last
+ * evicted and loaded, it's direct mapped and indexed by the hash of the key,
+ * so older entries are simply overwritten. It has ssdb-thrash-ghost-entries
+ * entries, rounded up to a power of two, which should be about the number of
+ * keys evicted within the thrash window.
+ *
+ * A load of a key evicted less than ssdb-thrash-window seconds ago is a
+ * thrash, counted in INFO. Two knobs damp it:
+ *
+ * ssdb-min-residency: keys loaded less than this many seconds ago are not
+ *                     picked for eviction.
+ * ssdb-thrash-load-penalty: keys evicted within the window need this many
+ *                     more LFU steps to be loaded again.
+ */
+
+#include "server.h"
+
+typedef struct swapGhost {
+    uint32_t fp;                /* Upper bits of the hash of the key. */
+    uint32_t evicted;           /* Unix time of the last eviction, 0 if none. */
+    uint32_t loaded;            /* Unix time of the last load, 0 if none. */
+} swapGhost;
+
+static struct {
+    swapGhost *table;
+    unsigned long size;         /* Power of two, 0 if not allocated. */
+    long long stat_deferred;    /* Eviction candidates skipped for residency. */
+} sg;
+
+static swapGhost *swapGhostLookup(sds key, int create) {
+    uint64_t h = dictGenHashFunction(key, sdslen(key));
+    uint32_t fp = (uint32_t)(h >> 32);
+    swapGhost *g;
+
+    if (!sg.table) {
+        if (!create) return NULL;
+        sg.size = 1;
+        while (sg.size < (unsigned long)server.ssdb_thrash_ghost_entries)
+            sg.size <<= 1;
+        sg.table = zcalloc(sizeof(swapGhost)*sg.size);
+    }
+
+    g = sg.table+(h & (sg.size-1));
+    if (g->fp != fp) {
+        if (!create) return NULL;
+        g->fp = fp;
+        g->evicted = g->loaded = 0;
+    }
+    return g;
+}
+
+static int swapGhostWithin(uint32_t when, long long seconds) {
+    return when && seconds && server.unixtime - (time_t)when < seconds;
+}
+
+/* Called when a key was evicted to SSDB. */
+void swapGhostEvicted(sds key) {
+    swapGhostLookup(key, 1)->evicted = (uint32_t)server.unixtime;
+}
+
+/* Called when a key was loaded from SSDB. */
+void swapGhostLoaded(sds key) {
+    swapGhost *g = swapGhostLookup(key, 1);
+
+    if (swapGhostWithin(g->evicted, server.ssdb_thrash_window))
+        server.stat_swap_thrash++;
+    g->loaded = (uint32_t)server.unixtime;
+}
+
+/* Return 1 if the key was loaded too recently to be evicted. */
+int swapGhostResident(sds key) {
+    swapGhost *g;
+
+    if (!server.ssdb_min_residency) return 0;
+    if (!(g = swapGhostLookup(key, 0))) return 0;
+    if (!swapGhostWithin(g->loaded, server.ssdb_min_residency)) return 0;
+    sg.stat_deferred++;
+    return 1;
+}
+
+/* Extra LFU steps the cold key needs to be loaded. */
+unsigned long swapGhostLoadPenalty(sds key) {
+    swapGhost *g;
+
+    if (!server.ssdb_thrash_load_penalty) return 0;
+    if (!(g = swapGhostLookup(key, 0))) return 0;
+    if (!swapGhostWithin(g->evicted, server.ssdb_thrash_window)) return 0;
+    return server.ssdb_thrash_load_penalty;
+}
+
+/* Apply a new ssdb-thrash-ghost-entries, the table is allocated again on
+ * the next eviction or load, what it remembered is lost. */
+void swapGhostResize(void) {
+    zfree(sg.table);
+    sg.table = NULL;
+    sg.size = 0;
+}
+
+sds genSwapThrashInfoString(sds info) {
+    return sdscatprintf(info,
+        "swap_thrash_loads:%lld\r\n"
+        "instantaneous_swap_thrash_per_sec:%lld\r\n"
+        "swap_resident_skips:%lld\r\n",
+        server.stat_swap_thrash,
+        getInstantaneousMetric(STATS_METRIC_SWAP_THRASH),
+        sg.stat_deferred);
+}
@@ -0,0 +1,291 @@
+/* Transfer dictionary: shared preset dictionary for the payloads exchanged
+ * with SSDB.
+ *
+ * Values evicted to SSDB are mostly small strings (JSON blobs and alike)
+ * sharing a lot of structure across keys, but almost nothing inside a
+ * single value, so plain LZF hardly shrinks them. We sample evicted string
+ * values, train a dictionary out of the substrings that occur most often
+ * and install it in SSDB with "rr_transfer_dict <version> <dict>". Once
+ * SSDB acknowledged a version, string values of restore payloads are
+ * compressed with LZF primed by that dictionary (RDB_ENC_LZF_DICT), and
+ * SSDB does the same for the payloads it sends back when loading keys.
+ *
+ * The dictionary is (re)sent on every new connection before any transfer
+ * command, so SSDB never encodes with a dictionary redis doesn't know. The
+ * previous version is kept to decode payloads encoded right before a
+ * switch. Payloads are never dict-encoded outside of SSDB transfers: RDB
+ * files, AOF and replication always use the plain encodings.
+ */
+
+#include "server.h"
+#include "lzf.h"
+#include "crc64.h"
+
+/* Sampled bytes needed before training, and per value. */
+#define TRANSFER_DICT_SAMPLES_SIZE (64*1024)
+#define TRANSFER_DICT_SAMPLE_MAX_LEN 1024
+#define TRANSFER_DICT_SAMPLE_MIN_LEN 16
+/* Min seconds between two trainings. */
+#define TRANSFER_DICT_RETRAIN_PERIOD 600
+
+/* Training: k-mers are counted in a hashed table, the dictionary is built
+ * greedily from the segments whose k-mers are the most frequent. */
+#define TRANSFER_DICT_KMER 8
+#define TRANSFER_DICT_SEGMENT 64
+#define TRANSFER_DICT_HASH_BITS 16
+
+static struct {
+    sds dict;                   /* Current dictionary, NULL if none. */
+    uint32_t version;
+    sds prev;                   /* Previous dictionary, for decoding only. */
+    uint32_t prev_version;
+    int synced;                 /* Some version was sent on this connection. */
+    uint32_t sent;              /* Last version sent to SSDB. */
+    uint32_t acked;             /* Last version SSDB confirmed. */
+    int encoding;               /* Creating a payload for SSDB. */
+    sds samples;
+    time_t last_train;
+    long long stat_trained;
+    long long stat_encoded;
+    long long stat_encoded_in;
+    long long stat_encoded_out;
+    long long stat_decoded;
+    long long stat_decode_errors;
+} td;
+
+/* -----------------------------------------------------------------------------
+ * Training
+ * -------------------------------------------------------------------------- */
+
+static inline unsigned int kmerHash(const unsigned char *p) {
+    uint64_t v;
+
+    memcpy(&v,p,sizeof(v));
+    return (unsigned int)((v * 0x9E3779B97F4A7C15ULL) >> (64-TRANSFER_DICT_HASH_BITS));
+}
+
+/* Build a dictionary of at most 'size' bytes out of 'samples'. The segments
+ * with the highest score are picked one at a time, the k-mers they cover are
+ * then discounted so that the next pick adds new content. The best segments
+ * are placed at the end of the dictionary, which is the closest to the data
+ * and the part LZF back references reach more easily. */
+static sds trainTransferDict(sds samples, size_t size) {
+    size_t len = sdslen(samples), npos, i;
+    const unsigned char *s = (const unsigned char *)samples;
+    uint32_t *freq;
+    uint16_t *hash;
+    sds dict;
+    char *buf;
+    size_t used = 0;
+
+    if (len < TRANSFER_DICT_SEGMENT*2) return NULL;
+    npos = len-TRANSFER_DICT_KMER+1;
+
+    freq = zcalloc(sizeof(uint32_t)*(1<<TRANSFER_DICT_HASH_BITS));
+    hash = zmalloc(sizeof(uint16_t)*npos);
+    for (i = 0; i < npos; i++) {
+        hash[i] = kmerHash(s+i);
+        freq[hash[i]]++;
+    }
+
+    buf = zmalloc(size);
+    while (used + TRANSFER_DICT_SEGMENT <= size) {
+        size_t nk = TRANSFER_DICT_SEGMENT-TRANSFER_DICT_KMER+1;
+        size_t best = 0, j;
+        uint64_t score = 0, best_score = 0;
+
+        /* Sliding sum of the k-mer frequencies over every segment. */
+        for (i = 0; i < npos; i++) {
+            score += freq[hash[i]];
+            if (i >= nk) score -= freq[hash[i-nk]];
+            if (i+1 >= nk && score > best_score) {
+                best_score = score;
+                best = i+1-nk;
+            }
+        }
+
+        /* Only k-mers seen more than once are worth a dictionary entry. */
+        if (best_score <= nk) break;
+
+        used += TRANSFER_DICT_SEGMENT;
+        memcpy(buf+size-used,s+best,TRANSFER_DICT_SEGMENT);
+        for (j = best; j < best+nk; j++) freq[hash[j]] = 0;
+    }
+
+    dict = used ? sdsnewlen(buf+size-used,used) : NULL;
+    zfree(buf);
+    zfree(hash);
+    zfree(freq);
+    return dict;
+}
+
+static void installTransferDict(sds dict) {
+    uint32_t version = (uint32_t)crc64(0,(unsigned char*)dict,sdslen(dict));
+
+    /* 0 means "no dictionary" on the wire. */
+    if (version == 0) version = 1;
+    if (version == td.version) {
+        sdsfree(dict);
+        return;
+    }
+
+    sdsfree(td.prev);
+    td.prev = td.dict;
+    td.prev_version = td.version;
+    td.dict = dict;
+    td.version = version;
+    td.stat_trained++;
+
+    serverLog(LL_NOTICE, "New transfer dictionary trained, version: %u, size: %lu",
+              version, (unsigned long)sdslen(dict));
+}
+
+/* Called for every value evicted to SSDB. */
+void transferDictFeed(robj *o) {
+    size_t len;
+
+    if (!server.transfer_dict_compression) return;
+    if (o->type != OBJ_STRING || !sdsEncodedObject(o)) return;
+
+    /* Don't train again before SSDB confirmed the last dictionary, or its
+     * previous version could be dropped while it's still in use. */
+    if (td.dict && td.acked != td.version) return;
+    if (td.dict && server.unixtime - td.last_train < TRANSFER_DICT_RETRAIN_PERIOD)
+        return;
+
+    len = sdslen(o->ptr);
+    if (len < TRANSFER_DICT_SAMPLE_MIN_LEN) return;
+    if (len > TRANSFER_DICT_SAMPLE_MAX_LEN) len = TRANSFER_DICT_SAMPLE_MAX_LEN;
+
+    if (!td.samples) td.samples = sdsMakeRoomFor(sdsempty(), TRANSFER_DICT_SAMPLES_SIZE);
+    td.samples = sdscatlen(td.samples, o->ptr, len);
+    if (sdslen(td.samples) < TRANSFER_DICT_SAMPLES_SIZE) return;
+
+    sds dict = trainTransferDict(td.samples, server.transfer_dict_size);
+    sdsfree(td.samples);
+    td.samples = NULL;
+    td.last_train = server.unixtime;
+    if (dict) installTransferDict(dict);
+}
+
+/* -----------------------------------------------------------------------------
+ * Negotiation with SSDB
+ * -------------------------------------------------------------------------- */
+
+/* Make sure SSDB knows our current dictionary. Called when the transfer
+ * connection is established and before sending any transfer command. */
+void transferDictSync(void) {
+    client *c = server.ssdb_client;
+    uint32_t version = server.transfer_dict_compression ? td.version : 0;
+    rio cmd;
+
+    if (!c || !(c->ssdb_conn_flags & CONN_SUCCESS)) return;
+    if (td.synced && td.sent == version) return;
+
+    rioInitWithBuffer(&cmd, sdsempty());
+    serverAssert(rioWriteBulkCount(&cmd, '*', 3));
+    serverAssert(rioWriteBulkString(&cmd, "rr_transfer_dict", strlen("rr_transfer_dict")));
+    serverAssert(rioWriteBulkLongLong(&cmd, version));
+    if (version)
+        serverAssert(rioWriteBulkString(&cmd, td.dict, sdslen(td.dict)));
+    else
+        serverAssert(rioWriteBulkString(&cmd, "", 0));
+
+    /* sendCommandToSSDB will free cmd.io.buffer.ptr. */
+    if (sendCommandToSSDB(c, cmd.io.buffer.ptr) != C_OK) return;
+
+    td.synced = 1;
+    td.sent = version;
+    serverLog(LL_DEBUG, "transfer dict version %u sent to SSDB.", version);
+}
+
+void transferDictConnectionLost(void) {
+    td.synced = 0;
+    td.sent = td.acked = 0;
+}
+
+/* Handle "rr_transfer_dict ok <version>", return C_OK if the reply is
+ * the response of rr_transfer_dict. */
+int handleResponseOfTransferDict(redisReply *reply) {
+    static const char prefix[] = "rr_transfer_dict ok ";
+    size_t plen = sizeof(prefix)-1;
+    long long version;
+
+    if (reply->len <= plen || memcmp(reply->str, prefix, plen)) return C_ERR;
+    if (string2ll(reply->str+plen, reply->len-plen, &version) == 0) return C_ERR;
+
+    td.acked = (uint32_t)version;
+    serverLog(LL_DEBUG, "transfer dict version %u acked by SSDB.", td.acked);
+    return C_OK;
+}
+
+/* -----------------------------------------------------------------------------
+ * Encoding/decoding, used by rdb.c
+ * -------------------------------------------------------------------------- */
+
+void transferDictBeginPayload(void) {
+    td.encoding = server.transfer_dict_compression && td.dict &&
+        td.acked == td.version && td.sent == td.version;
+}
+
+void transferDictEndPayload(void) {
+    td.encoding = 0;
+}
+
+/* Return the dictionary to encode strings with, or NULL if the payload
+ * being created must not use one. */
+const char *transferDictForEncoding(uint32_t *version, size_t *len) {
+    if (!td.encoding) return NULL;
+    *version = td.version;
+    *len = sdslen(td.dict);
+    return td.dict;
+}
+
+void transferDictCountEncoded(size_t in, size_t out) {
+    td.stat_encoded++;
+    td.stat_encoded_in += in;
+    td.stat_encoded_out += out;
+}
+
+/* Return the dictionary of the specified version, or NULL if it's unknown. */
+const char *transferDictLookup(uint32_t version, size_t *len) {
+    sds dict = NULL;
+
+    if (td.dict && version == td.version) dict = td.dict;
+    else if (td.prev && version == td.prev_version) dict = td.prev;
+
+    if (!dict) return NULL;
+    *len = sdslen(dict);
+    return dict;
+}
+
+void transferDictCountDecoded(int ok) {
+    if (ok) td.stat_decoded++;
+    else td.stat_decode_errors++;
+}
+
+long long transferDictDecodedCount(void) {
+    return td.stat_decoded;
+}
+
+sds genTransferDictInfoString(sds info) {
+    return sdscatprintf(info,
+        "transfer_dict_version:%u\r\n"
+        "transfer_dict_acked_version:%u\r\n"
+        "transfer_dict_size:%lu\r\n"
+        "transfer_dict_trained:%lld\r\n"
+        "transfer_dict_sampled_bytes:%lu\r\n"
+        "transfer_dict_encoded_strings:%lld\r\n"
+        "transfer_dict_encoded_ratio:%.2f\r\n"
+        "transfer_dict_decoded_strings:%lld\r\n"
+        "transfer_dict_decode_errors:%lld\r\n",
+        td.version,
+        td.acked,
+        td.dict ? (unsigned long)sdslen(td.dict) : 0,
+        td.stat_trained,
+        td.samples ? (unsigned long)sdslen(td.samples) : 0,
+        td.stat_encoded,
+        td.stat_encoded_in ? (double)td.stat_encoded_out/td.stat_encoded_in : 0,
+        td.stat_decoded,
+        td.stat_decode_errors);
+}
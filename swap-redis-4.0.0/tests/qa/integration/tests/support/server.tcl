@@ -177,6 +177,8 @@ proc start_server {options {code undefined}} {
         switch $option {
             "config" {
                 set baseconfig $value }
+            "ssdbconfig" {
+                set ssdbbaseconfig $value }
             "overrides" {
                 set overrides $value }
             "tags" {
@@ -46,9 +46,10 @@ proc warnings_from_file {filename} {
     join $result "\n"
 }
 
-# Return value for INFO property
-proc status {r property} {
-    if {[regexp "\r\n$property:(.*?)\r\n" [{*}$r info] _ value]} {
+# Return value for INFO property, of the default sections unless 'section'
+# is given
+proc status {r property {section {}}} {
+    if {[regexp "\r\n$property:(.*?)\r\n" [{*}$r info {*}$section] _ value]} {
         set _ $value
     }
 }
@@ -41,6 +41,27 @@ set ::all_tests {
     unit/limits
     unit/other
     unit/slowlog
+    unit/swap-transfer
+    unit/swap-promote
+    unit/swap-keep-loaded
+    unit/swap-pool
+    unit/swap-output-buffer
+    unit/swap-fanout
+    unit/swap-preload
+    unit/swap-scan
+    unit/swap-evict-cycle
+    unit/swap-admission
+    unit/swap-size-aware
+    unit/swap-thrash
+    unit/swap-key-states
+    unit/swap-read-flight
+    unit/swap-reply-cache
+    unit/swap-limit
+    unit/swap-latency
+    unit/swap-tiers
+    unit/swap-shm-ring
+    unit/swap-hot-keys
+    unit/swap-coaccess
 
     integration/replication-base
     integration/replication-2
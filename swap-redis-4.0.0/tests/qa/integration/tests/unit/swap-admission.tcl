@@ -0,0 +1,56 @@
+start_server {tags {"ssdb"}
+overrides {maxmemory-policy allkeys-lfu
+           ssdb-promote-with-read yes
+           ssdb-load-admission yes}} {
+    r set foo bar
+    dumpto_ssdb_and_wait r foo
+    # keep the keys read often in redis, as the next ones to evict.
+    set limit [lindex [r config get master-max-concurrent-transferring-keys] 1]
+    r config set master-max-concurrent-transferring-keys 0
+    for {set i 0} {$i < 20} {incr i} {
+        r set key:$i val:$i
+        for {set j 0} {$j < 20} {incr j} {
+            r get key:$i
+        }
+    }
+    for {set i 0} {$i < 20} {incr i} {
+        r setlfu key:$i 0
+    }
+
+    test "Cold key read once is not loaded over keys read more often" {
+        set rejected [s load_admission_rejected]
+        r setlfu foo 255
+        assert_equal {bar} [r get foo]
+        wait_keys_processed r
+        assert {[s load_admission_rejected] > $rejected}
+        r locatekey foo
+    } {ssdb}
+
+    test "Cold key read more often than the next ones to evict is loaded" {
+        set admitted [s load_admission_admitted]
+        for {set j 0} {$j < 100} {incr j} {
+            r setlfu foo 255
+            assert_equal {bar} [r get foo]
+            if {[r locatekey foo] eq {redis}} break
+        }
+        wait_keys_processed r
+        assert {[s load_admission_admitted] > $admitted}
+        r locatekey foo
+    } {redis}
+
+    test "Cold keys are loaded by their LFU counter only when disabled" {
+        r config set ssdb-load-admission no
+        set rejected [s load_admission_rejected]
+        r config set master-max-concurrent-transferring-keys $limit
+        r set foo2 bar
+        dumpto_ssdb_and_wait r foo2
+        r setlfu foo2 255
+        assert_equal {bar} [r get foo2]
+        wait_for_condition 100 10 {
+            [r locatekey foo2] eq {redis}
+        } else {
+            fail "key foo2 not promoted with the read"
+        }
+        list [s load_admission_width] [expr {[s load_admission_rejected] - $rejected}]
+    } {0 0}
+}
@@ -0,0 +1,61 @@
+start_server {tags {"ssdb"}
+overrides {maxmemory-policy allkeys-lfu
+           ssdb-coaccess-keys 100
+           ssdb-coaccess-window-ms 10000}} {
+    foreach key {a b c d} {
+        r set $key v$key
+        dumpto_ssdb_and_wait r $key
+    }
+
+    test "Keys in SSDB read together by a client are counted as pairs" {
+        set pairs [status r swap_coaccess_pairs swap]
+        assert_equal {va vb va vb} [list [r get a] [r get b] [r get a] [r get b]]
+        wait_keys_processed r
+        list [expr {[status r swap_coaccess_pairs swap] - $pairs}] \
+             [status r swap_coaccess_keys swap]
+    } {3 2}
+
+    test "Keys read by different clients are not counted as pairs" {
+        set client [redis [srv host] [srv port]]
+        r get c
+        set pairs [status r swap_coaccess_pairs swap]
+        $client get d
+        wait_keys_processed r
+        $client close
+        expr {[status r swap_coaccess_pairs swap] - $pairs}
+    } {0}
+
+    test "Keys read out of the window are not counted as pairs" {
+        r config set ssdb-coaccess-window-ms 1
+        r get c
+        set pairs [status r swap_coaccess_pairs swap]
+        after 10
+        r get d
+        wait_keys_processed r
+        r config set ssdb-coaccess-window-ms 10000
+        expr {[status r swap_coaccess_pairs swap] - $pairs}
+    } {0}
+
+    test "Related key is loaded with a promoted key" {
+        r config set ssdb-promote-with-read yes
+        set prefetched [status r swap_coaccess_prefetched swap]
+        r setlfu a 255
+        r setlfu b 255
+        assert_equal {va} [r get a]
+        wait_for_condition 100 10 {
+            [r locatekey a] eq {redis} && [r locatekey b] eq {redis}
+        } else {
+            fail "keys a and b not loaded"
+        }
+        wait_keys_processed r
+        r config set ssdb-promote-with-read no
+        assert {[status r swap_coaccess_prefetched swap] > $prefetched}
+        list [r get a] [r get b] [sr get b]
+    } {va vb {}}
+
+    test "Disabling ssdb-coaccess-keys releases the graph" {
+        assert {[status r swap_coaccess_keys swap] > 0}
+        r config set ssdb-coaccess-keys 0
+        status r swap_coaccess_keys swap
+    } {0}
+}
@@ -0,0 +1,49 @@
+start_server {tags {"ssdb"}
+overrides {maxmemory-policy allkeys-lfu}} {
+    test "Default of master-max-concurrent-transferring-keys" {
+        lindex [r config get master-max-concurrent-transferring-keys] 1
+    } {5}
+
+    test "Eviction cycles transfer the cold keys in batches" {
+        r config set maxmemory 0
+        for {set j 0} {$j < 100} {incr j} {
+            r set key:$j [string repeat x 1000]
+        }
+        set cycles [s evict_cycles]
+        set cyclekeys [s evict_cycle_keys]
+        r config set lowest-idle-val-of-cold-key 0
+        r config set maxmemory 500M
+        wait_for_condition 100 100 {
+            [s keys_in_redis_count] == 0
+        } else {
+            fail "keys not transferred to SSDB"
+        }
+        wait_keys_processed r
+        assert {[s evict_cycles] > $cycles}
+        assert {[s evict_cycle_keys] - $cyclekeys >= 100}
+        list [s keys_in_ssdb_count] [s transferring_bytes] [r get key:99]
+    } [list 100 0 [string repeat x 1000]]
+
+    test "CONFIG SET ssdb-transfer-max-inflight-bytes" {
+        r config set ssdb-transfer-max-inflight-bytes 1024
+        lindex [r config get ssdb-transfer-max-inflight-bytes] 1
+    } {1024}
+
+    test "CONFIG RESETSTAT keeps the transferring bytes" {
+        r config set maxmemory 0
+        r config set ssdb-transfer-max-inflight-bytes 0
+        for {set j 0} {$j < 100} {incr j} {
+            r set other:$j [string repeat x 1000]
+        }
+        r config set maxmemory 500M
+        r config resetstat
+        wait_for_condition 100 100 {
+            [s keys_in_redis_count] == 0
+        } else {
+            fail "keys not transferred to SSDB"
+        }
+        wait_keys_processed r
+        r config set maxmemory 0
+        s transferring_bytes
+    } {0}
+}
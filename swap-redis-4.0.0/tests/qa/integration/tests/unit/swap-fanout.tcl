@@ -0,0 +1,41 @@
+start_server {tags {"ssdb"}} {
+    test "MGET with keys in redis and in SSDB" {
+        set cross [s cross_tier_commands]
+        r set a va
+        r set b vb
+        dumpto_ssdb_and_wait r b
+        assert_equal {va vb {} va} [r mget a b c a]
+        assert {[s cross_tier_commands] > $cross}
+        list [r locatekey a] [r locatekey b]
+    } {redis ssdb}
+
+    test "MGET with keys in SSDB only" {
+        r set c vc
+        dumpto_ssdb_and_wait r c
+        r mget b c d
+    } {vb vc {}}
+
+    test "MSET with keys in redis and in SSDB" {
+        assert_equal {OK} [r mset a na b nb d nd]
+        wait_keys_processed r
+        assert_equal {na nb nd} [r mget a b d]
+        list [r locatekey a] [r locatekey b] [r locatekey d] [sr get b]
+    } {redis ssdb redis nb}
+
+    test "EXISTS with keys in redis and in SSDB" {
+        r exists a b c e a
+    } {4}
+
+    test "DEL with keys in redis and in SSDB" {
+        assert_equal 3 [r del a b e d]
+        wait_keys_processed r
+        list [r exists a b c d] [r locatekey a] [r locatekey b] [sr get b]
+    } {1 none none {}}
+
+    test "Single key DEL and EXISTS of a key in SSDB" {
+        assert_equal 1 [r exists c]
+        assert_equal 1 [r del c]
+        wait_keys_processed r
+        list [r exists c] [r locatekey c]
+    } {0 none}
+}
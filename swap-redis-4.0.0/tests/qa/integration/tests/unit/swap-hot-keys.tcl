@@ -0,0 +1,34 @@
+start_server {tags {"ssdb"}} {
+    test "Cold keys pushed by SSDB are put in the hot pool" {
+        set hot [s keys_hot_in_ssdb]
+        set pooled [s keys_hot_in_ssdb_pooled]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        assert_equal 1 [r ssdb-resp-hot foo 10 nosuchkey 5]
+        list [expr {[s keys_hot_in_ssdb] - $hot}] \
+             [expr {[s keys_hot_in_ssdb_pooled] - $pooled}]
+    } {2 1}
+
+    test "Keys pushed by SSDB must come with their weight" {
+        assert_error {*wrong number of arguments*} {r ssdb-resp-hot foo}
+        assert_error {*syntax*} {r ssdb-resp-hot foo 10 bar}
+    }
+}
+
+start_server {tags {"ssdb"} ssdbconfig ssdb_hot_keys.conf} {
+    test "SSDB pushes the keys it reads the most to redis" {
+        set hot [s keys_hot_in_ssdb]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal {bar} [r get foo]
+        }
+        wait_for_condition 50 100 {
+            [s keys_hot_in_ssdb] > $hot
+        } else {
+            fail "no hot key pushed by SSDB"
+        }
+        wait_keys_processed r
+        r get foo
+    } {bar}
+}
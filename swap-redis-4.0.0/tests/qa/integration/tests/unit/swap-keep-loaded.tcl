@@ -0,0 +1,55 @@
+start_server {tags {"ssdb"}
+overrides {ssdb-keep-loaded-keys yes}} {
+    test "Loaded key keeps its copy in SSDB" {
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        list [s keys_kept_in_ssdb] [sr get foo]
+    } {1 bar}
+
+    test "Key only read since its load is evicted without transfer" {
+        set clean [s keys_evicted_clean]
+        assert_equal {bar} [r get foo]
+        dumpto_ssdb_and_wait r foo
+        wait_keys_processed r
+        assert_equal [expr {$clean+1}] [s keys_evicted_clean]
+        list [s keys_kept_in_ssdb] [r get foo]
+    } {0 bar}
+
+    test "Key modified since its load is transferred again" {
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        set clean [s keys_evicted_clean]
+        r append foo baz
+        dumpto_ssdb_and_wait r foo
+        wait_keys_processed r
+        assert_equal $clean [s keys_evicted_clean]
+        list [r get foo] [sr get foo]
+    } {barbaz barbaz}
+
+    test "Key whose expire changed since its load is transferred again" {
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        set clean [s keys_evicted_clean]
+        r expire foo 100
+        dumpto_ssdb_and_wait r foo
+        wait_keys_processed r
+        assert_equal $clean [s keys_evicted_clean]
+        set ttl [r ttl foo]
+        assert {$ttl > 0 && $ttl <= 100}
+        r get foo
+    } {barbaz}
+
+    test "Deleted key drops its copy in SSDB" {
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        r del foo
+        wait_for_condition 100 10 {
+            [sr exists foo] == 0
+        } else {
+            fail "copy of deleted key foo still in SSDB"
+        }
+        list [s keys_kept_in_ssdb] [r exists foo]
+    } {0 0}
+}
@@ -0,0 +1,53 @@
+start_server {tags {"ssdb"}} {
+    test "Key states are cleared after transfers and loads" {
+        for {set i 0} {$i < 100} {incr i} {
+            r set foo:$i bar:$i
+            r storetossdb foo:$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            wait_for_dumpto_ssdb r foo:$i
+            r dumpfromssdb foo:$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            wait_for_condition 100 10 {
+                [r locatekey foo:$i] eq {redis}
+            } else {
+                fail "key foo:$i restore redis failed"
+            }
+        }
+        wait_keys_processed r
+        list [s keys_loading_from_ssdb] [s keys_transferring_to_ssdb] \
+            [s keys_visiting_ssdb] [s keys_delete_confirming] [s keys_hot_to_be_load]
+    } {0 0 0 0 0}
+
+    test "Key states follow a key transferred and loaded again" {
+        for {set i 0} {$i < 200} {incr i} {
+            r set foo bar:$i
+            r storetossdb foo
+            wait_for_dumpto_ssdb r foo
+            assert_equal bar:$i [r get foo]
+            wait_for_restoreto_redis r foo
+        }
+        wait_keys_processed r
+        list [r get foo] [r locatekey foo] [s keys_transferring_to_ssdb] [s keys_loading_from_ssdb]
+    } {bar:199 redis 0 0}
+
+    test "Key deleted while in transfer leaves no state" {
+        for {set i 0} {$i < 100} {incr i} {
+            r set foo:$i bar:$i
+            r storetossdb foo:$i
+            r del foo:$i
+        }
+        wait_keys_processed r
+        wait_for_condition 100 100 {
+            [s keys_delete_confirming] == 0
+        } else {
+            fail "deleted keys not confirmed by SSDB"
+        }
+        set res {}
+        for {set i 0} {$i < 100} {incr i} {
+            lappend res [r locatekey foo:$i]
+        }
+        list [lsort -unique $res] [s keys_visiting_ssdb] [s keys_transferring_to_ssdb]
+    } {none 0 0}
+}
@@ -0,0 +1,48 @@
+proc swap_latency_calls {stage} {
+    regexp {calls=([0-9]+)} [status r swap_latency_$stage swap] _ calls
+    set calls
+}
+
+start_server {tags {"ssdb"}} {
+    test "INFO swap is not part of the default INFO" {
+        list [status r swap_latency_visiting] [string is integer [swap_latency_calls visiting]]
+    } {{} 1}
+
+    test "Stages a command on a key in SSDB went through are timed" {
+        set visiting [swap_latency_calls visiting]
+        set transfer [swap_latency_calls transfer]
+        set load [swap_latency_calls load]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        assert_equal {bar} [r get foo]
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        assert {[swap_latency_calls visiting] > $visiting}
+        assert {[swap_latency_calls transfer] > $transfer}
+        assert {[swap_latency_calls load] > $load}
+        status r swap_blocked_visiting swap
+    } {0}
+
+    test "SWAP LATENCY replies with the stats of every stage" {
+        set stages {}
+        foreach stage [r swap latency] {
+            lappend stages [lindex $stage 0]
+            assert_equal 7 [llength $stage]
+        }
+        set stages
+    } {visiting ssdb-reply blocked-loading read-flight blocked-other transfer load evict-cycle}
+
+    test "SWAP LATENCY HISTOGRAM replies with the buckets of a stage" {
+        set calls 0
+        foreach bucket [r swap latency histogram visiting] {
+            incr calls [lindex $bucket 1]
+        }
+        assert_error {*Unknown swap stage*} {r swap latency histogram nosuchstage}
+        expr {$calls == [swap_latency_calls visiting]}
+    } {1}
+
+    test "SWAP LATENCY RESET clears the stats" {
+        assert {[r swap latency reset] > 0}
+        list [swap_latency_calls visiting] [r swap latency histogram visiting]
+    } {0 {}}
+}
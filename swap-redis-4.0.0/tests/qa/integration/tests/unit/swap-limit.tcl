@@ -0,0 +1,33 @@
+start_server {tags {"ssdb"}} {
+    set bound [lindex [r config get master-max-concurrent-transferring-keys] 1]
+
+    test "Transfer limits are the configured bounds when not adaptive" {
+        list [expr {[s swap_transfer_limit] == $bound}] [s swap_limit_decreases]
+    } {1 0}
+
+    test "Transfer limits are halved when SSDB is slower than the target" {
+        r config set ssdb-transfer-target-latency-us 1
+        set decreases [s swap_limit_decreases]
+        for {set i 0} {$i < 10} {incr i} {
+            r set key:$i val:$i
+            dumpto_ssdb_and_wait r key:$i
+        }
+        wait_for_condition 50 20 {
+            [s swap_limit_decreases] > $decreases
+        } else {
+            fail "transfer limits not decreased"
+        }
+        assert {[s swap_transfer_latency_us] > 1}
+        expr {[s swap_transfer_limit] < $bound}
+    } {1}
+
+    test "Transfer limits go back to the bounds when disabled" {
+        r config set ssdb-transfer-target-latency-us 0
+        wait_for_condition 50 20 {
+            [s swap_transfer_limit] == $bound
+        } else {
+            fail "transfer limit not reset"
+        }
+        r get key:0
+    } {val:0}
+}
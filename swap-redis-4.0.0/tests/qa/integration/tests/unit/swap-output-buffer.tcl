@@ -0,0 +1,48 @@
+start_server {tags {"ssdb"}
+overrides {ssdb-connection-pool-size 1}} {
+    test "Command SSDB can't take at once is buffered and sent in full" {
+        set stalls [s ssdb_write_stalls]
+        set val [string repeat x 4000000]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        r append foo $val
+        wait_keys_processed r
+        assert {[s ssdb_write_stalls] > $stalls}
+        list [r strlen foo] [s ssdb_output_pending_bytes]
+    } {4000003 0}
+
+    test "Clients are paused while the output to SSDB is over the limit" {
+        r config set ssdb-output-buffer-limit 1mb
+        set paused [s ssdb_output_paused]
+        set val [string repeat x 8000000]
+        r set foo2 bar
+        dumpto_ssdb_and_wait r foo2
+        set rd1 [redis_deferring_client]
+        set rd2 [redis_deferring_client]
+        $rd1 append foo $val
+        $rd2 get foo2
+        assert_equal 12000003 [$rd1 read]
+        assert_equal {bar} [$rd2 read]
+        $rd1 close
+        $rd2 close
+        wait_keys_processed r
+        assert {[s ssdb_output_paused] > $paused}
+        list [s ssdb_output_paused_clients] [r strlen foo]
+    } {0 12000003}
+
+    test "No client is paused when the limit is 0" {
+        r config set ssdb-output-buffer-limit 0
+        set paused [s ssdb_output_paused]
+        set val [string repeat x 8000000]
+        set rd1 [redis_deferring_client]
+        set rd2 [redis_deferring_client]
+        $rd1 append foo $val
+        $rd2 get foo2
+        assert_equal 20000003 [$rd1 read]
+        assert_equal {bar} [$rd2 read]
+        $rd1 close
+        $rd2 close
+        wait_keys_processed r
+        expr {[s ssdb_output_paused] - $paused}
+    } {0}
+}
@@ -0,0 +1,64 @@
+start_server {tags {"ssdb"}
+overrides {ssdb-connection-pool-size 2}} {
+    test "Commands on keys in SSDB go through the pool" {
+        set requests [s ssdb_pool_requests]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        assert_equal {bar} [r get foo]
+        r append foo baz
+        wait_keys_processed r
+        assert {[s ssdb_pool_requests] - $requests >= 2}
+        list [s ssdb_connection_pool_size] [r get foo]
+    } {2 barbaz}
+
+    test "Clients sharing the pool get their own replies" {
+        set clients {}
+        for {set i 0} {$i < 10} {incr i} {
+            r set key:$i val:$i
+            dumpto_ssdb_and_wait r key:$i
+            lappend clients [redis_deferring_client]
+        }
+        for {set j 0} {$j < 5} {incr j} {
+            for {set i 0} {$i < 10} {incr i} {
+                [lindex $clients $i] get key:$i
+            }
+            for {set i 0} {$i < 10} {incr i} {
+                assert_equal val:$i [[lindex $clients $i] read]
+            }
+        }
+        foreach client $clients {
+            $client close
+        }
+        wait_keys_processed r
+        s ssdb_pool_waiting_replies
+    } {0}
+
+    test "Commands of a client are answered in order" {
+        set rd [redis_deferring_client]
+        r set foo 0
+        dumpto_ssdb_and_wait r foo
+        for {set i 0} {$i < 100} {incr i} {
+            $rd incr foo
+        }
+        set res {}
+        set expected {}
+        for {set i 1} {$i <= 100} {incr i} {
+            lappend res [$rd read]
+            lappend expected $i
+        }
+        $rd close
+        expr {$res eq $expected}
+    } {1}
+
+    test "Reply of a freed client is dropped" {
+        set rd [redis_deferring_client]
+        $rd get foo
+        $rd close
+        wait_for_condition 100 10 {
+            [s ssdb_pool_waiting_replies] == 0
+        } else {
+            fail "reply of the freed client still waited for"
+        }
+        r get foo
+    } {100}
+}
@@ -0,0 +1,43 @@
+start_server {tags {"ssdb"}} {
+    test "EXEC loads the keys in SSDB before running" {
+        r set foo bar
+        r set foo2 bar2
+        dumpto_ssdb_and_wait r foo
+        dumpto_ssdb_and_wait r foo2
+        r multi
+        r get foo
+        r append foo2 baz
+        set res [r exec]
+        list $res [r locatekey foo] [r locatekey foo2]
+    } {{bar 7} redis redis}
+
+    test "EVAL loads the declared keys in SSDB before running" {
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        set res [r eval {return redis.call('get',KEYS[1])} 1 foo]
+        list $res [r locatekey foo]
+    } {bar redis}
+
+    test "EVAL can't access a key in SSDB it didn't declare" {
+        r set foo bar
+        r set x y
+        dumpto_ssdb_and_wait r foo
+        catch {r eval {return redis.call('get','foo')} 1 x} err
+        assert_match {*didn't declare*} $err
+        r locatekey foo
+    } {ssdb}
+
+    test "EXEC and EVAL with keys in SSDB are refused when SSDB is down" {
+        kill_ssdb_server
+        after 1000
+        r multi
+        r get foo
+        catch {r exec} err
+        assert_match {*EXECABORT*SSDB is not connected*} $err
+        catch {r eval {return redis.call('get',KEYS[1])} 1 foo} err
+        assert_match {*SSDB is not connected*} $err
+        restart_ssdb_server
+        wait_ssdb_reconnect
+        list [r eval {return redis.call('get',KEYS[1])} 1 foo] [r locatekey foo]
+    } {bar redis}
+}
@@ -0,0 +1,52 @@
+start_server {tags {"ssdb"}
+overrides {maxmemory-policy allkeys-lfu}} {
+    test "Hot cold key is loaded with the reply of a read" {
+        r config set ssdb-promote-with-read yes
+        set promoted [s keys_promoted_with_read]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        r setlfu foo 255
+        assert_equal {bar} [r get foo]
+        wait_for_condition 100 10 {
+            [r locatekey foo] eq {redis}
+        } else {
+            fail "key foo not promoted with the read"
+        }
+        assert {[s keys_promoted_with_read] > $promoted}
+        wait_keys_processed r
+        list [r get foo] [sr get foo]
+    } {bar {}}
+
+    test "Cold key not hot is read from SSDB only" {
+        set promoted [s keys_promoted_with_read]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        r setlfu foo 0
+        assert_equal {bar} [r get foo]
+        wait_keys_processed r
+        assert_equal $promoted [s keys_promoted_with_read]
+        r locatekey foo
+    } {ssdb}
+
+    test "Write is not sent as a promoting read" {
+        set promoted [s keys_promoted_with_read]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        r setlfu foo 255
+        r append foo baz
+        wait_keys_processed r
+        assert_equal $promoted [s keys_promoted_with_read]
+        r get foo
+    } {barbaz}
+
+    test "No promoting read when ssdb-promote-with-read is no" {
+        r config set ssdb-promote-with-read no
+        set promoted [s keys_promoted_with_read]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        r setlfu foo 255
+        assert_equal {bar} [r get foo]
+        wait_keys_processed r
+        assert_equal $promoted [s keys_promoted_with_read]
+    }
+}
@@ -0,0 +1,59 @@
+start_server {tags {"ssdb"}
+overrides {ssdb-read-coalescing-window-us 100000}} {
+    r set foo bar
+    dumpto_ssdb_and_wait r foo
+
+    test "Identical reads of a key in SSDB share one request" {
+        set coalesced [s reads_coalesced]
+        set clients {}
+        for {set i 0} {$i < 10} {incr i} {
+            lappend clients [redis_deferring_client]
+        }
+        for {set j 0} {$j < 20} {incr j} {
+            foreach client $clients {
+                $client get foo
+            }
+            foreach client $clients {
+                assert_equal {bar} [$client read]
+            }
+        }
+        foreach client $clients {
+            $client close
+        }
+        wait_keys_processed r
+        assert {[s reads_coalesced] > $coalesced}
+        s read_flights_in_progress
+    } {0}
+
+    test "Different reads of a key get their own replies" {
+        set rd1 [redis_deferring_client]
+        set rd2 [redis_deferring_client]
+        for {set j 0} {$j < 20} {incr j} {
+            $rd1 get foo
+            $rd2 strlen foo
+            assert_equal {bar} [$rd1 read]
+            assert_equal 3 [$rd2 read]
+        }
+        $rd1 close
+        $rd2 close
+        wait_keys_processed r
+        r locatekey foo
+    } {ssdb}
+
+    test "Reads are not coalesced when the window is 0" {
+        r config set ssdb-read-coalescing-window-us 0
+        set coalesced [s reads_coalesced]
+        set rd1 [redis_deferring_client]
+        set rd2 [redis_deferring_client]
+        for {set j 0} {$j < 20} {incr j} {
+            $rd1 get foo
+            $rd2 get foo
+            $rd1 read
+            $rd2 read
+        }
+        $rd1 close
+        $rd2 close
+        wait_keys_processed r
+        expr {[s reads_coalesced] - $coalesced}
+    } {0}
+}
@@ -0,0 +1,57 @@
+start_server {tags {"ssdb"}
+overrides {ssdb-reply-cache-size 1mb}} {
+    test "Reads of a key in SSDB are answered from the reply cache" {
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        set hits [s reply_cache_hits]
+        for {set i 0} {$i < 10} {incr i} {
+            assert_equal {bar} [r get foo]
+            wait_keys_processed r
+        }
+        assert {[s reply_cache_hits] - $hits >= 9}
+        list [s reply_cache_entries] [s reply_cache_keys] [r locatekey foo]
+    } {1 1 ssdb}
+
+    test "Different commands on a key are cached apart" {
+        assert_equal 3 [r strlen foo]
+        wait_keys_processed r
+        assert_equal {ba} [r getrange foo 0 1]
+        wait_keys_processed r
+        list [s reply_cache_entries] [s reply_cache_keys]
+    } {3 1}
+
+    test "Write to a key in SSDB drops its cached replies" {
+        set invalidations [s reply_cache_invalidations]
+        r append foo baz
+        wait_keys_processed r
+        assert {[s reply_cache_invalidations] > $invalidations}
+        assert_equal 0 [s reply_cache_keys]
+        list [r get foo] [r strlen foo]
+    } {barbaz 6}
+
+    test "Loaded key drops its cached replies" {
+        r get foo
+        wait_keys_processed r
+        assert_equal 1 [s reply_cache_keys]
+        wait_for_restoreto_redis r foo
+        list [s reply_cache_keys] [r get foo]
+    } {0 barbaz}
+
+    test "TTL is never cached" {
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        set entries [s reply_cache_entries]
+        r ttl foo
+        wait_keys_processed r
+        assert_equal $entries [s reply_cache_entries]
+        r ttl foo
+    } {-1}
+
+    test "Disabling the reply cache drops the cached replies" {
+        r get foo
+        wait_keys_processed r
+        assert {[s reply_cache_entries] > 0}
+        r config set ssdb-reply-cache-size 0
+        list [s reply_cache_entries] [s reply_cache_bytes] [r get foo]
+    } {0 0 bar}
+}
@@ -0,0 +1,77 @@
+start_server {tags {"ssdb"}} {
+    proc scan_all {args} {
+        set cur 0
+        set keys {}
+        set ssdbcur 0
+        while 1 {
+            set res [r scan $cur {*}$args]
+            set cur [lindex $res 0]
+            if {$cur >= 9223372036854775808} {set ssdbcur 1}
+            lappend keys {*}[lindex $res 1]
+            if {$cur == 0} break
+        }
+        list $ssdbcur [lsort -unique $keys]
+    }
+
+    test "SCAN returns the keys in redis and in SSDB" {
+        for {set j 0} {$j < 100} {incr j} {
+            r set hot:$j $j
+            r set cold:$j $j
+            dumpto_ssdb_and_wait r cold:$j
+        }
+        lassign [scan_all count 10] ssdbcur keys
+        assert_equal 1 $ssdbcur
+        assert_equal 200 [llength $keys]
+        assert_equal 100 [llength [lsearch -all -glob $keys cold:*]]
+    }
+
+    test "SCAN MATCH applies to the keys in SSDB" {
+        lassign [scan_all match cold:1* count 10] ssdbcur keys
+        lsort $keys
+    } [lsort {cold:1 cold:10 cold:11 cold:12 cold:13 cold:14 cold:15 cold:16 cold:17 cold:18 cold:19}]
+
+    test "SCAN skips the deleted keys still in SSDB" {
+        r config set ssdb-keep-loaded-keys yes
+        r set kept v
+        dumpto_ssdb_and_wait r kept
+        wait_for_restoreto_redis r kept
+        r del kept
+        r del cold:0
+        wait_keys_processed r
+        lassign [scan_all count 10] ssdbcur keys
+        r config set ssdb-keep-loaded-keys no
+        list [lsearch $keys kept] [lsearch $keys cold:0] [llength $keys]
+    } {-1 -1 199}
+
+    test "SCAN inside EVAL scans the keys in redis only" {
+        set keys [r eval {
+            local cursor = "0"
+            local keys = {}
+            repeat
+                local res = redis.call('scan', cursor, 'count', 10)
+                cursor = res[1]
+                for _, k in ipairs(res[2]) do table.insert(keys, k) end
+            until cursor == "0"
+            return keys
+        } 0]
+        set keys [lsort -unique $keys]
+        list [llength $keys] [llength [lsearch -all -glob $keys hot:*]]
+    } {100 100}
+
+    test "SCAN inside MULTI scans the keys in redis only" {
+        r multi
+        r scan 0 count 1000
+        set res [lindex [r exec] 0]
+        list [lindex $res 0] [llength [lsearch -all -glob [lindex $res 1] cold:*]]
+    } {0 0}
+
+    test "SCAN with a cursor of SSDB is refused in EVAL and MULTI" {
+        set cursor 9223372036854775808
+        catch {r eval "return redis.call('scan','$cursor')" 0} err
+        assert_match {*not supported in MULTI or scripts*} $err
+        r multi
+        r scan $cursor
+        catch {r exec} err
+        assert_match {*not supported in MULTI or scripts*} $err
+    }
+}
@@ -0,0 +1,41 @@
+start_server {tags {"ssdb"}
+overrides {ssdb-shm-ring-size 64kb}} {
+    test "Connections to SSDB carry their traffic over shared memory rings" {
+        set out [status r ssdb_shm_ring_bytes_out swap]
+        set in [status r ssdb_shm_ring_bytes_in swap]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        assert_equal {bar} [r get foo]
+        wait_keys_processed r
+        assert {[status r ssdb_shm_rings swap] > 0}
+        assert {[status r ssdb_shm_ring_bytes_out swap] > $out}
+        assert {[status r ssdb_shm_ring_bytes_in swap] > $in}
+        status r ssdb_shm_ring_fallbacks swap
+    } {0}
+
+    test "Commands and replies larger than a ring go through in full" {
+        set val [string repeat x 1000000]
+        r append foo $val
+        wait_keys_processed r
+        assert_equal 1000003 [r strlen foo]
+        expr {[r get foo] eq "bar$val"}
+    } {1}
+
+    test "Keys larger than a ring are transferred and loaded" {
+        set val [string repeat y 1000000]
+        r set big $val
+        dumpto_ssdb_and_wait r big
+        wait_for_restoreto_redis r big
+        wait_keys_processed r
+        expr {[r get big] eq $val}
+    } {1}
+
+    test "New connections keep using the socket when disabled" {
+        r config set ssdb-shm-ring-size 0
+        set rings [status r ssdb_shm_rings swap]
+        set client [redis [srv host] [srv port]]
+        assert_equal 1000003 [$client strlen foo]
+        $client close
+        expr {[status r ssdb_shm_rings swap] <= $rings}
+    } {1}
+}
@@ -0,0 +1,62 @@
+start_server {tags {"ssdb"}
+overrides {maxmemory-policy allkeys-lfu
+           ssdb-promote-with-read yes
+           ssdb-size-aware-swap yes}} {
+    set big [string repeat x 1048576]
+    r set small bar
+    r set big $big
+    dumpto_ssdb_and_wait r small
+    dumpto_ssdb_and_wait r big
+
+    test "Small cold key is loaded by its LFU counter" {
+        r setlfu small 8
+        assert_equal {bar} [r get small]
+        wait_for_condition 100 10 {
+            [r locatekey small] eq {redis}
+        } else {
+            fail "key small not promoted with the read"
+        }
+        wait_keys_processed r
+        r get small
+    } {bar}
+
+    test "Big cold key needs a higher LFU counter to be loaded" {
+        r setlfu big 8
+        assert_equal 1048576 [r strlen big]
+        wait_keys_processed r
+        r locatekey big
+    } {ssdb}
+
+    test "Big cold key is loaded by its LFU counter only when disabled" {
+        r config set ssdb-size-aware-swap no
+        r setlfu big 8
+        assert_equal 1048576 [r strlen big]
+        wait_for_condition 100 10 {
+            [r locatekey big] eq {redis}
+        } else {
+            fail "key big not promoted with the read"
+        }
+        wait_keys_processed r
+        expr {[r get big] eq $big}
+    } {1}
+
+    test "Bigger key is evicted first among keys as cold" {
+        r config set ssdb-size-aware-swap yes
+        set limit [lindex [r config get master-max-concurrent-transferring-keys] 1]
+        r config set master-max-concurrent-transferring-keys 0
+        r set small bar
+        r set big $big
+        r setlfu small 0
+        r setlfu big 0
+        r config set master-max-concurrent-transferring-keys 1
+        wait_for_condition 500 1 {
+            [r locatekey big] ne {redis} || [r locatekey small] ne {redis}
+        } else {
+            fail "no key evicted"
+        }
+        set first [list [r locatekey big] [r locatekey small]]
+        r config set master-max-concurrent-transferring-keys $limit
+        wait_keys_processed r
+        set first
+    } {ssdb redis}
+}
@@ -0,0 +1,68 @@
+start_server {tags {"ssdb"}
+overrides {maxmemory-policy allkeys-lfu
+           ssdb-promote-with-read yes}} {
+    test "Load of a key evicted within the window counts as a thrash" {
+        set thrash [s swap_thrash_loads]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        expr {[s swap_thrash_loads] - $thrash}
+    } {1}
+
+    test "Load of a key evicted out of the window is not a thrash" {
+        r config set ssdb-thrash-window 0
+        set thrash [s swap_thrash_loads]
+        dumpto_ssdb_and_wait r foo
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        r config set ssdb-thrash-window 60
+        expr {[s swap_thrash_loads] - $thrash}
+    } {0}
+
+    test "Key evicted within the window needs more LFU steps to be loaded" {
+        r config set ssdb-thrash-load-penalty 10
+        dumpto_ssdb_and_wait r foo
+        r setlfu foo 10
+        assert_equal {bar} [r get foo]
+        wait_keys_processed r
+        assert_equal {ssdb} [r locatekey foo]
+        r setlfu foo 20
+        assert_equal {bar} [r get foo]
+        wait_for_condition 100 10 {
+            [r locatekey foo] eq {redis}
+        } else {
+            fail "key foo not promoted with the read"
+        }
+        r config set ssdb-thrash-load-penalty 0
+        wait_keys_processed r
+        r get foo
+    } {bar}
+
+    test "Key loaded less than ssdb-min-residency ago is not evicted" {
+        r config set ssdb-min-residency 100
+        dumpto_ssdb_and_wait r foo
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        set skips [s swap_resident_skips]
+        r setlfu foo 0
+        wait_for_condition 100 10 {
+            [s swap_resident_skips] > $skips
+        } else {
+            fail "loaded key foo never skipped by the eviction"
+        }
+        r locatekey foo
+    } {redis}
+
+    test "Key loaded long enough ago is evicted again" {
+        r config set ssdb-min-residency 0
+        r setlfu foo 0
+        wait_for_condition 100 10 {
+            [r locatekey foo] eq {ssdb}
+        } else {
+            fail "key foo not evicted"
+        }
+        wait_keys_processed r
+        r get foo
+    } {bar}
+}
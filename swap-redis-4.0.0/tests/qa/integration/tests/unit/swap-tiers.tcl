@@ -0,0 +1,47 @@
+proc tierstat {cmd tier} {
+    if {![regexp "$tier=(\[0-9\]+)" [status r tierstat_$cmd tierstats] _ count]} {
+        set count 0
+    }
+    set count
+}
+
+start_server {tags {"ssdb"}} {
+    test "Commands are counted in the tier which served them" {
+        r config resetstat
+        r set foo bar
+        r set foo2 bar
+        dumpto_ssdb_and_wait r foo2
+        assert_equal {bar} [r get foo]
+        assert_equal {bar} [r get foo2]
+        assert_equal {} [r get nosuchkey]
+        wait_keys_processed r
+        list [tierstat get memory] [tierstat get ssdb] [tierstat get miss] \
+             [status r swap_tier_ssdb swap]
+    } {1 1 1 1}
+
+    test "Bytes sent to and read from SSDB are counted" {
+        set out [status r swap_ssdb_output_bytes swap]
+        set in [status r swap_ssdb_input_bytes swap]
+        assert_equal {bar} [r get foo2]
+        wait_keys_processed r
+        list [expr {[status r swap_ssdb_output_bytes swap] > $out}] \
+             [expr {[status r swap_ssdb_input_bytes swap] > $in}]
+    } {1 1}
+
+    test "SWAP TIERS samples the keys of both tiers" {
+        r config set maxmemory-policy allkeys-lru
+        assert_error {*LFU maxmemory policy*} {r swap tiers}
+        r config set maxmemory-policy noeviction
+        set tiers {}
+        foreach sample [r swap tiers 10] {
+            assert_equal 3 [llength $sample]
+            dict set tiers [lindex $sample 0] [lindex $sample 1]
+        }
+        list [dict get $tiers foo] [dict get $tiers foo2]
+    } {memory ssdb}
+
+    test "CONFIG RESETSTAT clears the tier stats" {
+        r config resetstat
+        list [status r tierstat_get tierstats] [status r swap_tier_ssdb swap]
+    } {{} 0}
+}
@@ -0,0 +1,78 @@
+start_server {tags {"ssdb"}} {
+    test "SSDB reports the weights of the transfer classes" {
+        list [status sr transfer_blocking_weight queue] \
+             [status sr transfer_hot_weight queue] \
+             [status sr transfer_evict_weight queue]
+    } {16 4 1}
+
+    test "Evictions and loads are queued in their own class" {
+        set evicted [status sr transfer_evict_processed queue]
+        set hot [status sr transfer_hot_processed queue]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        wait_for_restoreto_redis r foo
+        wait_keys_processed r
+        assert {[status sr transfer_evict_processed queue] > $evicted}
+        assert {[status sr transfer_hot_processed queue] > $hot}
+        r get foo
+    } {bar}
+
+    test "Load of a key a client is blocked on is queued as blocking" {
+        set blocking [status sr transfer_blocking_processed queue]
+        r set foo bar
+        dumpto_ssdb_and_wait r foo
+        r multi
+        r get foo
+        set res [r exec]
+        assert {[status sr transfer_blocking_processed queue] > $blocking}
+        list $res [r locatekey foo]
+    } {bar redis}
+
+    test "Key moved back and forth keeps its last value" {
+        r set foo 0
+        for {set i 1} {$i <= 20} {incr i} {
+            dumpto_ssdb_and_wait r foo
+            wait_for_restoreto_redis r foo
+            r incr foo
+        }
+        wait_keys_processed r
+        wait_for_condition 100 10 {
+            [sr get foo] eq {}
+        } else {
+            fail "loaded key foo not deleted from SSDB"
+        }
+        r get foo
+    } {20}
+
+    test "Keys transferred at once are all loaded back" {
+        set keys {}
+        set values {}
+        for {set i 0} {$i < 200} {incr i} {
+            r set key:$i val:$i
+            lappend keys key:$i
+            lappend values val:$i
+        }
+        foreach key $keys {
+            catch {r storetossdb $key}
+        }
+        foreach key $keys {
+            dumpto_ssdb_and_wait r $key
+        }
+        r multi
+        foreach key $keys {
+            r get $key
+        }
+        assert_equal $values [r exec]
+        wait_keys_processed r
+        set loaded 0
+        foreach key $keys {
+            if {[r locatekey $key] eq {redis}} {incr loaded}
+        }
+        wait_for_condition 100 10 {
+            [sr exists key:0] == 0 && [sr exists key:199] == 0
+        } else {
+            fail "loaded keys not deleted from SSDB"
+        }
+        set loaded
+    } {200}
+}
@@ -20,7 +20,6 @@ int bproc_COMMAND_DATA_SAVE(Context &ctx, TransferWorker *worker, const std::str
                             const std::string &trans_id, void *value) {
 
     SSDBServer *serv = (SSDBServer *) ctx.net->data;
-    RecordLock<Mutex> tl(&serv->transfer_mutex_record_, data_key);
 
     const std::string cmd = "ssdb-resp-dump";
 
@@ -39,7 +38,8 @@ int bproc_COMMAND_DATA_SAVE(Context &ctx, TransferWorker *worker, const std::str
     }
 
 
-    std::vector<std::string> req = {"ssdb-resp-del", data_key, trans_id};
+    // the depth of the transfer queue lets redis adapt how many keys it transfers at once.
+    std::vector<std::string> req = {"ssdb-resp-del", data_key, trans_id, str(ctx.net->redis->queued())};
     log_debug("[request->redis] : %s %s %s", hexcstr(req[0]), hexcstr(req[1]), hexcstr(req[2]));
 
     std::unique_ptr<RedisResponse> t_res(worker->redisUpstream->sendCommand(req));
@@ -55,11 +55,10 @@ int bproc_COMMAND_DATA_SAVE(Context &ctx, TransferWorker *worker, const std::str
     return 0;
 }
 
-int bproc_COMMAND_DATA_DUMP(Context &ctx, TransferWorker *worker, const std::string &data_key,
-                            const std::string &trans_id, void *value) {
+static int dumpToRedis(Context &ctx, TransferWorker *worker, const std::string &data_key,
+                       const std::string &trans_id, bool keep) {
 
     SSDBServer *serv = (SSDBServer *) ctx.net->data;
-    RecordLock<Mutex> tl(&serv->transfer_mutex_record_, data_key);
 
     const std::string cmd = "ssdb-resp-restore";
 
@@ -68,7 +67,7 @@ int bproc_COMMAND_DATA_DUMP(Context &ctx, TransferWorker *worker, const std::str
     int64_t pttl = 0;
 
     PTST(dump, 0.03)
-    int ret = serv->ssdb->dump(ctx, data_key, &val, &pttl, serv->opt.rdb_compression);
+    int ret = serv->ssdb->dump(ctx, data_key, &val, &pttl, serv->opt.rdb_compression, true);
     PTE(dump, hexstr(data_key))
 
 
@@ -85,6 +84,9 @@ int bproc_COMMAND_DATA_DUMP(Context &ctx, TransferWorker *worker, const std::str
 
         //process restore to redis
         std::vector<std::string> req = {cmd, data_key, str(pttl), val, "replace", trans_id};
+        if (keep) {
+            req.emplace_back("keep");
+        }
         log_debug("[request->redis] : %s %s %s", hexcstr(req[0]), hexcstr(req[1]), hexcstr(req[5]));
 
         std::unique_ptr<RedisResponse> t_res(worker->redisUpstream->sendCommand(req));
@@ -98,9 +100,9 @@ int bproc_COMMAND_DATA_DUMP(Context &ctx, TransferWorker *worker, const std::str
                   t_res->toString().c_str());
 
 
-        if (t_res->isOk()) {
+        if (t_res->isOk() && !keep) {
             log_debug("mark deleting %s", hexcstr(data_key));
-            serv->ssdb->del(ctx, data_key);
+            worker->deferDelete(ctx, data_key);
         }
 
     }
@@ -109,6 +111,38 @@ int bproc_COMMAND_DATA_DUMP(Context &ctx, TransferWorker *worker, const std::str
     return 0;
 }
 
+int bproc_COMMAND_DATA_DUMP(Context &ctx, TransferWorker *worker, const std::string &data_key,
+                            const std::string &trans_id, void *value) {
+    return dumpToRedis(ctx, worker, data_key, trans_id, false);
+}
+
+int bproc_COMMAND_DATA_DUMP_KEEP(Context &ctx, TransferWorker *worker, const std::string &data_key,
+                                 const std::string &trans_id, void *value) {
+    return dumpToRedis(ctx, worker, data_key, trans_id, true);
+}
+
+
+int bproc_COMMAND_HOT_KEYS(Context &ctx, TransferWorker *worker, const std::string &data_key,
+                           const std::string &trans_id, void *value) {
+
+    std::vector<std::string> *args = (std::vector<std::string> *) value;
+
+    std::vector<std::string> req = {"ssdb-resp-hot"};
+    req.insert(req.end(), args->begin(), args->end());
+    log_debug("[request->redis] : %s %d keys", hexcstr(req[0]), (int) (args->size() / 2));
+
+    std::unique_ptr<RedisResponse> t_res(worker->redisUpstream->sendCommand(req));
+    if (!t_res) {
+        log_error("[%s] redis response is null", hexcstr(req[0]));
+        //redis res failed
+        return -1;
+    }
+
+    log_debug("[response<-redis] : %s %s", hexcstr(req[0]), t_res->toString().c_str());
+
+    return 0;
+}
+
 
 int notifyFailedToRedis(RedisUpstream *redisUpstream, const std::string &response_cmd, const std::string &data_key,
                         const std::string &trans_id) {
@@ -62,6 +62,10 @@ public:
     bool firstbatch = true;
     bool replLink = false;
 
+    // "promote", <id>, <payload> of a key redis asked to promote
+    // along with the read, appended to the append reply.
+    std::vector<std::string> promote;
+
     void mark_check() {
         checkKey = true;
     }
@@ -69,6 +73,7 @@ public:
     void reset() {
         checkKey = false;
         firstbatch = true;
+        promote.clear();
     }
 
     bool isFirstbatch() const {
@@ -95,6 +100,8 @@ public:
 
         vec.emplace_back(lastSeqCnx.toString());
 
+        vec.insert(vec.end(), promote.begin(), promote.end());
+
         return vec;
     }
 
@@ -26,6 +26,8 @@ Link::Link(bool is_server) {
 #endif
 
     redis = NULL;
+    shm = NULL;
+    shm_next = NULL;
 
     sock = -1;
     noblock_ = false;
@@ -63,6 +65,8 @@ Link::~Link() {
         delete context;
         context = nullptr;
     }
+    delete shm;
+    delete shm_next;
     this->close();
 }
 
@@ -308,6 +312,9 @@ int Link::read(int shrink) {
     if (input->size() == 0 && input->total() > shrink) {
         input->shrink(shrink);
     }
+    if (shm) {
+        return read_shm();
+    }
 
     while ((want = input->space()) > 0) {
         // test
@@ -342,7 +349,10 @@ int Link::read(int shrink) {
 int Link::write(int shrink) {
     int ret = 0;
     int want;
-    while ((want = output->size()) > 0) {
+    if (shm) {
+        ret = write_shm();
+    }
+    while (!shm && (want = output->size()) > 0) {
         // test
         //want = 1;
         int len = ::write(sock, output->data(), want);
@@ -374,6 +384,89 @@ int Link::write(int shrink) {
             output->shrink(shrink);
         }
     }
+    if (shm_next && output->empty()) {
+        shm = shm_next;
+        shm_next = NULL;
+    }
+    return ret;
+}
+
+void Link::attach_shm(ShmRingPair *shm) {
+    delete shm_next;
+    shm_next = shm;
+}
+
+// wake up the peer waiting on the other side of the rings
+void Link::ring_doorbell() {
+    char c = 0;
+    // a doorbell already in the socket is as good
+    while (::write(sock, &c, 1) == -1 && errno == EINTR);
+}
+
+// Drain the doorbells from the socket, then the requests from the ring.
+// Return the bytes read, 0 on hangup.
+int Link::read_shm() {
+    char buf[256];
+    int ret = 0;
+    bool consumed = false;
+
+    while (1) {
+        int len = ::read(sock, buf, sizeof(buf));
+        if (len == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        if (len == 0) {
+            return 0;
+        }
+        ret += len;
+    }
+
+    // there is no doorbell for what is left, so take it all
+    do {
+        uint64_t used;
+        while ((used = shm_ring_used(shm->in)) > 0) {
+            while ((int64_t)used > input->space()) {
+                if (input->grow() == -1) {
+                    return -1;
+                }
+            }
+            int len = (int)shm_ring_read(shm->in, input->slot(), used);
+            input->incr(len);
+            ret += len;
+            consumed = true;
+        }
+    } while (!shm_ring_sleep(shm->in));
+
+    if (consumed && shm_ring_wake_producer(shm->in)) {
+        ring_doorbell();
+    }
+    return ret;
+}
+
+// Copy the output to the ring, what doesn't fit is written once redis
+// rings for room. Return the bytes written.
+int Link::write_shm() {
+    int ret = 0;
+
+    while (!output->empty()) {
+        int len = (int)shm_ring_write(shm->out, output->data(), output->size());
+        if (len == 0) {
+            if (shm_ring_block(shm->out)) {
+                break;
+            }
+            continue;
+        }
+        output->decr(len);
+        ret += len;
+    }
+    if (ret > 0 && shm_ring_wake_consumer(shm->out)) {
+        ring_doorbell();
+    }
     return ret;
 }
 
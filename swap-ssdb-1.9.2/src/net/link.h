@@ -15,6 +15,7 @@ found in the LICENSE file.
 #include "../util/bytes.h"
 
 #include "link_redis.h"
+#include "shm_ring.h"
 class Context;
 
 class Link{
@@ -23,6 +24,12 @@ class Link{
 		bool noblock_;
 		bool error_;
 		std::vector<Bytes> recv_data;
+		// set by attach_shm(), used once the pending output is written
+		ShmRingPair *shm_next;
+
+		int read_shm();
+		int write_shm();
+		void ring_doorbell();
 	public:
 		bool append_reply;
 
@@ -39,6 +46,8 @@ class Link{
 
 		RedisLink *redis;
 		Context *context = nullptr;
+		// rings replacing the socket for the data, see shm_ring.h
+		ShmRingPair *shm;
 		double create_time;
 		double active_time;
 
@@ -63,6 +72,8 @@ class Link{
 		void mark_error(){
 			error_ = true;
 		}
+		// switch to the rings after the reply being sent on the socket
+		void attach_shm(ShmRingPair *shm);
 
 		static Link *unixsocket(const std::string &path);
 		static Link* connect(const char *ip, int port, long timeout_ms = -1);
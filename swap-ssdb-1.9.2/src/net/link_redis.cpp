@@ -6,6 +6,7 @@ found in the LICENSE file.
 #include "link_redis.h"
 #include <map>
 #include <cstring>
+#include <cerrno>
 #include <net/redis/reponse_redis.h>
 #include <unordered_map>
 
@@ -73,6 +74,8 @@ static RedisCommand_raw cmds_raw[] = {
 	{STRATEGY_AUTO, "rr_make_snapshot",	    "rr_make_snapshot",  	REPLY_BULK},
 	{STRATEGY_AUTO, "rr_transfer_snapshot",	"rr_transfer_snapshot", REPLY_BULK},
 	{STRATEGY_AUTO, "rr_del_snapshot",	    "rr_del_snapshot",  	REPLY_BULK},
+	{STRATEGY_AUTO, "rr_transfer_dict",	    "rr_transfer_dict",  	REPLY_BULK},
+	{STRATEGY_AUTO, "rr_shm_ring",	    "rr_shm_ring",  	    REPLY_OK_STATUS},
 	{STRATEGY_AUTO, "rr_info",	"info",			REPLY_INFO},
 
 
@@ -553,6 +556,19 @@ const std::vector<Bytes>* RedisLink::recv_req(Buffer *input){
 
 	cmd = recv_bytes[0].String();
 	strtolower(&cmd);
+
+	// "rr_promote <id> <cmd> ..." runs <cmd> and returns the dump of its
+	// key in the append reply, see NetworkServer::proc_promote().
+	promote_id = -1;
+	if(cmd == "rr_promote" && recv_bytes.size() > 3){
+		int64_t id = recv_bytes[1].Int64();
+		if(errno != EINVAL && id >= 0){
+			promote_id = id;
+			recv_bytes.erase(recv_bytes.begin(), recv_bytes.begin() + 2);
+			cmd = recv_bytes[0].String();
+			strtolower(&cmd);
+		}
+	}
 	
 	recv_string.clear();
 	
@@ -32,8 +32,13 @@ private:
 	int convert_req();
 	
 public:
+	// transfer id of "rr_promote <id> <cmd> ...", -1 if the current
+	// request doesn't ask for its key to be promoted.
+	int64_t promote_id;
+
 	RedisLink(){
 		req_desc = NULL;
+		promote_id = -1;
 	}
 
 	~RedisLink(){
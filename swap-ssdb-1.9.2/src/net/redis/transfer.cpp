@@ -9,6 +9,19 @@ found in the LICENSE file.
 #include "transfer.h"
 
 
+const char *transferClassName(int cls) {
+    switch (cls) {
+        case TRANSFER_CLASS_BLOCKING:
+            return "blocking";
+        case TRANSFER_CLASS_HOT:
+            return "hot";
+        case TRANSFER_CLASS_EVICT:
+            return "evict";
+        default:
+            return "unknown";
+    }
+}
+
 TransferWorker::TransferWorker(const std::string &name) {
     this->name = name;
 }
@@ -27,6 +40,47 @@ void TransferWorker::init() {
     this->last = 0;
 }
 
+// The queue ends a batch at its first eviction(TRANSFER_EVICT_BATCH), so the
+// loads queued while it runs are picked before the next one.
+int TransferWorker::proc_batch(std::vector<TransferJob *> &jobs) {
+    for (TransferJob *job : jobs) {
+        if (job->type != COMMAND_DATA_DUMP && job->type != COMMAND_DATA_DUMP_KEEP) {
+            // a restore may recreate a key whose delete is still pending.
+            flushDeleted();
+        }
+        proc(job);
+    }
+
+    flushDeleted();
+    return 0;
+}
+
+void TransferWorker::deferDelete(Context &ctx, const std::string &data_key) {
+    if (deleted_keys.empty()) {
+        delete_ctx = ctx;
+    }
+    deleted_keys.insert(data_key);
+}
+
+void TransferWorker::flushDeleted() {
+    if (deleted_keys.empty()) {
+        return;
+    }
+
+    auto serv = ((SSDBServer *) (delete_ctx.net->data));
+    int64_t num = 0;
+
+    PTST(multi_del, 0.03)
+    int ret = serv->ssdb->multi_del(delete_ctx, deleted_keys, &num);
+    PTE(multi_del, str(deleted_keys.size()))
+
+    if (ret < 0) {
+        log_error("delete %d loaded keys failed", (int) deleted_keys.size());
+    }
+
+    deleted_keys.clear();
+}
+
 int TransferWorker::proc(TransferJob *job) {
 
     if (redisUpstream == nullptr) {
@@ -45,7 +99,8 @@ int TransferWorker::proc(TransferJob *job) {
     }
 
     int64_t current = time_ms();
-    int res = (*job->proc)(job->ctx, this, job->data_key, job->trans_id, job->dumpData);
+    void *value = job->type == COMMAND_HOT_KEYS ? (void *) &job->args : (void *) job->dumpData;
+    int res = (*job->proc)(job->ctx, this, job->data_key, job->trans_id, value);
     if (res != 0) {
         log_error("bg_job failed %s ", job->dump().c_str());
     }
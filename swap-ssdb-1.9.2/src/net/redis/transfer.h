@@ -24,6 +24,21 @@ typedef int (*bproc_t)(Context &ctx, TransferWorker *, const std::string &data_k
 
 class SSDBServer;
 
+#define COMMAND_DATA_SAVE 1
+#define COMMAND_DATA_DUMP 2
+#define COMMAND_DATA_DUMP_KEEP 3 // load without deleting the key, redis tracks the copy
+#define COMMAND_HOT_KEYS 4 // promotion candidates pushed to redis, with their weight
+
+// Scheduling classes of the transfer pool, in priority order.
+enum TransferClass {
+    TRANSFER_CLASS_BLOCKING = 0, // load of a key some redis clients are blocked on
+    TRANSFER_CLASS_HOT,          // load of a key chosen by redis hot key rules
+    TRANSFER_CLASS_EVICT,        // background eviction from redis
+    TRANSFER_CLASS_MAX
+};
+
+const char *transferClassName(int cls);
+
 
 class TransferJob {
 public:
@@ -38,6 +53,7 @@ public:
     std::string trans_id;
 
     DumpData *dumpData;
+    std::vector<std::string> args; // keys and weights of COMMAND_HOT_KEYS
     bproc_t proc;
 
     TransferJob(Context &ctx, uint16_t type, const std::string &key, const std::string &id, DumpData *value = nullptr) :
@@ -63,7 +79,9 @@ public:
 };
 
 // WARN: pipe latency is about 20 us, it is really slow!
-class TransferWorker : public WorkerPool<TransferWorker, TransferJob *>::Worker {
+typedef WeightedQueue<TransferJob *, TRANSFER_CLASS_MAX> TransferQueue;
+
+class TransferWorker : public ShardedWorkerPool<TransferWorker, TransferJob *, TransferQueue>::Worker {
 public:
 
     TransferWorker(const std::string &name);
@@ -72,12 +90,22 @@ public:
 
     int proc(TransferJob *job);
 
+    int proc_batch(std::vector<TransferJob *> &jobs);
+
+    // keys loaded into redis are deleted together at the end of a batch
+    void deferDelete(Context &ctx, const std::string &data_key);
+
     virtual ~TransferWorker();
 
     RedisUpstream *redisUpstream = nullptr;
 
 private:
 
+    void flushDeleted();
+
+    Context delete_ctx;
+    std::set<std::string> deleted_keys;
+
     //stat only
     int64_t count;
     double avg_wait;
@@ -87,7 +115,11 @@ private:
 
 };
 
-typedef WorkerPool<TransferWorker, TransferJob *> TransferWorkerPool;
+// jobs are routed by hash of data_key, so jobs of one key never run concurrently.
+// They may still run out of push order across classes, as classes are served by
+// weight: that is fine only because redis never has a load and a transfer of the
+// same key in flight at once.
+typedef ShardedWorkerPool<TransferWorker, TransferJob *, TransferQueue> TransferWorkerPool;
 
 
 #endif //SSDB_TRANSFERWORKER_H
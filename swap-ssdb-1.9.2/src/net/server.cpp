@@ -18,6 +18,7 @@ found in the LICENSE file.
 static DEF_PROC(ping);
 static DEF_PROC(info);
 static DEF_PROC(auth);
+static DEF_PROC(shm_ring);
 
 
 #define TICK_INTERVAL          100 // ms
@@ -25,6 +26,11 @@ static DEF_PROC(auth);
 #define CURSOR_CLEANUP_TICKS    (60 * 1000/TICK_INTERVAL) // second
 
 static const int TRANSFER_THREADS = 5;
+// default share of transfer workers for blocking loads, hot loads and evictions
+static const int TRANSFER_WEIGHTS[TRANSFER_CLASS_MAX] = {16, 4, 1};
+// evictions taken by a transfer worker at once, a blocking load queued behind
+// them waits for no more than this many
+static const int TRANSFER_EVICT_BATCH = 1;
 static const int READER_THREADS = 10;
 static const int WRITER_THREADS = 1;  // 必须为1, 因为某些写操作依赖单线程
 
@@ -85,6 +91,9 @@ NetworkServer::NetworkServer(){
 	num_readers = READER_THREADS;
 	num_writers = WRITER_THREADS;
 	num_transfers = TRANSFER_THREADS;
+	for(int i=0; i<TRANSFER_CLASS_MAX; i++){
+		transfer_weights[i] = TRANSFER_WEIGHTS[i];
+	}
 
 	tick_interval = TICK_INTERVAL;
 	status_report_ticks = STATUS_REPORT_TICKS;
@@ -101,6 +110,7 @@ NetworkServer::NetworkServer(){
 	proc_map.set_proc("ping", "r", proc_ping);
 	proc_map.set_proc("info", "r", proc_info);
 	proc_map.set_proc("auth", "r", proc_auth);
+	proc_map.set_proc("rr_shm_ring", "r", proc_shm_ring);
 
 
 	signal(SIGPIPE, SIG_IGN);
@@ -210,9 +220,33 @@ NetworkServer* NetworkServer::init(const Config &conf, int num_readers, int num_
 			serv->num_transfers = conf.get_num("server.transfers");
 		}
 
+        if(conf.get_num("server.transfer_blocking_weight") > 0){
+			serv->transfer_weights[TRANSFER_CLASS_BLOCKING] = conf.get_num("server.transfer_blocking_weight");
+		}
+
+        if(conf.get_num("server.transfer_hot_weight") > 0){
+			serv->transfer_weights[TRANSFER_CLASS_HOT] = conf.get_num("server.transfer_hot_weight");
+		}
+
+        if(conf.get_num("server.transfer_evict_weight") > 0){
+			serv->transfer_weights[TRANSFER_CLASS_EVICT] = conf.get_num("server.transfer_evict_weight");
+		}
+
         if(conf.get_num("server.num_background") > 0){
 			serv->num_background = conf.get_num("server.num_background");
 		}
+
+        if(conf.get_num("server.hot_keys_interval") > 0){
+			serv->hot_keys_interval = conf.get_num("server.hot_keys_interval");
+		}
+
+        if(conf.get_num("server.hot_keys_count") > 0){
+			serv->hot_keys_count = conf.get_num("server.hot_keys_count");
+		}
+
+        if(conf.get_num("server.hot_keys_capacity") > 0){
+			serv->hot_keys.capacity = conf.get_num("server.hot_keys_capacity");
+		}
 	}
 
 	// init ip_filter
@@ -298,7 +332,14 @@ void NetworkServer::serve(){
 	reader->start(num_readers);
 
 	redis = new TransferWorkerPool("transfer");
-	redis->start(num_transfers);
+	redis->init(num_transfers);
+	for(int i=0; i<redis->num_shards(); i++){
+		for(int j=0; j<TRANSFER_CLASS_MAX; j++){
+			redis->queue(i)->set_weight(j, transfer_weights[j]);
+		}
+		redis->queue(i)->set_batch_limit(TRANSFER_CLASS_EVICT, TRANSFER_EVICT_BATCH);
+	}
+	redis->start();
 
     background = new BackgroundThreadPool("background");
     background->start(num_background);
@@ -319,6 +360,7 @@ void NetworkServer::serve(){
 
 	uint32_t status_ticks = g_ticks;
 	uint32_t cursor_ticks = g_ticks;
+	uint32_t hot_keys_ticks = g_ticks;
 
 	log_info("ssdb server started.");
 
@@ -336,6 +378,12 @@ void NetworkServer::serve(){
 			cleanup_cursor();
 		}
 
+		if(hot_keys_interval > 0
+			&& (uint32_t)(g_ticks - hot_keys_ticks) >= (uint32_t)(hot_keys_interval / TICK_INTERVAL)){
+			hot_keys_ticks = g_ticks;
+			push_hot_keys();
+		}
+
 		ready_list.swap(ready_list_2);
 		ready_list_2.clear();
 		
@@ -484,6 +532,19 @@ void NetworkServer::cleanup_cursor() {
 	}
 }
 
+void NetworkServer::push_hot_keys() {
+	Command *cmd = proc_map.get_proc("hot_keys_push");
+	if(!cmd || hot_keys.size() == 0){
+		return;
+	}
+	std::string count = str(hot_keys_count);
+	Request request = {"hot_keys_push", count};
+	Response response;
+	Context context;
+	context.net = this;
+	cmd->proc(context, nullptr, request, &response);
+}
+
 Link* NetworkServer::accept_link(Link *l){
 	Link *link = l->accept();
 	if(link == NULL){
@@ -523,6 +584,12 @@ int NetworkServer::proc_result(ProcJob *job, ready_list_t *ready_list){
 
 	slowlog.pushEntryIfNeeded(job->req, (int64_t) job->time_proc);
 
+	// the reads redis sends for its cold keys
+	if(hot_keys_interval > 0 && job->cmd && link->redis != nullptr && job->req->size() > 1
+		&& (job->cmd->flags & Command::FLAG_READ) && (job->cmd->flags & Command::FLAG_THREAD)){
+		hot_keys.record(job->req->at(1).String(), (int64_t) job->time_proc);
+	}
+
 	if(result == PROC_ERROR){
 
 		std::string error_cmd = "cmd: ";
@@ -553,7 +620,8 @@ int NetworkServer::proc_result(ProcJob *job, ready_list_t *ready_list){
 		}
 	}
 
-	if(!link->output->empty()){
+	// a link on rings is woken up by redis when there is room again
+	if(!link->output->empty() && !link->shm){
 		fdes->set(link->fd(), FDEVENT_OUT, 1, link);
 	}
 	if(link->input->empty()){
@@ -610,6 +678,11 @@ int NetworkServer::proc_client_event(const Fdevent *fde, ready_list_t *ready_lis
 			link->mark_error();
 			return 0;
 		}
+		// the doorbell may be for room in the ring of the replies
+		if(link->shm && !link->output->empty() && link->write() < 0){
+			link->mark_error();
+			return 0;
+		}
 	}
 	if(fde->events & FDEVENT_OUT){
 		if(link->error()){
@@ -701,6 +774,7 @@ int NetworkServer::proc(ProcJob *job){
 
 	if (job->link->append_reply) {
         if (!job->resp.resp.empty()) {
+            this->proc_promote(job);
             if(job->link->send_append_res(job->link->context->get_append_array()) == -1){
                 log_debug("job->link->send_append_res error");
                 job->result = PROC_ERROR;
@@ -713,6 +787,21 @@ int NetworkServer::proc(ProcJob *job){
 	return job->result;
 }
 
+/* Dump the key of a request wrapped by "rr_promote" into the context, it is
+ * sent back in the append reply. Must run right after the wrapped proc and
+ * in the same thread, so that no write gets in between. */
+void NetworkServer::proc_promote(ProcJob *job){
+	Link *link = job->link;
+	if(link->redis == nullptr || link->redis->promote_id < 0 || !promote_proc){
+		return;
+	}
+	if(job->result == PROC_ERROR || job->resp.resp.empty() || job->resp.resp[0] != "ok"){
+		return;
+	}
+
+	Response resp;
+	(*promote_proc)(*link->context, link, *job->req, &resp);
+}
 
 /* built-in procs */
 
@@ -741,6 +830,27 @@ static int proc_info(Context &ctx, Link *link, const Request &req, Response *res
 	return 0;
 }
 
+/* rr_shm_ring <path> <size>: use the rings redis created at <path> instead of
+ * the socket, once the reply is sent. */
+static int proc_shm_ring(Context &ctx, Link *link, const Request &req, Response *resp){
+	if(req.size() != 3){
+		resp->push_back("client_error");
+		return 0;
+	}
+	if(link->shm){
+		reply_errinfo_return("ERR the link already uses a shared memory ring");
+	}
+	ShmRingPair *shm = ShmRingPair::open(req[1].String(), req[2].Int64());
+	if(!shm){
+		log_warn("fd: %d, cannot map the shared memory ring %s: %s",
+			link->fd(), req[1].String().c_str(), strerror(errno));
+		reply_errinfo_return("ERR cannot map the shared memory ring");
+	}
+	link->attach_shm(shm);
+	resp->push_back("ok");
+	return 0;
+}
+
 static int proc_auth(Context &ctx, Link *link, const Request &req, Response *resp){
 	if(req.size() != 2){
 		resp->push_back("client_error");
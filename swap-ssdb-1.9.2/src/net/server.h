@@ -10,6 +10,7 @@ found in the LICENSE file.
 #include <string>
 #include <vector>
 #include <util/slowlog.h>
+#include <util/hot_keys.h>
 
 #include "fde.h"
 #include "proc.h"
@@ -43,6 +44,7 @@ private:
 	int num_readers;
 	int num_writers;
 	int num_transfers = 5;
+	int transfer_weights[TRANSFER_CLASS_MAX];
 	int num_background = 3;
 
 	ProcWorkerPool *writer;
@@ -51,6 +53,7 @@ private:
 	NetworkServer();
 
 	void cleanup_cursor();
+	void push_hot_keys();
 
 protected:
 	void usage(int argc, char **argv);
@@ -62,6 +65,7 @@ public:
 	IpFilter *ip_filter;
 	void *data;
 	ProcMap proc_map;
+	proc_t promote_proc = nullptr;
 	int link_count;
 	bool need_auth;
 	std::string password;
@@ -72,9 +76,21 @@ public:
 	static NetworkServer* init(const char *conf_file, int num_readers=-1, int num_writers=-1);
 	static NetworkServer* init(const Config &conf, int num_readers=-1, int num_writers=-1);
 	void serve();
+	void proc_promote(ProcJob *job);
+
+	// jobs waiting for a reader or a writer thread
+	int queued_reads(){ return reader->queued(); }
+	int queued_writes(){ return writer->queued(); }
 
 	Slowlog slowlog;
 
+	// reads of redis weighted by their cost, the heaviest keys are pushed
+	// to redis as promotion candidates every hot_keys_interval ms, 0 to
+	// disable it.
+	HotKeys hot_keys;
+	int hot_keys_interval = 0;
+	int hot_keys_count = 32;
+
 };
 
 
@@ -0,0 +1,166 @@
+/*
+Copyright (c) 2017, Timothy. All rights reserved.
+Use of this source code is governed by a BSD-style license that can be
+found in the LICENSE file.
+*/
+#ifndef NET_SHM_RING_H_
+#define NET_SHM_RING_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+
+/*
+ * Shared memory rings between swap-redis and SSDB on the same host.
+ *
+ * Redis maps a file with two single producer, single consumer rings: its
+ * requests, then the replies of SSDB. The requests and replies keep the
+ * framing they have on the socket, only the bytes go through the rings.
+ * The socket stays open: a peer waiting for data, or for room in a full
+ * ring, is woken up by a byte written on it, and its hangup is still seen
+ * by the event loop.
+ *
+ * The layout must be the same as in shmring.c of swap-redis.
+ */
+
+#define SHM_RING_MAGIC 0x31474e5250415753ULL /* "SWAPRNG1" */
+
+struct shm_ring{
+	uint64_t magic;
+	uint64_t size;              // of the data following the header, a power of 2
+	char pad0[48];
+	uint64_t head;              // bytes written, by the producer only
+	char pad1[56];
+	uint64_t tail;              // bytes read, by the consumer only
+	char pad2[56];
+	uint32_t consumer_waiting;  // the consumer wants a doorbell for new data
+	uint32_t producer_blocked;  // the producer wants a doorbell for room
+	char pad3[56];
+};
+
+static inline char* shm_ring_data(shm_ring *r){
+	return (char *)r + sizeof(shm_ring);
+}
+
+// consumer
+static inline uint64_t shm_ring_used(shm_ring *r){
+	return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) - r->tail;
+}
+
+// producer
+static inline uint64_t shm_ring_free(shm_ring *r){
+	return r->size - (r->head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE));
+}
+
+static inline size_t shm_ring_write(shm_ring *r, const char *buf, size_t len){
+	uint64_t n = shm_ring_free(r);
+	if(n > len){
+		n = len;
+	}
+	if(n == 0){
+		return 0;
+	}
+	uint64_t pos = r->head & (r->size - 1);
+	uint64_t first = r->size - pos < n? r->size - pos : n;
+	memcpy(shm_ring_data(r) + pos, buf, first);
+	memcpy(shm_ring_data(r), buf + first, n - first);
+	__atomic_store_n(&r->head, r->head + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+static inline size_t shm_ring_read(shm_ring *r, char *buf, size_t len){
+	uint64_t n = shm_ring_used(r);
+	if(n > len){
+		n = len;
+	}
+	if(n == 0){
+		return 0;
+	}
+	uint64_t pos = r->tail & (r->size - 1);
+	uint64_t first = r->size - pos < n? r->size - pos : n;
+	memcpy(buf, shm_ring_data(r) + pos, first);
+	memcpy(buf + first, shm_ring_data(r), n - first);
+	__atomic_store_n(&r->tail, r->tail + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+// The consumer found the ring empty, return false if data came in meanwhile.
+static inline bool shm_ring_sleep(shm_ring *r){
+	__atomic_store_n(&r->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return shm_ring_used(r) == 0;
+}
+
+// The producer wrote, return true if the consumer must be woken up.
+static inline bool shm_ring_wake_consumer(shm_ring *r){
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return __atomic_load_n(&r->consumer_waiting, __ATOMIC_SEQ_CST)
+		&& __atomic_exchange_n(&r->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+}
+
+// The producer found the ring full, return false if room was made meanwhile.
+static inline bool shm_ring_block(shm_ring *r){
+	__atomic_store_n(&r->producer_blocked, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return shm_ring_free(r) == 0;
+}
+
+// The consumer read, return true if the producer must be woken up.
+static inline bool shm_ring_wake_producer(shm_ring *r){
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return __atomic_load_n(&r->producer_blocked, __ATOMIC_SEQ_CST)
+		&& __atomic_exchange_n(&r->producer_blocked, 0, __ATOMIC_SEQ_CST);
+}
+
+class ShmRingPair{
+	private:
+		void *addr;
+		size_t len;
+		ShmRingPair(){}
+	public:
+		shm_ring *in;   // requests of redis
+		shm_ring *out;  // replies to redis
+
+		~ShmRingPair(){
+			munmap(addr, len);
+		}
+
+		// Map the rings created by redis at 'path', NULL on error.
+		static ShmRingPair* open(const std::string &path, int64_t size){
+			if(size <= 0 || (size & (size - 1)) != 0){
+				return NULL;
+			}
+			int fd = ::open(path.c_str(), O_RDWR);
+			if(fd == -1){
+				return NULL;
+			}
+			size_t len = 2 * (sizeof(shm_ring) + size);
+			struct stat st;
+			void *addr = MAP_FAILED;
+			if(fstat(fd, &st) == 0 && (size_t)st.st_size == len){
+				addr = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			::close(fd);
+			if(addr == MAP_FAILED){
+				return NULL;
+			}
+
+			ShmRingPair *shm = new ShmRingPair();
+			shm->addr = addr;
+			shm->len = len;
+			shm->in = (shm_ring *)addr;
+			shm->out = (shm_ring *)((char *)addr + sizeof(shm_ring) + size);
+			if(shm->in->magic != SHM_RING_MAGIC || shm->out->magic != SHM_RING_MAGIC
+				|| shm->in->size != (uint64_t)size || shm->out->size != (uint64_t)size){
+				delete shm;
+				return NULL;
+			}
+			return shm;
+		}
+};
+
+#endif
@@ -6,6 +6,7 @@ found in the LICENSE file.
 #include <net/redis/reponse_redis.h>
 #include "worker.h"
 #include "link.h"
+#include "server.h"
 #include "../util/log.h"
 #include "../include.h"
 
@@ -60,6 +61,7 @@ int ProcWorker::proc(ProcJob *job){
 	//todo append custom reply
 	if (job->link->append_reply) {
 		if (!job->resp.resp.empty()) {
+				job->serv->proc_promote(job);
 				if(job->link->send_append_res(job->link->context->get_append_array()) == -1){
 
 				log_debug("job->link->send_append_res error");
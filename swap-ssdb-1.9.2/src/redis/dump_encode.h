@@ -29,6 +29,12 @@ public:
         w.reserve(1024); //1k
     }
 
+    DumpEncoder(bool rdb_compression, TransferDictPtr transfer_dict) {
+        RedisEncoder::rdb_compression = rdb_compression;
+        RedisEncoder::transfer_dict = std::move(transfer_dict);
+        w.reserve(1024); //1k
+    }
+
     DumpEncoder() {
         w.reserve(1024); //1k
     }
@@ -96,5 +96,28 @@ unsigned int
 lzf_decompress (const void *const in_data,  unsigned int in_len,
                 void             *out_data, unsigned int out_len);
 
+/*
+ * Preset dictionary variants. The dictionary (at most 8192 bytes are
+ * reachable by a back reference) is shared out of band by both sides.
+ *
+ * lzf_compress_dict expects buf to hold dict_len bytes of dictionary
+ * immediately followed by the in_len bytes to compress. The return value
+ * and the output format are the same as lzf_compress, but the result can
+ * only be decompressed with lzf_decompress_dict and the same dictionary.
+ *
+ * lzf_decompress_dict expects buf to hold dict_len bytes of dictionary
+ * followed by room for out_len bytes, where the decompressed data is
+ * stored. It returns the number of decompressed bytes like lzf_decompress.
+ */
+unsigned int
+lzf_compress_dict (const void *const buf,      unsigned int dict_len,
+                   unsigned int in_len,
+                   void             *out_data, unsigned int out_len);
+
+unsigned int
+lzf_decompress_dict (const void *const in_data,  unsigned int in_len,
+                     void             *buf,      unsigned int dict_len,
+                     unsigned int out_len);
+
 #endif
 
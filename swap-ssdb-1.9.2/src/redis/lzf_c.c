@@ -95,18 +95,19 @@
  *
  */
 
-unsigned int
-lzf_compress (const void *const in_data, unsigned int in_len,
-	      void *out_data, unsigned int out_len
-#if LZF_STATE_ARG
-              , LZF_STATE htab
-#endif
-              )
+/*
+ * in_data points to prefix_len bytes of already known data (a preset
+ * dictionary, possibly empty) immediately followed by the in_len bytes to
+ * compress. Back references may point into the prefix, the prefix itself
+ * is not emitted.
+ */
+static unsigned int
+lzf_compress_prefix (const void *const in_data, unsigned int prefix_len,
+                     unsigned int in_len,
+                     void *out_data, unsigned int out_len,
+                     LZF_HSLOT *htab)
 {
-#if !LZF_STATE_ARG
-  LZF_STATE htab;
-#endif
-  const u8 *ip = (const u8 *)in_data;
+  const u8 *ip = (const u8 *)in_data + prefix_len;
         u8 *op = (u8 *)out_data;
   const u8 *in_end  = ip + in_len;
         u8 *out_end = op + out_len;
@@ -131,9 +132,17 @@ lzf_compress (const void *const in_data, unsigned int in_len,
     return 0;
 
 #if INIT_HTAB
-  memset (htab, 0, sizeof (htab));
+  memset (htab, 0, sizeof (LZF_STATE));
 #endif
 
+  /* prime the hash table with every position of the prefix */
+  for (ref = (const u8 *)in_data; ref + 2 < ip; ref++)
+    {
+      hval = FRST (ref);
+      hval = NEXT (hval, ref);
+      htab[IDX (hval)] = ref - LZF_HSLOT_BIAS;
+    }
+
   lit = 0; op++; /* start run */
 
   hval = FRST (ip);
@@ -289,3 +298,27 @@ lzf_compress (const void *const in_data, unsigned int in_len,
   return op - (u8 *)out_data;
 }
 
+unsigned int
+lzf_compress (const void *const in_data, unsigned int in_len,
+	      void *out_data, unsigned int out_len
+#if LZF_STATE_ARG
+              , LZF_STATE htab
+#endif
+              )
+{
+#if !LZF_STATE_ARG
+  LZF_STATE htab;
+#endif
+
+  return lzf_compress_prefix (in_data, 0, in_len, out_data, out_len, htab);
+}
+
+unsigned int
+lzf_compress_dict (const void *const buf, unsigned int dict_len,
+                   unsigned int in_len,
+                   void *out_data, unsigned int out_len)
+{
+  LZF_STATE htab;
+
+  return lzf_compress_prefix (buf, dict_len, in_len, out_data, out_len, htab);
+}
@@ -52,12 +52,18 @@
 #endif
 #endif
 
-unsigned int
-lzf_decompress (const void *const in_data,  unsigned int in_len,
-                void             *out_data, unsigned int out_len)
+/*
+ * out_data holds prefix_len bytes of already known data (a preset
+ * dictionary, possibly empty); the decompressed bytes are appended after
+ * it and back references are allowed to reach into the prefix.
+ */
+static unsigned int
+lzf_decompress_prefix (const void *const in_data,  unsigned int in_len,
+                       void             *out_data, unsigned int prefix_len,
+                       unsigned int out_len)
 {
   u8 const *ip = (const u8 *)in_data;
-  u8       *op = (u8 *)out_data;
+  u8       *op = (u8 *)out_data + prefix_len;
   u8 const *const in_end  = ip + in_len;
   u8       *const out_end = op + out_len;
 
@@ -180,6 +186,21 @@ lzf_decompress (const void *const in_data,  unsigned int in_len,
     }
   while (ip < in_end);
 
-  return op - (u8 *)out_data;
+  return op - (u8 *)out_data - prefix_len;
+}
+
+unsigned int
+lzf_decompress (const void *const in_data,  unsigned int in_len,
+                void             *out_data, unsigned int out_len)
+{
+  return lzf_decompress_prefix (in_data, in_len, out_data, 0, out_len);
+}
+
+unsigned int
+lzf_decompress_dict (const void *const in_data,  unsigned int in_len,
+                     void             *buf,      unsigned int dict_len,
+                     unsigned int out_len)
+{
+  return lzf_decompress_prefix (in_data, in_len, buf, dict_len, out_len);
 }
 
@@ -5,8 +5,10 @@ found in the LICENSE file.
 */
 
 #include "rdb_decoder.h"
+#include "transfer_dict.h"
 #include "util/bytes.h"
 #include "util/cfree.h"
+#include "util/log.h"
 #include <netinet/in.h>
 #include <memory>
 
@@ -151,6 +153,37 @@ std::string RdbDecoder::rdbLoadLzfStringObject(int *ret) {
     return tmp;
 }
 
+std::string RdbDecoder::rdbLoadLzfDictStringObject(int *ret) {
+    uint64_t version, len, clen;
+
+    *ret = -1;
+    if ((version = rdbLoadLen(NULL)) == RDB_LENERR) return "";
+    if ((clen = rdbLoadLen(NULL)) == RDB_LENERR) return "";
+    if ((len = rdbLoadLen(NULL)) == RDB_LENERR) return "";
+
+    const char* tmp_c;
+    if (rioReadString(&tmp_c, clen) == 0) {
+        return "";
+    }
+
+    TransferDictPtr dict = transferDicts.find((uint32_t) version);
+    if (!dict) {
+        log_error("unknown transfer dict version: %llu", (unsigned long long) version);
+        return "";
+    }
+
+    /* the dictionary is the prefix of the decompression buffer. */
+    size_t dict_len = dict->data.size();
+    std::unique_ptr<char, cfree_delete<char>> buf((char *)malloc(dict_len + len));
+    memcpy(buf.get(), dict->data.data(), dict_len);
+    if (lzf_decompress_dict(tmp_c, clen, buf.get(), dict_len, len) != len) {
+        return "";
+    }
+
+    *ret = 0;
+    return std::string(buf.get() + dict_len, len);
+}
+
 std::string RdbDecoder::rdbGenericLoadStringObject(int *ret) {
     int isencoded;
     uint64_t len;
@@ -164,6 +197,8 @@ std::string RdbDecoder::rdbGenericLoadStringObject(int *ret) {
                 return rdbLoadIntegerObject(len, ret);
             case RDB_ENC_LZF:
                 return rdbLoadLzfStringObject(ret);
+            case RDB_ENC_LZF_DICT:
+                return rdbLoadLzfDictStringObject(ret);
             default: rdbExitReportCorruptRDB("Unknown RDB string encoding type %d", len);
         }
     }
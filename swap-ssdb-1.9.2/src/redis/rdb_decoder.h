@@ -59,6 +59,8 @@ public:
 
     std::string rdbLoadLzfStringObject(int *ret);
 
+    std::string rdbLoadLzfDictStringObject(int *ret);
+
 
     int rdbLoadDoubleValue(double *val);
 
@@ -119,6 +119,14 @@ int64_t RedisEncoder::rdbSaveRawString(const std::string &string) {
         }
     }
 
+    /* Payloads sent back to redis try the shared dictionary first, small
+     * values barely shrink without it. */
+    if (transfer_dict && len > 20) {
+        int64_t n = rdbSaveLzfDictStringObject(string);
+        if (n == -1) return -1;
+        if (n > 0) return n;
+    }
+
     /* Try LZF compression - under 20 bytes it's unable to compress even
     * aaaaaaaaaaaaaaaaaa so skip it */
     if (rdb_compression && len > 20) {
@@ -284,4 +292,45 @@ int64_t RedisEncoder::rdbSaveLzfBlob(void *data, size_t compress_len, size_t ori
 
     writeerr:
     return -1;
-}
\ No newline at end of file
+}
+
+int64_t RedisEncoder::rdbSaveLzfDictStringObject(const std::string &string) {
+    size_t len = string.length();
+    size_t dict_len = transfer_dict->data.size();
+    size_t comprlen, outlen;
+    unsigned char byte;
+    int64_t n, nwritten = 0;
+
+    /* We require at least four bytes compression for this to be worth it */
+    if (len <= 4) return 0;
+    outlen = len - 4;
+
+    /* lzf_compress_dict wants the dictionary and the input contiguous. */
+    std::unique_ptr<char, cfree_delete<char>> buf_m((char *) malloc(dict_len + len));
+    std::unique_ptr<void, cfree_delete<void>> out_m(malloc(outlen + 1));
+    memcpy(buf_m.get(), transfer_dict->data.data(), dict_len);
+    memcpy(buf_m.get() + dict_len, string.data(), len);
+
+    comprlen = lzf_compress_dict(buf_m.get(), dict_len, len, out_m.get(), outlen);
+    if (comprlen == 0) {
+        return 0;
+    }
+
+    byte = (RDB_ENCVAL << 6) | RDB_ENC_LZF_DICT;
+    if ((n = rdbWriteRaw(&byte, 1)) == -1) return -1;
+    nwritten += n;
+
+    if ((n = rdbSaveLen(transfer_dict->version)) == -1) return -1;
+    nwritten += n;
+
+    if ((n = rdbSaveLen(comprlen)) == -1) return -1;
+    nwritten += n;
+
+    if ((n = rdbSaveLen(len)) == -1) return -1;
+    nwritten += n;
+
+    if ((n = rdbWriteRaw(out_m.get(), comprlen)) == -1) return -1;
+    nwritten += n;
+
+    return nwritten;
+}
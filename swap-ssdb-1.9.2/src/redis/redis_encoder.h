@@ -8,11 +8,13 @@ found in the LICENSE file.
 
 
 #include "util/bytes.h"
+#include "transfer_dict.h"
 
 class RedisEncoder {
 
 protected:
     bool rdb_compression = false;
+    TransferDictPtr transfer_dict;
 public:
 
     virtual int rdbWriteRaw(void *p, size_t n) = 0;
@@ -50,6 +52,8 @@ public:
     int64_t rdbSaveLzfStringObject(const std::string &string);
 
     int64_t rdbSaveLzfBlob(void *data, size_t compress_len, size_t original_len);
+
+    int64_t rdbSaveLzfDictStringObject(const std::string &string);
 };
 
 
@@ -0,0 +1,41 @@
+/*
+Copyright (c) 2017, Timothy. All rights reserved.
+Use of this source code is governed by a BSD-style license that can be
+found in the LICENSE file.
+*/
+
+#include "transfer_dict.h"
+
+TransferDictRegistry transferDicts;
+
+void TransferDictRegistry::install(uint32_t version, const std::string &data) {
+    Locking<Mutex> l(&mutex);
+
+    if (cur && cur->version == version) {
+        return;
+    }
+
+    prev = cur;
+    if (version == 0 || data.empty()) {
+        cur.reset();
+    } else {
+        cur = std::make_shared<const TransferDict>(version, data);
+    }
+}
+
+TransferDictPtr TransferDictRegistry::current() {
+    Locking<Mutex> l(&mutex);
+    return cur;
+}
+
+TransferDictPtr TransferDictRegistry::find(uint32_t version) {
+    Locking<Mutex> l(&mutex);
+
+    if (cur && cur->version == version) {
+        return cur;
+    }
+    if (prev && prev->version == version) {
+        return prev;
+    }
+    return nullptr;
+}
@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2017, Timothy. All rights reserved.
+Use of this source code is governed by a BSD-style license that can be
+found in the LICENSE file.
+*/
+
+#ifndef SSDB_TRANSFER_DICT_H
+#define SSDB_TRANSFER_DICT_H
+
+#include <memory>
+#include <string>
+#include "util/thread.h"
+
+/* LZF back references reach 8k bytes at most, a longer dictionary is useless. */
+#define TRANSFER_DICT_MAX_SIZE 8192
+
+struct TransferDict {
+    uint32_t version;
+    std::string data;
+
+    TransferDict(uint32_t version, const std::string &data) : version(version), data(data) {}
+};
+
+typedef std::shared_ptr<const TransferDict> TransferDictPtr;
+
+/*
+ * Preset dictionaries shared with redis for RDB_ENC_LZF_DICT strings.
+ * Redis trains them from sampled evicted values and installs them with
+ * rr_transfer_dict; the current and the previous version are kept so that
+ * payloads encoded just before a switch can still be decoded.
+ */
+class TransferDictRegistry {
+public:
+    /* version 0 drops the current dictionary. */
+    void install(uint32_t version, const std::string &data);
+
+    TransferDictPtr current();
+
+    TransferDictPtr find(uint32_t version);
+
+private:
+    Mutex mutex;
+    TransferDictPtr cur;
+    TransferDictPtr prev;
+};
+
+extern TransferDictRegistry transferDicts;
+
+#endif //SSDB_TRANSFER_DICT_H
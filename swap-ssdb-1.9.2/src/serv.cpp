@@ -11,6 +11,7 @@ found in the LICENSE file.
 #include "net/proc.h"
 #include "net/server.h"
 #include "replication.h"
+#include "redis/transfer_dict.h"
 #include <sys/utsname.h>
 
 extern "C" {
@@ -213,6 +214,8 @@ DEF_PROC(dreply);
 
 DEF_PROC(cursor_cleanup);
 
+DEF_PROC(hot_keys_push);
+
 DEF_PROC(debug);
 
 DEF_PROC(dump);
@@ -256,6 +259,10 @@ DEF_PROC(rr_transfer_snapshot);
 
 DEF_PROC(rr_del_snapshot);
 
+DEF_PROC(rr_transfer_dict);
+
+DEF_PROC(rr_promote);
+
 DEF_PROC(repopid);
 
 
@@ -263,6 +270,10 @@ DEF_BPROC(COMMAND_DATA_SAVE);
 
 DEF_BPROC(COMMAND_DATA_DUMP);
 
+DEF_BPROC(COMMAND_DATA_DUMP_KEEP);
+
+DEF_BPROC(COMMAND_HOT_KEYS);
+
 #define REG_PROC(c, f)     net->proc_map.set_proc(#c, f, proc_##c)
 
 #define BPROC(c)  bproc_##c
@@ -368,6 +379,7 @@ void SSDBServer::reg_procs(NetworkServer *net) {
     REG_PROC(qtrim, "wt");
 
     REG_PROC(cursor_cleanup, "rt");
+    REG_PROC(hot_keys_push, "r");
     REG_PROC(dump, "wt"); //auctual read but ...
     REG_PROC(restore, "wt");
     REG_PROC(redis_req_dump, "wt"); //auctual read but ...
@@ -407,12 +419,12 @@ void SSDBServer::reg_procs(NetworkServer *net) {
     REG_PROC(rr_make_snapshot, "r");
     REG_PROC(rr_transfer_snapshot, "b");
     REG_PROC(rr_del_snapshot, "r");
+    REG_PROC(rr_transfer_dict, "wt");
 
     REG_PROC(repopid, "wt");
-}
 
-#define COMMAND_DATA_SAVE 1
-#define COMMAND_DATA_DUMP 2
+    net->promote_proc = proc_rr_promote;
+}
 
 
 SSDBServer::SSDBServer(SSDB *ssdb, const Options &opt, NetworkServer *net) : opt(opt) {
@@ -691,6 +703,33 @@ int proc_cursor_cleanup(Context &ctx, Link *link, const Request &req, Response *
 }
 
 
+// Called every server.hot_keys_interval ms in the main thread, the keys
+// costing SSDB the most are sent to redis by a transfer worker.
+int proc_hot_keys_push(Context &ctx, Link *link, const Request &req, Response *resp) {
+    SSDBServer *serv = (SSDBServer *) ctx.net->data;
+    CHECK_NUM_PARAMS(2);
+
+    if (serv->opt.upstream_port == 0) {
+        return 0;
+    }
+
+    auto hot = ctx.net->hot_keys.top((size_t) req[1].Int64());
+    if (hot.empty()) {
+        return 0;
+    }
+
+    TransferJob *job = new TransferJob(ctx, COMMAND_HOT_KEYS, "", "");
+    for (const auto &it : hot) {
+        job->args.push_back(it.first);
+        job->args.push_back(str(it.second));
+    }
+    job->proc = BPROC(COMMAND_HOT_KEYS);
+
+    ctx.net->redis->push(job, std::hash<std::string>()(job->data_key), TRANSFER_CLASS_HOT);
+    return 0;
+}
+
+
 int proc_redis_req_restore(Context &ctx, Link *link, const Request &req, Response *resp) {
     CHECK_NUM_PARAMS(6);
 
@@ -705,7 +744,7 @@ int proc_redis_req_restore(Context &ctx, Link *link, const Request &req, Respons
                                        new DumpData(req[1].String(), req[3].String(), ttl, true));
     job->proc = BPROC(COMMAND_DATA_SAVE);
 
-    ctx.net->redis->push(job);
+    ctx.net->redis->push(job, std::hash<std::string>()(job->data_key), TRANSFER_CLASS_EVICT);
 
     std::string val = "OK";
     resp->reply_get(1, &val);
@@ -718,11 +757,40 @@ int proc_redis_req_dump(Context &ctx, Link *link, const Request &req, Response *
 
     std::string trans_id = req[2].String();
 
-    TransferJob *job = new TransferJob(ctx, COMMAND_DATA_DUMP, req[1].String(), trans_id);
-    job->proc = BPROC(COMMAND_DATA_DUMP);
+    // optional 4th arg tells why redis loads the key, older redis sends none.
+    int cls = TRANSFER_CLASS_HOT;
+    if (req.size() > 3) {
+        std::string type = req[3].String();
+        strtolower(&type);
+        if (type == "blocking") {
+            cls = TRANSFER_CLASS_BLOCKING;
+        } else if (type != "hot") {
+            reply_errinfo_return("ERR invalid load class");
+        }
+    }
 
-    //TODO push1st
-    ctx.net->redis->push(job);
+    // optional 5th arg "keep": redis keeps track of the copy and evicts the
+    // key again without transfer if it's not modified.
+    bool keep = false;
+    if (req.size() > 4) {
+        std::string opt = req[4].String();
+        strtolower(&opt);
+        if (opt != "keep") {
+            reply_errinfo_return("ERR syntax error");
+        }
+        keep = true;
+    }
+
+    TransferJob *job;
+    if (keep) {
+        job = new TransferJob(ctx, COMMAND_DATA_DUMP_KEEP, req[1].String(), trans_id);
+        job->proc = BPROC(COMMAND_DATA_DUMP_KEEP);
+    } else {
+        job = new TransferJob(ctx, COMMAND_DATA_DUMP, req[1].String(), trans_id);
+        job->proc = BPROC(COMMAND_DATA_DUMP);
+    }
+
+    ctx.net->redis->push(job, std::hash<std::string>()(job->data_key), cls);
 
     std::string val = "OK";
     resp->reply_get(1, &val);
@@ -898,12 +966,58 @@ int proc_info(Context &ctx, Link *link, const Request &req, Response *resp) {
     if (all || selected == "queue") {//filesize
         resp->push_back("# Queue");
 
+        int queued_read_job = ctx.net->queued_reads();
+        ReplyWtihSize(queued_read_job);
+        int queued_write_job = ctx.net->queued_writes();
+        ReplyWtihSize(queued_write_job);
+
+        uint64_t proc_calls = 0;
+        double proc_wait_ms = 0, proc_run_ms = 0;
+        for_each(ctx.net->proc_map.begin(), ctx.net->proc_map.end(), [&](std::pair<const Bytes, Command *> it) {
+            proc_calls += it.second->calls;
+            proc_wait_ms += it.second->time_wait;
+            proc_run_ms += it.second->time_proc;
+        });
+        int64_t proc_avg_wait_us = proc_calls > 0 ? (int64_t) (proc_wait_ms * 1000 / proc_calls) : 0;
+        ReplyWtihSize(proc_avg_wait_us);
+        int64_t proc_avg_run_us = proc_calls > 0 ? (int64_t) (proc_run_ms * 1000 / proc_calls) : 0;
+        ReplyWtihSize(proc_avg_run_us);
+
         int queued_transfer_job = ctx.net->redis->queued();
         ReplyWtihSize(queued_transfer_job);
 
+        for (int i = 0; i < TRANSFER_CLASS_MAX; i++) {
+            TransferQueue::Stat stat = {0};
+            for (int j = 0; j < ctx.net->redis->num_shards(); j++) {
+                TransferQueue::Stat t = ctx.net->redis->queue(j)->stat(i);
+                stat.pushed += t.pushed;
+                stat.popped += t.popped;
+                stat.total_wait_us += t.total_wait_us;
+                stat.max_wait_us = std::max(stat.max_wait_us, t.max_wait_us);
+                stat.depth += t.depth;
+                stat.weight = t.weight;
+            }
+
+            std::string prefix = "transfer_" + str(transferClassName(i)) + "_";
+            int64_t avg_wait_us = stat.popped > 0 ? stat.total_wait_us / stat.popped : 0;
+
+            resp->emplace_back(prefix + "weight:" + str(stat.weight));
+            resp->emplace_back(prefix + "queued:" + str(stat.depth));
+            resp->emplace_back(prefix + "processed:" + str(stat.popped));
+            resp->emplace_back(prefix + "avg_wait_us:" + str(avg_wait_us));
+            resp->emplace_back(prefix + "max_wait_us:" + str(stat.max_wait_us));
+        }
+
         int queued_background_job = ctx.net->background->queued();
         ReplyWtihSize(queued_background_job);
 
+        int64_t hot_keys_tracked = ctx.net->hot_keys.size();
+        ReplyWtihSize(hot_keys_tracked);
+        int64_t hot_keys_recorded = ctx.net->hot_keys.recorded;
+        ReplyWtihSize(hot_keys_recorded);
+        int64_t hot_keys_replaced = ctx.net->hot_keys.replaced;
+        ReplyWtihSize(hot_keys_replaced);
+
         resp->emplace_back("");
     }
 
@@ -1063,6 +1177,55 @@ int proc_rr_check_write(Context &ctx, Link *link, const Request &req, Response *
     return 0;
 }
 
+/*
+ * rr_transfer_dict <version> <dict>
+ * installs the dictionary redis trained for RDB_ENC_LZF_DICT strings,
+ * version 0 drops it. Replies with the version so that redis knows which
+ * dictionary it may use for the following redis_req_restore.
+ */
+int proc_rr_transfer_dict(Context &ctx, Link *link, const Request &req, Response *resp) {
+    CHECK_NUM_PARAMS(3);
+
+    uint32_t version = req[1].Uint64();
+    if (errno == EINVAL) {
+        reply_err_return(INVALID_INT);
+    }
+
+    if (req[2].size() > TRANSFER_DICT_MAX_SIZE) {
+        reply_errinfo_return("ERR transfer dict is too long");
+    }
+
+    transferDicts.install(version, req[2].String());
+    log_info("transfer dict installed, version: %u, size: %d", version, req[2].size());
+
+    resp->push_back("ok");
+    resp->push_back("rr_transfer_dict ok " + str(version));
+    return 0;
+}
+
+/*
+ * not a command by itself: "rr_promote <id> <cmd> <key> ..." runs <cmd> and
+ * then this proc, which dumps <key> so that redis can load it together with
+ * the reply. Redis deletes the key once loaded, the dump here is a copy.
+ */
+int proc_rr_promote(Context &ctx, Link *link, const Request &req, Response *resp) {
+    SSDBServer *serv = (SSDBServer *) ctx.net->data;
+    CHECK_NUM_PARAMS(2);
+
+    std::string val;
+
+    PTST(promote, 0.01)
+    int ret = serv->ssdb->dump(ctx, req[1], &val, nullptr, serv->opt.rdb_compression, true);
+    PTE(promote, hexstr(req[1]))
+
+    if (ret <= 0) {
+        return 0;
+    }
+
+    ctx.promote = {"promote", str(link->redis->promote_id), val};
+    return 0;
+}
+
 int proc_rr_flushall_check(Context &ctx, Link *link, const Request &req, Response *resp) {
     resp->push_back("ok");
     resp->push_back("rr_flushall_check ok");
@@ -1082,7 +1245,7 @@ int proc_rr_do_flushall(Context &ctx, Link *link, const Request &req, Response *
         discarded_jobs.pop();
     }
 
-    Locking<RecordMutex<Mutex>> gl(&serv->transfer_mutex_record_);
+    Locking<TransferWorkerPool> gl(ctx.net->redis);
 
     log_warn("[!!!] TransferJob clear done , starting flushdb");
 
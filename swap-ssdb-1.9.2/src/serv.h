@@ -79,7 +79,6 @@ public:
 	~SSDBServer();
 
 	SSDBImpl *ssdb;
-    RecordMutex<Mutex> transfer_mutex_record_;
 
     const Options &opt;
 
@@ -154,7 +154,7 @@ public:
 
 	/* 	General	*/
 	virtual int type(Context &ctx, const Bytes &key,std::string *type);
-	virtual int dump(Context &ctx, const Bytes &key,std::string *res, int64_t *pttl, bool compress);
+	virtual int dump(Context &ctx, const Bytes &key,std::string *res, int64_t *pttl, bool compress, bool transfer = false);
 	virtual int rdbSaveObject(Context &ctx, const Bytes &key, char dtype, const std::string &meta_val,
 							  RedisEncoder &encoder, const leveldb::Snapshot *snapshot);
 	virtual int restore(Context &ctx, const Bytes &key,int64_t expire, const Bytes &data, bool replace, std::string *res);
@@ -36,7 +36,7 @@ int decodeMetaVal(T &mv, const std::string &val) {
 }
 
 
-int SSDBImpl::dump(Context &ctx, const Bytes &key, std::string *res, int64_t *pttl, bool compress) {
+int SSDBImpl::dump(Context &ctx, const Bytes &key, std::string *res, int64_t *pttl, bool compress, bool transfer) {
     *res = "none";
 
     int ret = 0;
@@ -107,7 +107,8 @@ int SSDBImpl::dump(Context &ctx, const Bytes &key, std::string *res, int64_t *pt
 
     SnapshotPtr spl(ldb, snapshot); //auto release
 
-    DumpEncoder rdbEncoder(compress);
+    /* payloads loaded back into redis may use the dictionary shared with it. */
+    DumpEncoder rdbEncoder(compress, transfer ? transferDicts.current() : nullptr);
 
     if (rdbEncoder.rdbSaveObjectType(dtype) < 0) return -1;
     if (rdbSaveObject(ctx, key, dtype, meta_val, rdbEncoder, snapshot) < 0) return -1;
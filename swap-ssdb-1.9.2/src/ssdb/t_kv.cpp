@@ -156,6 +156,7 @@ int SSDBImpl::multi_del(Context &ctx, const std::set<std::string> &distinct_keys
 	leveldb::WriteBatch batch;
 
     RecordLocks<Mutex> ls(&mutex_record_, distinct_keys);
+    ls.Lock();
 
     for (const auto &key : distinct_keys) {
         int iret = del_key_internal(ctx, key, batch);
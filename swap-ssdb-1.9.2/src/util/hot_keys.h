@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2017, Timothy. All rights reserved.
+Use of this source code is governed by a BSD-style license that can be
+found in the LICENSE file.
+*/
+
+#ifndef SSDB_HOT_KEYS_H
+#define SSDB_HOT_KEYS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+/*
+ * The keys costing SSDB the most, among the reads redis sends for its cold
+ * keys, pushed back to redis as promotion candidates.
+ *
+ * A Space-Saving sketch of a fixed number of entries weighted by the time
+ * spent on every read, plus one per access so cheap but frequent keys are
+ * seen too. A key missing from a full sketch takes the place of the lightest
+ * entry, and inherits its weight as error: the weight of a key is never
+ * underestimated, and a key heavier than total / capacity is always kept.
+ * The weights are halved every time the candidates are taken, to follow the
+ * recent accesses only.
+ */
+
+class HotKeyEntry {
+public:
+    std::string key;
+    uint64_t weight;    // time spent in us, plus one per access
+    uint64_t error;     // inherited from the entry it replaced
+    uint64_t hits;
+
+    HotKeyEntry(const std::string &key, uint64_t weight, uint64_t error) :
+            key(key), weight(weight), error(error), hits(1) {}
+};
+
+class HotKeys {
+public:
+
+    uint64_t capacity = 256;
+    uint64_t recorded = 0;
+    uint64_t replaced = 0;
+
+    void record(const std::string &key, int64_t cost) {
+        uint64_t w = 1 + (cost > 0 ? (uint64_t) cost : 0);
+        recorded++;
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            HotKeyEntry &e = entries[it->second];
+            e.weight += w;
+            e.hits++;
+            return;
+        }
+
+        if (entries.size() < capacity) {
+            index[key] = entries.size();
+            entries.emplace_back(key, w, 0);
+            return;
+        }
+        if (entries.empty()) {
+            return;
+        }
+
+        size_t min = 0;
+        for (size_t j = 1; j < entries.size(); j++) {
+            if (entries[j].weight < entries[min].weight) {
+                min = j;
+            }
+        }
+        HotKeyEntry &e = entries[min];
+        index.erase(e.key);
+        index[key] = min;
+        e = HotKeyEntry(key, e.weight + w, e.weight);
+        replaced++;
+    }
+
+    // Up to 'count' keys by weight, heaviest first, with their weight. Only
+    // the keys whose weight is mostly their own and not an inherited error
+    // are candidates. The weights are halved afterwards.
+    std::vector<std::pair<std::string, uint64_t>> top(size_t count) {
+        std::vector<std::pair<std::string, uint64_t>> res;
+        std::vector<size_t> order;
+
+        for (size_t j = 0; j < entries.size(); j++) {
+            if (entries[j].error * 2 < entries[j].weight) {
+                order.push_back(j);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return entries[a].weight > entries[b].weight;
+        });
+        for (size_t j = 0; j < order.size() && j < count; j++) {
+            res.emplace_back(entries[order[j]].key, entries[order[j]].weight);
+        }
+
+        decay();
+        return res;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    void reset() {
+        entries.clear();
+        index.clear();
+        recorded = 0;
+        replaced = 0;
+    }
+
+private:
+
+    std::vector<HotKeyEntry> entries;
+    std::unordered_map<std::string, size_t> index;
+
+    // Halve the weights, the entries left weightless make room first.
+    void decay() {
+        size_t kept = 0;
+        index.clear();
+        for (size_t j = 0; j < entries.size(); j++) {
+            HotKeyEntry &e = entries[j];
+            e.weight /= 2;
+            e.error /= 2;
+            e.hits /= 2;
+            if (e.weight == 0) {
+                continue;
+            }
+            if (kept != j) {
+                entries[kept] = e;
+            }
+            index[entries[kept].key] = kept;
+            kept++;
+        }
+        entries.erase(entries.begin() + kept, entries.end());
+    }
+
+};
+
+
+#endif //SSDB_HOT_KEYS_H
@@ -19,6 +19,7 @@ found in the LICENSE file.
 #include <sys/time.h>
 #include <atomic>
 #include <set>
+#include "log.h"
 
 class Mutex{
 	private:
@@ -368,6 +369,63 @@ class SelectableQueue{
 		int pop(T *data);
 };
 
+
+// Thread safe queue with N priority classes, multi writers, multi readers.
+// pop() picks among the non-empty classes by smooth weighted round-robin,
+// so a lower class is never starved, only served less often.
+template <class T, int N>
+class WeightedQueue{
+	public:
+		struct Stat{
+			int64_t pushed;
+			int64_t popped;
+			int64_t total_wait_us;
+			int64_t max_wait_us;
+			int depth;
+			int weight;
+		};
+	private:
+		pthread_cond_t cond;
+		pthread_mutex_t mutex;
+		std::queue<std::pair<T, int64_t> > items[N];
+		int weights[N];
+		int current[N];
+		int batch_limits[N];
+		Stat stats[N];
+		int total;
+		bool closed;
+
+		static int64_t now_us(){
+			struct timeval tv;
+			gettimeofday(&tv, NULL);
+			return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+		}
+		int select();
+		T take(int64_t now, int *cls=NULL);
+	public:
+		WeightedQueue();
+		~WeightedQueue();
+
+		bool empty();
+		int size();
+		std::queue<T> discard();
+		// weight <= 0 is treated as 1
+		void set_weight(int cls, int weight);
+		// a batch ends once it holds limit items of cls, so the queue is
+		// looked at again after them; limit <= 0 means no limit
+		void set_batch_limit(int cls, int limit);
+		Stat stat(int cls);
+		// items pushed without a class go to the lowest one(N-1)
+		int push(const T item);
+		int push(const T item, int cls);
+		int pop(T *data);
+		// block until not empty, then take up to max items in scheduling order,
+		// return 0 once the queue is closed
+		int pop_batch(std::vector<T> *data, int max);
+		// wake up the readers blocked in pop_batch(), for them to quit
+		void close();
+};
+
 template<class W, class JOB>
 class WorkerPool{
 	public:
@@ -416,7 +474,85 @@ class WorkerPool{
 };
 
 
+// Worker pool with one job queue per worker. Jobs are routed to a fixed
+// worker by a caller supplied hash, so jobs with the same hash are always
+// processed in order by the same thread. A worker takes all jobs queued for
+// it at once(up to batch_size, or fewer if Q caps a class per batch) and
+// hands them to W::proc_batch().
+// Q must provide push(job, cls), pop_batch(), size(), discard() and close().
+template<class W, class JOB, class Q>
+class ShardedWorkerPool{
+	public:
+		class Worker{
+			public:
+				Worker(){};
+				virtual ~Worker(){}
+				int id;
+				virtual void init(){}
+				virtual void destroy(){}
+				virtual int proc(JOB job) = 0;
+				virtual int proc_batch(std::vector<JOB> &jobs){
+					for(int i=0; i<(int)jobs.size(); i++){
+						proc(jobs[i]);
+					}
+					return 0;
+				}
+			private:
+			protected:
+				std::string name;
+		};
+	private:
+		std::string name;
+		std::vector<Q *> shards;
+		SelectableQueue<JOB> results;
+		int batch_size;
+
+		// lock() stops workers from starting new batches
+		pthread_mutex_t gate_mutex;
+		pthread_cond_t gate_cond;
+		int paused;
+		int running;
+		bool quit;
+
+		std::vector<pthread_t> tids;
+		bool started;
+
+		struct run_arg{
+			int id;
+			ShardedWorkerPool *tp;
+		};
+		static void* _run_worker(void *arg);
+	public:
+		ShardedWorkerPool(const char *name="", int batch_size=32);
+		~ShardedWorkerPool();
+
+		int fd(){
+			return results.fd();
+		}
+
+		// create queues, must be called before any push
+		int init(int num_workers);
+		int start();
+		// wait for the running batches to finish and the workers to quit,
+		// the jobs still queued are left to discard()
+		int stop();
+
+		int num_shards(){
+			return shards.size();
+		}
+		Q* queue(int shard){
+			return shards[shard];
+		}
+
+		// wait for running batches to finish and hold off new ones
+		void lock();
+		void unlock();
 
+		std::queue<JOB> discard();
+		int queued();
+		int push(JOB job, size_t hash, int cls);
+		int pop(JOB *job);
+};
 
 
 template <class T>
@@ -583,6 +719,216 @@ int SelectableQueue<T>::pop(T *data){
 }
 
 
+template <class T, int N>
+WeightedQueue<T, N>::WeightedQueue(){
+	pthread_cond_init(&cond, NULL);
+	pthread_mutex_init(&mutex, NULL);
+	for(int i=0; i<N; i++){
+		weights[i] = 1;
+		current[i] = 0;
+		batch_limits[i] = 0;
+		memset(&stats[i], 0, sizeof(Stat));
+	}
+	total = 0;
+	closed = false;
+}
+
+template <class T, int N>
+WeightedQueue<T, N>::~WeightedQueue(){
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+template <class T, int N>
+bool WeightedQueue<T, N>::empty(){
+	return size() == 0;
+}
+
+template <class T, int N>
+int WeightedQueue<T, N>::size(){
+	int ret = 0;
+	if(pthread_mutex_lock(&mutex) != 0){
+		return -1;
+	}
+	ret = total;
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+template <class T, int N>
+std::queue<T> WeightedQueue<T, N>::discard(){
+	std::queue<T> ret;
+	if(pthread_mutex_lock(&mutex) != 0){
+		return ret;
+	}
+	for(int i=0; i<N; i++){
+		while(!items[i].empty()){
+			ret.push(items[i].front().first);
+			items[i].pop();
+		}
+		current[i] = 0;
+	}
+	total = 0;
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+template <class T, int N>
+void WeightedQueue<T, N>::set_weight(int cls, int weight){
+	if(cls < 0 || cls >= N){
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	weights[cls] = weight > 0 ? weight : 1;
+	pthread_mutex_unlock(&mutex);
+}
+
+template <class T, int N>
+void WeightedQueue<T, N>::set_batch_limit(int cls, int limit){
+	if(cls < 0 || cls >= N){
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	batch_limits[cls] = limit > 0 ? limit : 0;
+	pthread_mutex_unlock(&mutex);
+}
+
+template <class T, int N>
+typename WeightedQueue<T, N>::Stat WeightedQueue<T, N>::stat(int cls){
+	Stat ret;
+	memset(&ret, 0, sizeof(Stat));
+	if(cls < 0 || cls >= N){
+		return ret;
+	}
+	pthread_mutex_lock(&mutex);
+	ret = stats[cls];
+	ret.depth = items[cls].size();
+	ret.weight = weights[cls];
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+template <class T, int N>
+int WeightedQueue<T, N>::push(const T item){
+	return push(item, N - 1);
+}
+
+template <class T, int N>
+int WeightedQueue<T, N>::push(const T item, int cls){
+	if(cls < 0 || cls >= N){
+		cls = N - 1;
+	}
+	if(pthread_mutex_lock(&mutex) != 0){
+		return -1;
+	}
+	{
+		items[cls].push(std::make_pair(item, now_us()));
+		stats[cls].pushed++;
+		total++;
+	}
+	pthread_mutex_unlock(&mutex);
+	pthread_cond_signal(&cond);
+	return 1;
+}
+
+// called with mutex held and total > 0
+template <class T, int N>
+int WeightedQueue<T, N>::select(){
+	int best = -1;
+	int sum = 0;
+	for(int i=0; i<N; i++){
+		if(items[i].empty()){
+			continue;
+		}
+		current[i] += weights[i];
+		sum += weights[i];
+		if(best == -1 || current[i] > current[best]){
+			best = i;
+		}
+	}
+	current[best] -= sum;
+	return best;
+}
+
+// called with mutex held and total > 0
+template <class T, int N>
+T WeightedQueue<T, N>::take(int64_t now, int *selected){
+	int cls = select();
+	if(selected){
+		*selected = cls;
+	}
+	T item = items[cls].front().first;
+	int64_t wait = now - items[cls].front().second;
+	items[cls].pop();
+	total--;
+
+	stats[cls].popped++;
+	stats[cls].total_wait_us += wait;
+	if(wait > stats[cls].max_wait_us){
+		stats[cls].max_wait_us = wait;
+	}
+	return item;
+}
+
+template <class T, int N>
+int WeightedQueue<T, N>::pop(T *data){
+	if(pthread_mutex_lock(&mutex) != 0){
+		return -1;
+	}
+	{
+		while(total == 0){
+			if(pthread_cond_wait(&cond, &mutex) != 0){
+				return -1;
+			}
+		}
+		*data = take(now_us());
+	}
+	if(pthread_mutex_unlock(&mutex) != 0){
+		return -1;
+	}
+	return 1;
+}
+
+template <class T, int N>
+int WeightedQueue<T, N>::pop_batch(std::vector<T> *data, int max){
+	if(pthread_mutex_lock(&mutex) != 0){
+		return -1;
+	}
+	{
+		while(total == 0 && !closed){
+			if(pthread_cond_wait(&cond, &mutex) != 0){
+				return -1;
+			}
+		}
+		if(closed){
+			pthread_mutex_unlock(&mutex);
+			return 0;
+		}
+		int64_t now = now_us();
+		int taken[N] = {0};
+		while(total > 0 && (int)data->size() < max){
+			int cls;
+			data->push_back(take(now, &cls));
+			if(batch_limits[cls] > 0 && ++taken[cls] >= batch_limits[cls]){
+				break;
+			}
+		}
+	}
+	if(pthread_mutex_unlock(&mutex) != 0){
+		return -1;
+	}
+	return data->size();
+}
+
+template <class T, int N>
+void WeightedQueue<T, N>::close(){
+	pthread_mutex_lock(&mutex);
+	closed = true;
+	pthread_mutex_unlock(&mutex);
+	pthread_cond_broadcast(&cond);
+}
+
+
 
 template<class W, class JOB>
 WorkerPool<W, JOB>::WorkerPool(const char *name){
@@ -681,6 +1027,199 @@ int WorkerPool<W, JOB>::stop(){
 	return 0;
 }
 
+
+
+template<class W, class JOB, class Q>
+ShardedWorkerPool<W, JOB, Q>::ShardedWorkerPool(const char *name, int batch_size){
+	this->name = name;
+	this->batch_size = batch_size > 0 ? batch_size : 1;
+	this->started = false;
+	this->paused = 0;
+	this->running = 0;
+	this->quit = false;
+	pthread_mutex_init(&gate_mutex, NULL);
+	pthread_cond_init(&gate_cond, NULL);
+}
+
+template<class W, class JOB, class Q>
+ShardedWorkerPool<W, JOB, Q>::~ShardedWorkerPool(){
+	if(started){
+		stop();
+	}
+	for(int i=0; i<(int)shards.size(); i++){
+		delete shards[i];
+	}
+	pthread_cond_destroy(&gate_cond);
+	pthread_mutex_destroy(&gate_mutex);
+}
+
+template<class W, class JOB, class Q>
+int ShardedWorkerPool<W, JOB, Q>::init(int num_workers){
+	if(!shards.empty()){
+		return 0;
+	}
+	if(num_workers < 1){
+		num_workers = 1;
+	}
+	for(int i=0; i<num_workers; i++){
+		shards.push_back(new Q());
+	}
+	return 0;
+}
+
+template<class W, class JOB, class Q>
+int ShardedWorkerPool<W, JOB, Q>::push(JOB job, size_t hash, int cls){
+	return shards[hash % shards.size()]->push(job, cls);
+}
+
+template<class W, class JOB, class Q>
+int ShardedWorkerPool<W, JOB, Q>::queued(){
+	int ret = 0;
+	for(int i=0; i<(int)shards.size(); i++){
+		ret += shards[i]->size();
+	}
+	return ret;
+}
+
+template<class W, class JOB, class Q>
+std::queue<JOB> ShardedWorkerPool<W, JOB, Q>::discard(){
+	std::queue<JOB> ret;
+	for(int i=0; i<(int)shards.size(); i++){
+		std::queue<JOB> jobs = shards[i]->discard();
+		while(!jobs.empty()){
+			ret.push(jobs.front());
+			jobs.pop();
+		}
+	}
+	return ret;
+}
+
+template<class W, class JOB, class Q>
+int ShardedWorkerPool<W, JOB, Q>::pop(JOB *job){
+	return this->results.pop(job);
+}
+
+template<class W, class JOB, class Q>
+void ShardedWorkerPool<W, JOB, Q>::lock(){
+	pthread_mutex_lock(&gate_mutex);
+	paused++;
+	while(running > 0){
+		pthread_cond_wait(&gate_cond, &gate_mutex);
+	}
+	pthread_mutex_unlock(&gate_mutex);
+}
+
+template<class W, class JOB, class Q>
+void ShardedWorkerPool<W, JOB, Q>::unlock(){
+	pthread_mutex_lock(&gate_mutex);
+	paused--;
+	pthread_cond_broadcast(&gate_cond);
+	pthread_mutex_unlock(&gate_mutex);
+}
+
+template<class W, class JOB, class Q>
+void* ShardedWorkerPool<W, JOB, Q>::_run_worker(void *arg){
+	struct run_arg *p = (struct run_arg*)arg;
+	int id = p->id;
+	ShardedWorkerPool *tp = p->tp;
+	delete p;
+
+	W w(tp->name);
+	Worker *worker = (Worker *)&w;
+	worker->id = id;
+	worker->init();
+	Q *jobs = tp->shards[id];
+	std::vector<JOB> batch;
+	batch.reserve(tp->batch_size);
+	while(1){
+		batch.clear();
+		int ret = jobs->pop_batch(&batch, tp->batch_size);
+		if(ret == -1){
+			log_fatal("%s worker %d: jobs.pop error", tp->name.c_str(), id);
+			::exit(1);
+		}
+		if(ret == 0){
+			break;
+		}
+
+		pthread_mutex_lock(&tp->gate_mutex);
+		while(tp->paused > 0 && !tp->quit){
+			pthread_cond_wait(&tp->gate_cond, &tp->gate_mutex);
+		}
+		if(tp->quit){
+			pthread_mutex_unlock(&tp->gate_mutex);
+			break;
+		}
+		tp->running++;
+		pthread_mutex_unlock(&tp->gate_mutex);
+
+		worker->proc_batch(batch);
+
+		pthread_mutex_lock(&tp->gate_mutex);
+		tp->running--;
+		if(tp->running == 0){
+			pthread_cond_broadcast(&tp->gate_cond);
+		}
+		pthread_mutex_unlock(&tp->gate_mutex);
+
+		for(int i=0; i<(int)batch.size(); i++){
+			if(tp->results.push(batch[i]) == -1){
+				log_fatal("%s worker %d: results.push error", tp->name.c_str(), id);
+				::exit(1);
+			}
+		}
+	}
+	worker->destroy();
+	return (void *)NULL;
+}
+
+template<class W, class JOB, class Q>
+int ShardedWorkerPool<W, JOB, Q>::start(){
+	if(started){
+		return 0;
+	}
+	init(1);
+	int err;
+	pthread_t tid;
+	for(int i=0; i<(int)shards.size(); i++){
+		struct run_arg *arg = new run_arg();
+		arg->id = i;
+		arg->tp = this;
+
+		err = pthread_create(&tid, NULL, &ShardedWorkerPool::_run_worker, arg);
+		if(err != 0){
+			log_error("%s: can't create thread: %s", name.c_str(), strerror(err));
+			delete arg;
+		}else{
+			tids.push_back(tid);
+		}
+	}
+	started = true;
+	return 0;
+}
+
+template<class W, class JOB, class Q>
+int ShardedWorkerPool<W, JOB, Q>::stop(){
+	if(!started){
+		return 0;
+	}
+	// a worker is either blocked on its queue, running a batch, which it
+	// finishes before quitting, or held by lock(), its batch is dropped then
+	pthread_mutex_lock(&gate_mutex);
+	quit = true;
+	pthread_cond_broadcast(&gate_cond);
+	pthread_mutex_unlock(&gate_mutex);
+	for(int i=0; i<(int)shards.size(); i++){
+		shards[i]->close();
+	}
+	for(int i=0; i<(int)tids.size(); i++){
+		pthread_join(tids[i], NULL);
+	}
+	tids.clear();
+	started = false;
+	return 0;
+}
+
 #if 0
 class MyWorker : public WorkerPool<MyWorker, int>::Worker{
 	public: